@@ -1,306 +1,255 @@
-#include <cstdio>
+#include "osn.h"
+
+#include <algorithm>
+#include <cassert>
 #include <cstring>
 #include <vector>
-#include <iostream>
-#include <math.h>
-#include <bits/stdc++.h> 
 using namespace std;
 
 #include <cryptoTools/Common/BitVector.h>
 
-std::vector<int> perm;
-std::vector<int> inv_perm;
-std::vector<std::vector<int>> switched;
-
-const int benes_size = 1.27*(1 << 20);
-static char path[benes_size];
+namespace {
 
-inline void swap(uint64_t& a, uint64_t& b) {
-	uint64_t tmp;
-    tmp = b;
-    b = a;
-    a = tmp;
+inline void to_words(const osuCrypto::block &b, uint64_t (&w)[2]) {
+    memcpy(w, &b, sizeof(w));
 }
 
-void initialize(int values, int levels) {
-    perm.resize(values);
-    inv_perm.resize(values);
-    switched.resize(levels);
-    for (int i= 0; i < levels; ++i) {
-		switched[i].resize(values/2);
-	}
-}                   
-
-
-void DFS(int idx, int route) {
-    stack<pair<int, int> > st; 
-    st.push({idx, route});
-    pair<int, int> pr;
-    while (!st.empty()) {
-		pr = st.top();
-		st.pop();
-		path[pr.first] = pr.second;
-		if (path[pr.first ^ 1] < 0) {
-			st.push({pr.first ^ 1, pr.second ^ 1});
-		}
-
-		idx = perm[inv_perm[pr.first] ^ 1];
-		if (path[idx] < 0) {
-			st.push({idx, pr.second ^ 1});
-		}
-	} 
-}
+}  // namespace
 
-int shuffle(int i, int n) { 
-  	return ((i & 1) << (n - 1)) | (i >> 1); 
-}
+Benes::Benes(int values) : values_(values), n_(0) {
+    while ((1 << n_) < values_) n_++;
+    levels_ = std::max(2 * n_ - 1, 0);
 
-void route(int n, int cur_level, int index, const vector<int> &src, const vector<int> &dest) {
-
-    int levels, i, j, x, s;
-    vector<int> bottom1;
-    vector<int> top1;
-    int values = src.size();
-
-    // the same cur_level of layer can be simultaneously processed
-    // process when element size is 2
-    if (values == 2) {
-      	if (n == 1) {
-			switched[cur_level][index] = src[0] != dest[0]; 
-		} else {
-			switched[cur_level+1][index] = src[0] != dest[0];
-		}
-      	return; 
+    if (values_ >= 2) {
+        layers_.push_back({{0, values_, n_, 0}});
     }
-
-    // process when element size is 3
-    if (values == 3) {
-
-      if (src[0] == dest[0]) {
-        switched[cur_level][index] = 0;
-        switched[cur_level+2][index] = 0;
-        if (src[1] == dest[1]) {
-			switched[cur_level+1][index] = 0;   // 1 2 3 -> 1 2 3
-		} else {
-			switched[cur_level+1][index] = 1;   // 1 2 3 -> 1 3 2
-		}
-          
-      }
-
-      if (src[0] == dest[1]) {
-        switched[cur_level][index] = 0;
-        switched[cur_level+2][index] = 1;
-        if (src[1] == dest[0])  {
-			switched[cur_level+1][index] = 0;   // 1 2 3 -> 2 1 3
-		} else {
-          	switched[cur_level+1][index] = 1;   // 1 2 3 -> 3 1 2
-		}
-      }
-
-      if (src[0] == dest[2]) {
-        switched[cur_level][index] = 1;
-        switched[cur_level+1][index] = 1;
-        if (src[1] == dest[0]) {
-			switched[cur_level+2][index] = 0;   // 1 2 3 -> 2 3 1
-		} else {
-			switched[cur_level+2][index] = 1;   // 1 2 3 -> 3 2 1
-		} 
-      }
-	  
-      return;
+    while (!layers_.empty()) {
+        std::vector<Subnet> next;
+        for (const auto &s : layers_.back()) {
+            if (s.values <= 3) continue;
+            next.push_back({s.offset, s.values / 2, s.n - 1, s.index});
+            next.push_back({s.offset + s.values / 2, s.values - s.values / 2, s.n - 1, s.index + s.values / 4});
+        }
+        if (next.empty()) break;
+        layers_.push_back(std::move(next));
     }
 
-    levels = 2 * n - 1;
-    
-    vector<int> bottom2(values / 2);
-    vector<int> top2(int(ceil(values*0.5)));
+    switched_.resize(std::size_t(levels_) * (values_ / 2));
+    perm_[0].resize(values_);
+    perm_[1].resize(values_);
+    inv_perm_.resize(values_);
+    path_.resize(values_);
+}
 
-    for (i = 0; i < values; ++i) {
-		inv_perm[src[i]] = i;
-	}
-  
-    for (i = 0; i < values; ++i) {
-		perm[i] = inv_perm[dest[i]];
-	}
-  
-    for (i = 0; i < values; ++i) {
-		inv_perm[perm[i]] = i;
-	}
+void Benes::route(const vector<int> &src, const vector<int> &dest) {
+    assert(int(src.size()) == values_ && int(dest.size()) == values_);
 
-    memset(path, -1, sizeof(path));
-    if (values & 1) {
-      	path[values - 1] = 1;   
-      	path[perm[values - 1]] = 1; 
-      	if (perm[values - 1] != values - 1) {
-        	int idx = perm[inv_perm[values - 1] ^ 1];
-        	DFS(idx, 0);
-     	}
+    for (int i = 0; i < values_; ++i) {
+        inv_perm_[src[i]] = i;
+    }
+    for (int i = 0; i < values_; ++i) {
+        perm_[0][i] = inv_perm_[dest[i]];
     }
 
-    for (i = 0; i < values; ++i)
-      	if (path[i] < 0) {
-        	DFS(i, 0);
-      	}
-
-    for (i = 0; i < values - 1; i += 2) {
-      	switched[cur_level][index + i / 2] = path[i];
-      	for (j = 0; j < 2; ++j) {
-        	x = shuffle((i | j) ^ path[i], n);
-        	if (x < values / 2) {
-          		bottom1.push_back(src[i | j]); 
-        	} else {
-          		top1.push_back(src[i | j]);
-        	}
-      	}
+    // the subnetworks of a layer span disjoint wires and switches.
+    for (std::size_t l = 0; l < layers_.size(); ++l) {
+        const auto &layer = layers_[l];
+        const int *perm = perm_[l & 1].data();
+        int *next = perm_[(l + 1) & 1].data();
+
+        #pragma omp parallel for schedule(dynamic, 64) if (layer.size() > 1)
+        for (std::size_t i = 0; i < layer.size(); ++i) {
+            route_subnet(l, layer[i], perm, next);
+        }
     }
+}
 
-    if (values & 1) {
-      	top1.push_back(src[values - 1]);
+// Colors each input of s with the half it is routed through, 0 for the
+// bottom, such that the two inputs of a switch, and the two inputs that go
+// to the two outputs of a switch, differ. These constraints pair up the
+// inputs into cycles, which are colored alternately in one walk each. The
+// odd wire goes through the top and ends a path instead of a cycle.
+void Benes::route_subnet(int level, const Subnet &s, const int *perm, int *next) {
+    const int v = s.values;
+    const int *p = perm + s.offset;
+    int *q = next + s.offset;
+
+    if (v == 2) {
+        set_switch(s.n == 1 ? level : level + 1, s.index, p[0] != 0);
+        return;
     }
 
-    for (i = 0; i < values - 1; i += 2) {
-		s = switched[cur_level + levels - 1][index + i / 2] = path[perm[i]];
-		for (j = 0; j < 2; ++j) {
-			x = shuffle((i | j) ^ s, n);
-			if (x < values / 2) {
-				bottom2[x] = src[perm[i | j]]; 
-			} else {
-				top2[i / 2] = src[perm[i | j]];
-			}
-		}
+    if (v == 3) {
+        if (p[0] == 0) {
+            set_switch(level, s.index, 0);
+            set_switch(level + 2, s.index, 0);
+            set_switch(level + 1, s.index, p[1] != 1);   // 1 2 3 -> 1 2 3 or 1 3 2
+        }
+        if (p[1] == 0) {
+            set_switch(level, s.index, 0);
+            set_switch(level + 2, s.index, 1);
+            set_switch(level + 1, s.index, p[0] != 1);   // 1 2 3 -> 2 1 3 or 3 1 2
+        }
+        if (p[2] == 0) {
+            set_switch(level, s.index, 1);
+            set_switch(level + 1, s.index, 1);
+            set_switch(level + 2, s.index, p[0] != 1);   // 1 2 3 -> 2 3 1 or 3 2 1
+        }
+        return;
     }
 
-    int idx =int(ceil(values*0.5));
-    if (values & 1) {
-		top2[idx-1] = dest[values-1];
+    int *ip = inv_perm_.data() + s.offset;
+    signed char *path = path_.data() + s.offset;
+    for (int i = 0; i < v; ++i) {
+        ip[p[i]] = i;
+    }
+    std::fill_n(path, unsigned(v), -1);
+
+    // from input x with color c, alternately across an input switch and
+    // across an output switch, until the cycle closes or the path ends.
+    auto walk = [&](int x, signed char c) {
+        for (;;) {
+            path[x] = c;
+            int y = x ^ 1;
+            if (path[y] >= 0) break;
+            path[y] = c ^ 1;
+            x = p[ip[y] ^ 1];
+            if (path[x] >= 0) break;
+        }
+    };
+
+    if (v & 1) {
+        path[v - 1] = 1;
+        path[p[v - 1]] = 1;
+        if (p[v - 1] != v - 1) {
+            walk(p[ip[v - 1] ^ 1], 0);
+        }
+    }
+    for (int i = 0; i < v; ++i) {
+        if (path[i] < 0) walk(i, 0);
     }
 
-    route(n - 1, cur_level + 1, index, bottom1, bottom2);
-    route(n - 1, cur_level + 1, index + values / 4, top1, top2);
+    // the halves are numbered by switch, their outputs by output switch.
+    const int last = level + 2 * s.n - 2;
+    const int half = v / 2;
+    for (int i = 0; i < v - 1; i += 2) {
+        set_switch(level, s.index + i / 2, path[i]);
+        int o = path[p[i]];
+        set_switch(last, s.index + i / 2, o);
+        q[i / 2] = p[i + o] >> 1;
+        q[half + i / 2] = p[i + 1 - o] >> 1;
+    }
+    if (v & 1) {
+        q[v - 1] = p[v - 1] >> 1;
+    }
 }
 
-void masked_eval (int n, int cur_level, int index, vector<uint64_t> &src, vector<vector<osuCrypto::block>> &ot_output) {
-	int levels, i, j, x, s;
-	vector<uint64_t> bottom1;
-	vector<uint64_t> top1;
-	int values = src.size();
-	uint64_t tmp_int[2];
-	osuCrypto::block tmp_block;
-
-	if (values == 2) {
-		if (n == 1) {
-			tmp_block = ot_output[cur_level][index];
-			memcpy(tmp_int, &tmp_block, sizeof(tmp_int));
-			src[0] ^= tmp_int[0];
-			src[1] ^= tmp_int[1];
-			if (switched[cur_level][index] == 1) {
-				swap(src[0], src[1]);
-			}  
-		} else {
-			tmp_block = ot_output[cur_level + 1][index];
-			memcpy(tmp_int, &tmp_block, sizeof(tmp_int));
-			src[0] ^= tmp_int[0];
-			src[1] ^= tmp_int[1];
-			if (switched[cur_level + 1][index] == 1) {
-				swap(src[0], src[1]);
-			} 
-		} 
-		return; 
-	}
-
-	if (values == 3) {
-		tmp_block = ot_output[cur_level][index];
-		memcpy(tmp_int, &tmp_block, sizeof(tmp_int));
-		src[0] ^= tmp_int[0];
-		src[1] ^= tmp_int[1];
-		if(switched[cur_level][index] == 1) {
-			swap(src[0], src[1]);
-		}
-
-
-		tmp_block = ot_output[cur_level + 1][index];
-		memcpy(tmp_int, &tmp_block, sizeof(tmp_int));
-		src[1] ^= tmp_int[0];
-		src[2] ^= tmp_int[1];
-		if(switched[cur_level + 1][index] == 1) {
-			swap(src[1], src[2]);
-		}
-
-
-		tmp_block = ot_output[cur_level + 2][index];
-		memcpy(tmp_int, &tmp_block, sizeof(tmp_int));
-		src[0] ^= tmp_int[0];
-		src[1] ^= tmp_int[1];
-		if(switched[cur_level + 2][index] == 1) {
-			swap(src[0], src[1]);
-		}
-		return;
-	}
-	
-	levels = 2 * n - 1;
-	
-	for (i = 0; i < values - 1; i += 2) {
-		int s = switched[cur_level][index + i / 2];
-		
-		tmp_block = ot_output[cur_level][index+i/2];
-		memcpy(tmp_int, &tmp_block, sizeof(tmp_int));
-
-		src[i] ^= tmp_int[0];
-		src[i ^ 1] ^= tmp_int[1];
-
-		for (j = 0; j < 2; j++) {
-			x = shuffle((i | j) ^ s, n);
-			if (x < values / 2) {
-				bottom1.push_back(src[i | j]);
-			} else {
-				top1.push_back(src[i | j]);
-			} 
-		}
-	}
-
-	if (values & 1){
-		top1.push_back(src[values-1]);
-	}
-
-	masked_eval(n - 1, cur_level + 1, index, bottom1, ot_output);
-	masked_eval(n - 1, cur_level + 1, index + values / 4, top1, ot_output);
-
-
-	for (i = 0; i < values - 1; i += 2) {
-		s = switched[cur_level + levels - 1][index + i / 2];
-
-		for (j = 0; j < 2; ++j) {
-			x = shuffle((i | j) ^ s, n);
-			if (x < values / 2) {
-				src[i | j] = bottom1[x]; 
-			} else {
-				src[i | j] = top1[i/2];
-			}
-		}
-
-		tmp_block = ot_output[cur_level + levels - 1][index+i/2];
-		memcpy(tmp_int, &tmp_block, sizeof(tmp_int));
-		src[i] ^= tmp_int[s];
-		src[i ^ 1] ^= tmp_int[1-s];  
-	}
+// Going down, each subnetwork splits its wires into its halves by its first
+// column, the ones on 2 or 3 wires are applied whole. Going back up, each
+// merges its halves by its last column. A layer's subnetworks run in
+// parallel, reading one buffer and writing the other.
+template <typename F>
+void Benes::eval(vector<uint64_t> &src, F apply) const {
+    assert(int(src.size()) == values_);
+    if (layers_.empty()) return;
+
+    vector<uint64_t> tmp(values_);
+    uint64_t *bufs[2] = {src.data(), tmp.data()};
+
+    for (std::size_t l = 0; l < layers_.size(); ++l) {
+        const auto &layer = layers_[l];
+        uint64_t *cur = bufs[l & 1], *halves = bufs[(l + 1) & 1];
+
+        #pragma omp parallel for schedule(dynamic, 64) if (layer.size() > 1)
+        for (std::size_t t = 0; t < layer.size(); ++t) {
+            const Subnet &s = layer[t];
+            uint64_t *w = cur + s.offset, *h = halves + s.offset;
+            const int level = l, half = s.values / 2;
+
+            if (s.values == 2) {
+                apply(s.n == 1 ? level : level + 1, s.index, w[0], w[1]);
+                continue;
+            }
+            if (s.values == 3) {
+                apply(level, s.index, w[0], w[1]);
+                apply(level + 1, s.index, w[1], w[2]);
+                apply(level + 2, s.index, w[0], w[1]);
+                continue;
+            }
+
+            for (int k = 0; k < half; ++k) {
+                uint64_t a = w[2 * k], b = w[2 * k + 1];
+                apply(level, s.index + k, a, b);
+                h[k] = a;
+                h[half + k] = b;
+            }
+            if (s.values & 1) {
+                h[s.values - 1] = w[s.values - 1];
+            }
+        }
+    }
 
-	int idx =int(ceil(values * 0.5));
-	if (values & 1) {
-		src[values - 1] = top1[idx - 1];
-	}
+    for (std::size_t l = layers_.size(); l-- > 0;) {
+        const auto &layer = layers_[l];
+        uint64_t *cur = bufs[l & 1], *halves = bufs[(l + 1) & 1];
+
+        #pragma omp parallel for schedule(dynamic, 64) if (layer.size() > 1)
+        for (std::size_t t = 0; t < layer.size(); ++t) {
+            const Subnet &s = layer[t];
+            if (s.values <= 3) continue;
+
+            uint64_t *w = cur + s.offset, *h = halves + s.offset;
+            const int last = l + 2 * s.n - 2, half = s.values / 2;
+            for (int k = 0; k < half; ++k) {
+                uint64_t a = h[k], b = h[half + k];
+                apply(last, s.index + k, a, b);
+                w[2 * k] = a;
+                w[2 * k + 1] = b;
+            }
+            if (s.values & 1) {
+                w[s.values - 1] = h[s.values - 1];
+            }
+        }
+    }
+}
 
-  
+void Benes::masked_eval(vector<uint64_t> &src, const vector<osuCrypto::block> &ot_output) const {
+    assert(ot_output.size() >= switched_.size());
+    const std::size_t half = values_ / 2;
+
+    eval(src, [&](int level, int index, uint64_t &a, uint64_t &b) {
+        uint64_t mask[2];
+        to_words(ot_output[level * half + index], mask);
+        a ^= mask[0];
+        b ^= mask[1];
+        if (switched(level, index)) {
+            std::swap(a, b);
+        }
+    });
 }
 
+void Benes::gen_corr_block(vector<uint64_t> &masks, const vector<std::array<osuCrypto::block, 2>> &ot_msg,
+                           vector<osuCrypto::block> &correction_blocks) const {
+    assert(ot_msg.size() >= switched_.size() && correction_blocks.size() >= switched_.size());
+    const std::size_t half = values_ / 2;
+
+    eval(masks, [&](int level, int index, uint64_t &a, uint64_t &b) {
+        std::size_t i = level * half + index;
+        uint64_t M0[2], M1[2];
+        to_words(ot_msg[i][0], M0);
+        to_words(ot_msg[i][1], M1);
+
+        uint64_t w0 = M0[0] ^ a, w1 = M0[1] ^ b;
+        correction_blocks[i] = osuCrypto::toBlock(M1[1] ^ b ^ w0, M1[0] ^ a ^ w1);
+        a = w0;
+        b = w1;
+    });
+}
 
-osuCrypto::BitVector retrieve_switches(int values) {
-	int n = int(ceil(log2(values)));
-	int levels = 2 * n - 1;
-	osuCrypto::BitVector switches(levels * (values / 2));
-	for (int i = 0; i < levels; i++) {
-		for (int j = 0; j < values/2; j++) {
-			switches[i * (values/2) + j] = switched[i][j];
-		}
+osuCrypto::BitVector Benes::retrieve_switches() const {
+	osuCrypto::BitVector switches(switched_.size());
+	for (std::size_t i = 0; i < switched_.size(); i++) {
+		switches[i] = switched_[i];
 	}
 	return switches;
-} 
+}
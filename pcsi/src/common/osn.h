@@ -1,14 +1,75 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
 #include <vector>
 
 #include "libOTe/Base/BaseOT.h"
 
+// Benes network on values wires, routed by the OSN receiver. Subnetwork s
+// of a network on v wires with n = ceil(log2(v)) spans 2n - 1 switch
+// columns: its first and last columns pair the wires (2k, 2k + 1), the
+// bottom half of the wires goes through a subnetwork on v / 2 wires and the
+// top half, with the odd wire if any, through one on v - v / 2 wires. The
+// switches of every column are numbered from the bottom.
+//
+// All state lives in the instance, so independent networks can be routed
+// concurrently. The subnetworks of a layer are routed in parallel.
+class Benes {
+    public:
+        explicit Benes(int values);
 
-void initialize(int values, int levels);
+        int values() const { return values_; }
+        int levels() const { return levels_; }
 
-void route(int n, int cue_level, int index, const std::vector<int> &src, const std::vector<int> &dest);
+        // sets the switches so that output i receives the input j with
+        // src[j] == dest[i].
+        void route(const std::vector<int> &src, const std::vector<int> &dest);
 
-void masked_eval (int n, int cur_level, int index, std::vector<uint64_t> &src, std::vector<std::vector<osuCrypto::block>> &ot_output);
+        // applies the switches to src, xoring the inputs of switch index of
+        // a level with ot_output[level * (values / 2) + index] first.
+        void masked_eval(std::vector<uint64_t> &src, const std::vector<osuCrypto::block> &ot_output) const;
 
-osuCrypto::BitVector retrieve_switches(int values);
\ No newline at end of file
+        // the OSN sender's side: masks the wires of every switch with the
+        // first of its ot_msg and sets the correction that turns the second
+        // into the swapped masks. Every switch is applied as not swapped, so
+        // masks ends up as the masks on the outputs.
+        void gen_corr_block(std::vector<uint64_t> &masks, const std::vector<std::array<osuCrypto::block, 2>> &ot_msg,
+                            std::vector<osuCrypto::block> &correction_blocks) const;
+
+        // the switches, level by level.
+        osuCrypto::BitVector retrieve_switches() const;
+
+    private:
+        struct Subnet {
+            int offset;  // first wire
+            int values;
+            int n;
+            int index;   // first switch in its columns
+        };
+
+        void route_subnet(int level, const Subnet &s, const int *perm, int *next);
+
+        // runs the wires of src through the network, calling
+        // apply(level, index, a, b) on the two inputs of each switch.
+        template <typename F>
+        void eval(std::vector<uint64_t> &src, F apply) const;
+
+        void set_switch(int level, int index, bool s) { switched_[std::size_t(level) * (values_ / 2) + index] = s; }
+        bool switched(int level, int index) const { return switched_[std::size_t(level) * (values_ / 2) + index]; }
+
+        int values_;
+        int n_;
+        int levels_;
+
+        // layers_[l] holds the subnetworks whose first column is l.
+        std::vector<std::vector<Subnet>> layers_;
+        std::vector<uint8_t> switched_;
+
+        // routing scratch, indexed by wire. A subnetwork only touches the
+        // wires it spans. perm_[l & 1] holds, for each output of a
+        // subnetwork of layer l, the input it receives.
+        std::vector<int> perm_[2];
+        std::vector<int> inv_perm_;
+        std::vector<signed char> path_;
+};
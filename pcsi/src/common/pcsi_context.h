@@ -1,7 +1,52 @@
 #pragma once
 
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "cryptoTools/Network/Channel.h"
+#include "cryptoTools/Network/IOService.h"
+#include "cryptoTools/Network/Session.h"
+
+#include "ENCRYPTO_utils/typedefs.h"
+
 namespace PCSI {
 
+// The connection of one party for the whole protocol: a single session on
+// ctx.port, which the server listens on, with one channel per phase so
+// that the messages of different phases never interleave. The channels
+// are closed, after their pending sends, when the last context holding the
+// network goes away.
+struct PCSINetwork {
+    PCSINetwork(const std::string& ip, uint16_t port, uint32_t role)
+        : session(ios, ip, port,
+                  role == SERVER ? osuCrypto::SessionMode::Server : osuCrypto::SessionMode::Client, "pcsi"),
+          osn(session.addChannel("osn", "osn")),
+          oprf(session.addChannel("oprf", "oprf")),
+          poly(session.addChannel("poly", "poly")),
+          eq(session.addChannel("eq", "eq")),
+          sum(session.addChannel("sum", "sum")) {}
+
+    ~PCSINetwork() {
+        osn.close();
+        oprf.close();
+        poly.close();
+        eq.close();
+        sum.close();
+        session.stop();
+        ios.stop();
+    }
+
+    osuCrypto::IOService ios;
+    osuCrypto::Session session;
+
+    osuCrypto::Channel osn;    // random OTs and corrections of the OSN, and its masked input
+    osuCrypto::Channel oprf;   // KKRT OPRF
+    osuCrypto::Channel poly;   // OPPRF polynomials
+    osuCrypto::Channel eq;     // shares of the equality test
+    osuCrypto::Channel sum;    // OTs of the sum
+};
+
 struct PCSIContext {
     std::string ip;
     uint16_t port;
@@ -17,6 +62,17 @@ struct PCSIContext {
     uint64_t mega_bins_num;
 
     const uint64_t max_bitlen = 61;
+
+    // set up by connect(), then reused by every phase and every exec.
+    std::shared_ptr<PCSINetwork> network;
 };
 
-}
\ No newline at end of file
+// the network of ctx, connecting on the first call.
+inline PCSINetwork& connect(PCSIContext& ctx) {
+    if (!ctx.network) {
+        ctx.network = std::make_shared<PCSINetwork>(ctx.ip, ctx.port, ctx.role);
+    }
+    return *ctx.network;
+}
+
+}
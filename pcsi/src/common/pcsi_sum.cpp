@@ -94,208 +94,22 @@ void interpolate_poly_with_dummy(std::vector<uint64_t>::iterator poly_offset,
 
 void interpolate_poly(std::vector<uint64_t>& polys, std::vector<uint64_t>& X, std::vector<std::vector<uint64_t>>& Y, PCSIContext& ctx) {
     std::size_t bins_num = Y.size();
-    std::size_t Y_offset = 0;
     std::size_t bin_num_in_mega_bin = ceil_divide(bins_num, ctx.mega_bins_num);
 
-    for (auto i = 0ull; i < ctx.mega_bins_num; i++) {
-        auto poly = polys.begin() + ctx.poly_size * i;
-        auto x = X.begin() + bin_num_in_mega_bin * i;
-        auto y = Y.begin() + bin_num_in_mega_bin * i;
-
-        if ((Y_offset + bin_num_in_mega_bin) > Y.size()) {
-            auto overflow = (Y_offset + bin_num_in_mega_bin) % Y.size();
-            bin_num_in_mega_bin -= overflow;
-        }
-
-        interpolate_poly_with_dummy(poly, x, y, bin_num_in_mega_bin, ctx);
-        Y_offset += bin_num_in_mega_bin;
-    }
-
-    assert(Y_offset == Y.size());
-}
-
-void gen_corr_block(int n, int bins, int cur_level, int index, std::vector<uint64_t> &src, std::vector<std::array<osuCrypto::block,2>> &ot_output, std::vector<osuCrypto::block> &correction_blocks) {
-
-  int levels, i, j, x, s;
-  std::vector<uint64_t> bottom1;
-  std::vector<uint64_t> top1;
-  int values = src.size();
-  uint64_t temp;
-
-  uint64_t m0, m1, w0, w1, M0[2], M1[2], corr_mesg[2];
-  osuCrypto::block corr_block, temp_block;
-
-
-  if (values == 2) {
-    if (n == 1) {
-
-      m0 = src[0];
-      m1 = src[1];
-      temp_block = ot_output[cur_level*(bins/2)+index][0];
-      memcpy(M0, &temp_block, sizeof(M0)); 
-      w0 = M0[0] ^ m0;
-      w1 = M0[1] ^ m1;
-      temp_block = ot_output[cur_level*(bins/2)+index][1];
-      memcpy(M1, &temp_block, sizeof(M1)); 
-      corr_mesg[0] = M1[0] ^ m0 ^ w1;
-      corr_mesg[1] = M1[1] ^ m1 ^ w0;
-      correction_blocks[cur_level*(bins/2)+index] = osuCrypto::toBlock(corr_mesg[1], corr_mesg[0]); 
-      M1[0] = m0 ^ w1;
-      M1[1] = m1 ^ w0;
-      ot_output[cur_level*(bins/2)+index][1] = osuCrypto::toBlock(M1[1],M1[0]);
-      src[0] = w0;
-      src[1] = w1;
-
-
-    }
-    else {
-      m0 = src[0];
-      m1 = src[1];
-      temp_block = ot_output[(cur_level+1)*(bins/2)+index][0];
-      memcpy(M0, &temp_block, sizeof(M0)); 
-      w0 = M0[0] ^ m0;
-      w1 = M0[1] ^ m1;
-      temp_block = ot_output[(cur_level+1)*(bins/2)+index][1];
-      memcpy(M1, &temp_block, sizeof(M1)); 
-      corr_mesg[0] = M1[0] ^ m0 ^ w1;
-      corr_mesg[1] = M1[1] ^ m1 ^ w0;
-      correction_blocks[(cur_level+1)*(bins/2)+index] = osuCrypto::toBlock(corr_mesg[1], corr_mesg[0]); 
-      M1[0] = m0 ^ w1;
-      M1[1] = m1 ^ w0;
-      ot_output[(cur_level+1)*(bins/2)+index][1] = osuCrypto::toBlock(M1[1],M1[0]);
-      src[0] = w0;
-      src[1] = w1;
-
+    // mega-bin i holds bins [i * bin_num_in_mega_bin, ...), the last one may
+    // be short. Its polynomial does not depend on the others, so they are
+    // interpolated in parallel.
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (std::size_t i = 0; i < ctx.mega_bins_num; i++) {
+        auto begin = std::min(bin_num_in_mega_bin * i, bins_num);
+        auto end = std::min(begin + bin_num_in_mega_bin, bins_num);
 
+        auto poly = polys.begin() + ctx.poly_size * i;
+        interpolate_poly_with_dummy(poly, X.cbegin() + begin, Y.cbegin() + begin, end - begin, ctx);
     }
-    return; 
-  }
-
-  if (values == 3) {
-      
-      m0 = src[0];
-      m1 = src[1];
-      temp_block = ot_output[cur_level*(bins/2)+index][0];
-      memcpy(M0, &temp_block, sizeof(M0)); 
-      w0 = M0[0] ^ m0;
-      w1 = M0[1] ^ m1;
-      temp_block = ot_output[cur_level*(bins/2)+index][1];
-      memcpy(M1, &temp_block, sizeof(M1)); 
-      corr_mesg[0] = M1[0] ^ m0 ^ w1;
-      corr_mesg[1] = M1[1] ^ m1 ^ w0;
-      correction_blocks[cur_level*(bins/2)+index] = osuCrypto::toBlock(corr_mesg[1], corr_mesg[0]); 
-      M1[0] = m0 ^ w1;
-      M1[1] = m1 ^ w0;
-      ot_output[cur_level*(bins/2)+index][1] = osuCrypto::toBlock(M1[1],M1[0]);
-      src[0] = w0;
-      src[1] = w1;
-
-
-
-
-      m0 = src[1];
-      m1 = src[2];
-      temp_block = ot_output[(cur_level+1)*(bins/2)+index][0];
-      memcpy(M0, &temp_block, sizeof(M0)); 
-      w0 = M0[0] ^ m0;
-      w1 = M0[1] ^ m1;
-      temp_block = ot_output[(cur_level+1)*(bins/2)+index][1];
-      memcpy(M1, &temp_block, sizeof(M1)); 
-      corr_mesg[0] = M1[0] ^ m0 ^ w1;
-      corr_mesg[1] = M1[1] ^ m1 ^ w0;
-      correction_blocks[(cur_level+1)*(bins/2)+index] = osuCrypto::toBlock(corr_mesg[1], corr_mesg[0]); 
-      M1[0] = m0 ^ w1;
-      M1[1] = m1 ^ w0;
-      ot_output[(cur_level+1)*(bins/2)+index][1] = osuCrypto::toBlock(M1[1],M1[0]);
-      src[1] = w0;
-      src[2] = w1;
-
-      
-      m0 = src[0];
-      m1 = src[1];
-      temp_block = ot_output[(cur_level+2)*(bins/2)+index][0];
-      memcpy(M0, &temp_block, sizeof(M0)); 
-      w0 = M0[0] ^ m0;
-      w1 = M0[1] ^ m1;
-      temp_block = ot_output[(cur_level+2)*(bins/2)+index][1];
-      memcpy(M1, &temp_block, sizeof(M1)); 
-      corr_mesg[0] = M1[0] ^ m0 ^ w1;
-      corr_mesg[1] = M1[1] ^ m1 ^ w0;
-      correction_blocks[(cur_level+2)*(bins/2)+index] = osuCrypto::toBlock(corr_mesg[1], corr_mesg[0]); 
-      M1[0] = m0 ^ w1;
-      M1[1] = m1 ^ w0;
-      ot_output[(cur_level+2)*(bins/2)+index][1] = osuCrypto::toBlock(M1[1],M1[0]);
-      src[0] = w0;
-      src[1] = w1;
-
-    return;
-  }
-  
-  levels = 2 * n - 1;
-   
-  for (i = 0; i < values-1; i += 2) {
-
-
-      m0 = src[i];
-      m1 = src[i ^ 1];
-      temp_block = ot_output[(cur_level)*(bins/2)+index+i/2][0];
-      memcpy(M0, &temp_block, sizeof(M0)); 
-      w0 = M0[0] ^ m0;
-      w1 = M0[1] ^ m1;
-      temp_block = ot_output[(cur_level)*(bins/2)+index+i/2][1];
-      memcpy(M1, &temp_block, sizeof(M1)); 
-      corr_mesg[0] = M1[0] ^ m0 ^ w1;
-      corr_mesg[1] = M1[1] ^ m1 ^ w0;
-      correction_blocks[(cur_level)*(bins/2)+index+i/2] = osuCrypto::toBlock(corr_mesg[1], corr_mesg[0]); 
-      M1[0] = m0 ^ w1;
-      M1[1] = m1 ^ w0;
-      ot_output[(cur_level)*(bins/2)+index+i/2][1] = osuCrypto::toBlock(M1[1],M1[0]);
-      src[i] = w0;
-      src[i ^ 1] = w1;
-
-      bottom1.push_back(src[i]); 
-      top1.push_back(src[i^1]);
-    }
-
-  if (values % 2 == 1){
-    top1.push_back(src[values-1]);
-  }
-
-
-  gen_corr_block(n - 1, bins, cur_level + 1, index, bottom1, ot_output, correction_blocks);
-  gen_corr_block(n - 1, bins, cur_level + 1, index + values / 4, top1, ot_output, correction_blocks);
-
-
-  for (i = 0; i < values-1; i += 2) {
-
-
-      m1 = top1[i/2];
-      m0 = bottom1[i/2];
-      temp_block = ot_output[(cur_level + levels - 1)*(bins/2)+index+i/2][0];
-      memcpy(M0, &temp_block, sizeof(M0)); 
-      w0 = M0[0] ^ m0;
-      w1 = M0[1] ^ m1;
-      temp_block = ot_output[(cur_level + levels - 1)*(bins/2)+index+i/2][1];
-      memcpy(M1, &temp_block, sizeof(M1)); 
-      corr_mesg[0] = M1[0] ^ m0 ^ w1;
-      corr_mesg[1] = M1[1] ^ m1 ^ w0;
-      correction_blocks[(cur_level + levels - 1)*(bins/2)+index+i/2] = osuCrypto::toBlock(corr_mesg[1], corr_mesg[0]); 
-      M1[0] = m0 ^ w1;
-      M1[1] = m1 ^ w0;
-      ot_output[(cur_level + levels - 1)*(bins/2)+index+i/2][1] = osuCrypto::toBlock(M1[1],M1[0]);
-      src[i] = w0;
-      src[i ^ 1] = w1;
-
-  }
-
-  int idx =int(ceil(values*0.5));
-  if (values % 2 == 1) {
-    src[values-1] = top1[idx-1];
-  }
-
 }
 
-std::vector<osuCrypto::block> recv_osn(std::vector<int>& dest, int bins, PCSIContext& ctx) {
+std::vector<osuCrypto::block> recv_osn(Benes& benes, std::vector<int>& dest, int bins, PCSIContext& ctx) {
     // F_osn, alice as receiver, with input Pi
     std::vector<int> src(bins);
     for (int i = 0; i < bins; i++) {
@@ -315,24 +129,22 @@ std::vector<osuCrypto::block> recv_osn(std::vector<int>& dest, int bins, PCSICon
     } 
     // std::cout << RESET << std::endl;
 
-    int n = int(ceil(log2(bins)));
     // generate transposition
     std::cout << "start route" << std::endl;
-    route(n, 0, 0, src, dest);
+    benes.route(src, dest);
     // std::cout << "finish route" << std::endl;
     // the switch set is the choices in ot
-    osuCrypto::BitVector choices = retrieve_switches(bins);
+    osuCrypto::BitVector choices = benes.retrieve_switches();
 
 
     // std::cout << "finish get" << std::endl;
 
     // process ot
-    osuCrypto::IOService ios;
-    std::string name = "pcsi";
+    auto& osn_recv_chl = connect(ctx).osn;
     std::vector<osuCrypto::block> recv_msg(choices.size());
     std::vector<osuCrypto::block> recv_corr(choices.size());
 
-    rot_recv(choices, recv_msg, ctx);
+    rot_recv(choices, recv_msg, osn_recv_chl);
     // std::ofstream rotout;
     // rotout.open("./rotout", std::ios::out);
     // for (int i = 0; i < choices.size(); i++) {
@@ -345,15 +157,12 @@ std::vector<osuCrypto::block> recv_osn(std::vector<int>& dest, int bins, PCSICon
     // getchar();
 
 
-    osuCrypto::Session ep(ios, ctx.ip, ctx.port + 100, osuCrypto::SessionMode::Server, name);
-    auto osn_recv_chl = ep.addChannel(name, name);
-
     osn_recv_chl.recv(recv_corr.data(), recv_corr.size()); // this statement error
 
     std::cout << "finish ot" << std::endl;
     // consider switch
     uint64_t tmp_msg[2], tmp_corr[2];
-    for (int i = 0; i < recv_msg.size(); i++) {
+    for (std::size_t i = 0; i < recv_msg.size(); i++) {
         // choices means switches
         if (choices[i]) {
             memcpy(tmp_corr, &recv_corr[i], sizeof(tmp_corr)); 
@@ -370,12 +179,11 @@ std::vector<osuCrypto::block> recv_osn(std::vector<int>& dest, int bins, PCSICon
 // SELECT SUM(A.VAL) FROM A UNION B
 // SUM(A.VAL) + SUM(B.VAL) - SUM(A intersection B.VAL)
 
-std::vector<std::vector<uint64_t>> send_osn(int bins, PCSIContext& ctx) {
-    int n = int(ceil(log2(bins)));   // bins = 10, n = 4
-    int levels = 2 * n - 1;   // 7
-    int switch_num = levels * (bins / 2); // 7*5 = 35
+std::vector<std::array<uint64_t, 2>> send_osn(int bins, PCSIContext& ctx) {
+    Benes benes(bins);   // bins = 10, 7 levels
+    std::size_t switch_num = std::size_t(benes.levels()) * (bins / 2); // 7*5 = 35
     std::vector<uint64_t> masks(bins);
-    std::vector<std::vector<uint64_t>> mat_masks(bins);
+    std::vector<std::array<uint64_t, 2>> mat_masks(bins);
 
 
     osuCrypto::PRNG prng(_mm_set_epi32(4253233465, 334565, 0, 235));
@@ -383,27 +191,23 @@ std::vector<std::vector<uint64_t>> send_osn(int bins, PCSIContext& ctx) {
     for (int i = 0; i < bins; i++) {
         uint64_t r = prng.get<uint64_t>();
         masks[i] = r;
-        mat_masks[i].push_back(r);  // think;
+        mat_masks[i][0] = r;  // think;
     }
 
     std::vector<std::array<osuCrypto::block, 2>> ot_msg(switch_num);  // 电路中输入、输出、门的个数
     // ot_msg is valued in rot, it is outPut;
-    rot_send(ot_msg, ctx);    // this is OT , ot_msg is output;
+    auto& osn_send_chl = connect(ctx).osn;
+    rot_send(ot_msg, osn_send_chl);    // this is OT , ot_msg is output;
 
     std::vector<osuCrypto::block> corr_blocks(switch_num);
 
-    gen_corr_block((unsigned int)n, bins, 0, 0, masks, ot_msg, corr_blocks);
-
-    osuCrypto::IOService ios;
-    std::string name = "pcsi";
+    benes.gen_corr_block(masks, ot_msg, corr_blocks);
 
-    osuCrypto::Session ep(ios, ctx.ip, ctx.port + 100, osuCrypto::SessionMode::Client, name); 
-    auto osn_send_chl = ep.addChannel(name, name);
     // osn_send_chl.asyncSend(corr_blocks);
     osn_send_chl.send(corr_blocks);
 
     for (int i = 0; i < bins; i++) {
-        mat_masks[i].push_back(masks[i]);
+        mat_masks[i][1] = masks[i];
     }
     return mat_masks;
 }
@@ -425,7 +229,7 @@ std::vector<uint64_t> client_opprf(const std::vector<uint64_t>& eles, std::vecto
     // getchar();
 
     // 2. oprf
-    std::vector<uint64_t> masks = oprf_receiver(cuckoo_table, ctx);
+    std::vector<uint64_t> masks = oprf_receiver(cuckoo_table, connect(ctx).oprf);
 
     // std::ofstream oprfout;
     // oprfout.open("./fout", std::ios::out);
@@ -440,10 +244,7 @@ std::vector<uint64_t> client_opprf(const std::vector<uint64_t>& eles, std::vecto
     std::cout << "[client]ctx.role" << ctx.role<<std::endl;
 
 
-    std::string pcsi_csocket_name = "pcsi_csocket";
-    osuCrypto::IOService ios;
-    osuCrypto::Session ep(ios, ctx.ip, ctx.port + 300, osuCrypto::SessionMode::Client, pcsi_csocket_name);
-    auto client_chl = ep.addChannel(pcsi_csocket_name, pcsi_csocket_name);
+    auto& client_chl = connect(ctx).poly;
     //std::unique_ptr<CSocket> sock = create_socket(ctx.ip, ctx.port, static_cast<e_role>(ctx.role));
 
     const auto bin_num_in_mega_bin = ceil_divide(ctx.bins_num, ctx.mega_bins_num);
@@ -473,11 +274,16 @@ std::vector<uint64_t> client_opprf(const std::vector<uint64_t>& eles, std::vecto
     // std::ofstream yout;
     // yout.open("./yout", std::ios::out);
 
-    for (auto i = 0; i < X.size(); i++) {
-        auto p = i / bin_num_in_mega_bin;
-        // ZpLongEle tmp(i);
-        Poly::eval(Y.at(i), polys.at(p), X.at(i));
-        // yout << X.at(i).ele << " " << Y.at(i).ele << std::endl;
+    // the bins of a mega-bin are evaluated together against its polynomial.
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (std::size_t p = 0; p < ctx.mega_bins_num; p++) {
+        auto begin = std::min<std::size_t>(p * bin_num_in_mega_bin, X.size());
+        auto end = std::min<std::size_t>(begin + bin_num_in_mega_bin, X.size());
+        if (begin == end) continue;
+
+        std::vector<ZpLongEle> x(X.begin() + begin, X.begin() + end), y;
+        Poly::multi_eval(y, polys.at(p), x);
+        std::copy(y.begin(), y.end(), Y.begin() + begin);
     }
     // yout.close();
 
@@ -501,7 +307,7 @@ std::vector<uint64_t> server_opprf(const std::vector<uint64_t>& eles, PCSIContex
     // getchar();
 
     auto simple_table = table.AsRaw2DVector();
-    auto masks = oprf_sender(simple_table, ctx);
+    auto masks = oprf_sender(simple_table, connect(ctx).oprf);
 
     // std::ofstream oprfout;
     // oprfout.open("./prfout", std::ios::out);
@@ -562,13 +368,10 @@ std::vector<uint64_t> server_opprf(const std::vector<uint64_t>& eles, PCSIContex
     std::cout << "[server] role: " << ctx.role<<std::endl;
     //std::unique_ptr<CSocket> sock = create_socket(ctx.ip, ctx.port, static_cast<e_role>(ctx.role));
 
-    std::string pcsi_csocket_name = "pcsi_csocket";
-    osuCrypto::IOService ios;
-    osuCrypto::Session ep(ios, ctx.ip, ctx.port + 300, osuCrypto::SessionMode::Server, pcsi_csocket_name);
-    auto server_chl = ep.addChannel(pcsi_csocket_name, pcsi_csocket_name);
-
+    auto& server_chl = connect(ctx).poly;
 
-    server_chl.asyncSend((uint8_t *)polys.data(), ctx.mega_bins_num * ctx.poly_bytelength);
+    // the channel outlives polys, so it takes the buffer.
+    server_chl.asyncSend(std::move(polys));
     //sock->Send((uint8_t *)polys.data(), ctx.mega_bins_num * ctx.poly_bytelength); // 已测试，不是sock的问题
     //sock->Close();
 
@@ -579,6 +382,9 @@ std::vector<uint64_t> server_opprf(const std::vector<uint64_t>& eles, PCSIContex
 
 uint64_t exec(const std::vector<uint64_t>& inputs, PCSIContext& ctx, const std::vector<uint64_t>& data) {
     // network
+    // connects once for all phases, the sessions of both parties meet
+    // while the first phase computes.
+    connect(ctx);
     std::cout << "ctx.role:" <<ctx.role << std::endl;
     std::cout << "CLIENT:" <<CLIENT<< std::endl;
     std::cout << "SERVER:" <<SERVER<< std::endl;
@@ -594,13 +400,11 @@ uint64_t exec(const std::vector<uint64_t>& inputs, PCSIContext& ctx, const std::
         // 1. osn preprocessing 
         // 1.1 initial paramters
         std::vector<int> dest(bins);
-        int n = int(ceil(log2(bins)));
-        int levels = 2 * n - 1;
-        initialize(bins, levels);
+        Benes benes(bins);
 	    std::cout << "[client]finish 1.1" << std::endl;
         // 1.2 processing offline osn
         std::vector<osuCrypto::block> ot_output;
-        ot_output = recv_osn(dest, bins, ctx); // ****suppose it is correct
+        ot_output = recv_osn(benes, dest, bins, ctx); // ****suppose it is correct
         // std::ofstream permout;
         // permout.open("./permout", std::ios::out);
         // for (int i = 0; i < dest.size(); i++) {
@@ -634,21 +438,11 @@ uint64_t exec(const std::vector<uint64_t>& inputs, PCSIContext& ctx, const std::
         // }
         // tout.close();
 
-        std::string name = "pcsi";
-        osuCrypto::IOService ios;
-        osuCrypto::Session ep(ios, ctx.ip, ctx.port + 20, osuCrypto::SessionMode::Server, name);
-        auto recv_chl = ep.addChannel(name, name);
+        auto& recv_chl = connect(ctx).osn;
         std::vector<uint64_t> input_vec(bins);
         recv_chl.recv(input_vec.data(), input_vec.size());
 
-        std::vector<std::vector<osuCrypto::block>> mat_ot_output(levels, std::vector<osuCrypto::block>(bins));
-        int index = 0;
-        for (int i = 0; i < levels; i++) {
-            for (int j = 0; j < bins / 2; j++) {
-                mat_ot_output[i][j] = ot_output[index++];
-            }
-        }
-        masked_eval(n, 0, 0, input_vec, mat_ot_output);
+        benes.masked_eval(input_vec, ot_output);
 
         // std::ofstream aout;
         // aout.open("./aout", std::ios::out);
@@ -665,9 +459,7 @@ uint64_t exec(const std::vector<uint64_t>& inputs, PCSIContext& ctx, const std::
 
 
         // 4. send the result to process equality test
-        std::string name_ = "pcsi";
-        osuCrypto::Session ep_(ios, ctx.ip, ctx.port + 30, osuCrypto::SessionMode::Server, name_);
-        auto send_chl_eq = ep_.addChannel(name_, name_);
+        auto& send_chl_eq = connect(ctx).eq;
         std::vector<uint64_t> sets_eq;
         for (int i = 0; i < bins; i++) {
             sets_eq.push_back(shuffled_sets[i] ^ input_vec[i]);
@@ -680,7 +472,7 @@ uint64_t exec(const std::vector<uint64_t>& inputs, PCSIContext& ctx, const std::
         // }
         // axout.close();
 
-        send_chl_eq.asyncSend(sets_eq);
+        send_chl_eq.asyncSend(std::move(sets_eq));
 	    std::cout << "[client]finish 4" << std::endl;
 
 
@@ -724,7 +516,7 @@ uint64_t exec(const std::vector<uint64_t>& inputs, PCSIContext& ctx, const std::
             msg[i].push_back(osuCrypto::toBlock(0, shuffled_table[i] - r));
             output += r;
         }
-        ot_send(msg, ctx);
+        ot_send(msg, connect(ctx).sum);
 
     } 
     
@@ -749,17 +541,14 @@ uint64_t exec(const std::vector<uint64_t>& inputs, PCSIContext& ctx, const std::
     else {
         // offline osn
         // server is receiver, have func, not data;
-        std::vector<std::vector<uint64_t>> pre_masks;
+        std::vector<std::array<uint64_t, 2>> pre_masks;
         pre_masks = send_osn(bins, ctx);
 
         // pcsi preprocessing
         sets = server_opprf(input_bak, ctx);
 
         // online osn
-        osuCrypto::IOService ios;
-        std::string name = "pcsi";
-        osuCrypto::Session ep(ios, ctx.ip, ctx.port + 20, osuCrypto::SessionMode::Client, name);
-        auto send_chl = ep.addChannel(name, name);
+        auto& send_chl = connect(ctx).osn;
         std::vector<uint64_t> output_masks, benes_input;
 
         for (int i = 0; i < sets.size(); i++) {
@@ -768,7 +557,7 @@ uint64_t exec(const std::vector<uint64_t>& inputs, PCSIContext& ctx, const std::
         for (int i = 0; i < bins; i++) {
             benes_input.push_back(pre_masks[i][0]);
         }
-        send_chl.asyncSend(benes_input);
+        send_chl.asyncSend(std::move(benes_input));
         for (int i = 0; i < ctx.bins_num; i++) {
             output_masks.push_back(pre_masks[i][1]);
         }
@@ -793,9 +582,7 @@ uint64_t exec(const std::vector<uint64_t>& inputs, PCSIContext& ctx, const std::
 
 
         // equality test
-        std::string name_ = "pcsi";
-        osuCrypto::Session ep_(ios, ctx.ip, ctx.port + 30, osuCrypto::SessionMode::Client, name_);
-        auto recv_chl_eq = ep_.addChannel(name_, name_);
+        auto& recv_chl_eq = connect(ctx).eq;
         std::vector<uint64_t> sets_eq(bins);
         recv_chl_eq.recv(sets_eq.data(), sets_eq.size());
 
@@ -813,7 +600,7 @@ uint64_t exec(const std::vector<uint64_t>& inputs, PCSIContext& ctx, const std::
 
         // do sum
         std::vector<osuCrypto::block> recv_msg(char_vec.size());
-        ot_recv(char_vec, recv_msg, ctx);
+        ot_recv(char_vec, recv_msg, connect(ctx).sum);
         uint64_t ot_msg[2];
         for (int i=0; i < recv_msg.size(); ++i) {
             memcpy(ot_msg, &recv_msg[i], sizeof(ot_msg)); 
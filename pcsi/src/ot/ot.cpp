@@ -21,7 +21,7 @@ using namespace osuCrypto;
 
 namespace PCSI {
 
-std::vector<uint64_t> oprf_receiver(const std::vector<uint64_t>& in, PCSI::PCSIContext& context) {
+std::vector<uint64_t> oprf_receiver(const std::vector<uint64_t>& in, osuCrypto::Channel& recv_chl) {
     std::vector<uint64_t> out;
     out.reserve(in.size());
 
@@ -31,12 +31,6 @@ std::vector<uint64_t> oprf_receiver(const std::vector<uint64_t>& in, PCSI::PCSIC
     KkrtNcoOtReceiver recv;
     recv.configure(false, 40, sec_para);
 
-    // configure network
-    std::string name = "pcsi";
-    IOService ios;
-    Session ep(ios, context.ip, context.port + 600, SessionMode::Client, name);
-    auto recv_chl = ep.addChannel(name, name);
-
     uint64_t base_ot_num = recv.getBaseOTCount();
     std::vector<std::array<osuCrypto::block, 2>> base_send(base_ot_num);
 
@@ -63,14 +57,10 @@ std::vector<uint64_t> oprf_receiver(const std::vector<uint64_t>& in, PCSI::PCSIC
         out.push_back(reinterpret_cast<uint64_t *>(&receiver_encoding.at(i))[0] &= _61_mask);
     }
 
-    recv_chl.close();
-    ep.stop();
-    ios.stop();
-
     return out;
 }
 
-std::vector<std::vector<uint64_t>> oprf_sender(const std::vector<std::vector<uint64_t>>& in, PCSI::PCSIContext& context) {
+std::vector<std::vector<uint64_t>> oprf_sender(const std::vector<std::vector<uint64_t>>& in, osuCrypto::Channel& send_chl) {
     std::vector<std::vector<uint64_t>> out(in.size());
     
     uint32_t ot_num = in.size();
@@ -78,11 +68,6 @@ std::vector<std::vector<uint64_t>> oprf_sender(const std::vector<std::vector<uin
     KkrtNcoOtSender sender;
     sender.configure(false, 40, sec_para);
 
-    std::string name = "pcsi";
-    IOService ios;
-    Session ep(ios, context.ip, context.port + 600, SessionMode::Server, name);
-    auto send_chl = ep.addChannel(name, name);
-
     uint64_t base_ot_num = sender.getBaseOTCount();
     DefaultBaseOT base_ot;
     BitVector choices(base_ot_num); // sender's random s 
@@ -120,19 +105,10 @@ std::vector<std::vector<uint64_t>> oprf_sender(const std::vector<std::vector<uin
     }
 
 
-    send_chl.close();
-    ep.stop();
-    ios.stop();
-
     return out;
 }
 
-void ot_send(std::vector<std::vector<osuCrypto::block>>& msg, PCSI::PCSIContext& context) {
-    osuCrypto::IOService ios;
-    std::string name = "pcsi";
-    osuCrypto::Session ep(ios, context.ip, context.port + 1, SessionMode::Client, name);
-    auto send_chl = ep.addChannel(name, name);
-
+void ot_send(std::vector<std::vector<osuCrypto::block>>& msg, osuCrypto::Channel& send_chl) {
     PRNG prng(_mm_set_epi32(0, 0, 0, 0));
 
     std::vector<osuCrypto::block> base_recv(sec_para);
@@ -157,12 +133,7 @@ void ot_send(std::vector<std::vector<osuCrypto::block>>& msg, PCSI::PCSIContext&
 
 }
 
-void ot_recv(osuCrypto::BitVector& choices, std::vector<osuCrypto::block>& recv_msg, PCSI::PCSIContext& context) {
-    osuCrypto::IOService ios;
-    std::string name = "pcsi";
-    osuCrypto::Session ep(ios, context.ip, context.port + 1, SessionMode::Server, name);
-    auto recv_chl = ep.addChannel(name, name);
-
+void ot_recv(osuCrypto::BitVector& choices, std::vector<osuCrypto::block>& recv_msg, osuCrypto::Channel& recv_chl) {
     PRNG prng(_mm_set_epi32(0, 0, 0, 1));
 
     uint64_t ot_num = choices.size();
@@ -189,12 +160,7 @@ void ot_recv(osuCrypto::BitVector& choices, std::vector<osuCrypto::block>& recv_
     }
 }
 
-void rot_send(std::vector<std::array<osuCrypto::block,2>> &msg, PCSI::PCSIContext& context) {
-    osuCrypto::IOService ios;
-    std::string name = "pcsi";
-    osuCrypto::Session ep(ios, context.ip, context.port + 1, SessionMode::Client, name);
-    auto send_chl = ep.addChannel(name, name);
-
+void rot_send(std::vector<std::array<osuCrypto::block,2>> &msg, osuCrypto::Channel& send_chl) {
     PRNG prng(_mm_set_epi32(0, 0, 0, 0));
     std::vector<osuCrypto::block> base_recv(sec_para);  // 128
     DefaultBaseOT base_ot;
@@ -207,12 +173,7 @@ void rot_send(std::vector<std::array<osuCrypto::block,2>> &msg, PCSI::PCSIContex
     sender.send(msg, prng, send_chl);
 }
 
-void rot_recv(osuCrypto::BitVector& choices, std::vector<osuCrypto::block>& recv_msg, PCSI::PCSIContext& context) {
-    osuCrypto::IOService ios;
-    std::string name = "pcsi";
-    osuCrypto::Session ep(ios, context.ip, context.port + 1, SessionMode::Server, name);
-    auto recv_chl = ep.addChannel(name, name);
-
+void rot_recv(osuCrypto::BitVector& choices, std::vector<osuCrypto::block>& recv_msg, osuCrypto::Channel& recv_chl) {
     PRNG prng(_mm_set_epi32(0, 0, 0, 1));
     uint64_t ot_num = choices.size();
 
@@ -26,17 +26,19 @@
 
 namespace PCSI {
 
-std::vector<uint64_t> oprf_receiver(const std::vector<uint64_t>& in, PCSI::PCSIContext& context);
+// The OT primitives of the protocol, run over a channel of the PCSI network.
 
-std::vector<std::vector<uint64_t>> oprf_sender(const std::vector<std::vector<uint64_t>>& in, PCSI::PCSIContext& context);
+std::vector<uint64_t> oprf_receiver(const std::vector<uint64_t>& in, osuCrypto::Channel& chl);
 
-void ot_send(std::vector<std::vector<osuCrypto::block>>& msg, PCSI::PCSIContext& context);
+std::vector<std::vector<uint64_t>> oprf_sender(const std::vector<std::vector<uint64_t>>& in, osuCrypto::Channel& chl);
 
-void ot_recv(osuCrypto::BitVector& choices, std::vector<osuCrypto::block>& recv_msg, PCSI::PCSIContext& context);
+void ot_send(std::vector<std::vector<osuCrypto::block>>& msg, osuCrypto::Channel& chl);
 
-void rot_send(std::vector<std::array<osuCrypto::block,2>> &msg, PCSI::PCSIContext& context);
+void ot_recv(osuCrypto::BitVector& choices, std::vector<osuCrypto::block>& recv_msg, osuCrypto::Channel& chl);
 
-void rot_recv(osuCrypto::BitVector& choices, std::vector<osuCrypto::block>& recv_msg, PCSI::PCSIContext& context);
+void rot_send(std::vector<std::array<osuCrypto::block,2>> &msg, osuCrypto::Channel& chl);
+
+void rot_recv(osuCrypto::BitVector& choices, std::vector<osuCrypto::block>& recv_msg, osuCrypto::Channel& chl);
 
 }
 
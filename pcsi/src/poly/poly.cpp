@@ -1,6 +1,218 @@
 #include "poly.h"
+#include "zp_batch.h"
+#include <algorithm>
 #include <iostream>
 
+namespace {
+
+// The fast paths work on raw coefficients in [0, p), low degree first.
+typedef std::vector<uint64_t> Coeffs;
+
+const uint64_t P = ZpLongEle::p;
+
+// below this many coefficients schoolbook multiplication beats Karatsuba.
+const std::size_t kara_threshold = 32;
+
+// below this many quotient coefficients or divisor coefficients, and below
+// this many points, long division and Horner beat the Newton inverse.
+const std::size_t naive_threshold = 64;
+
+inline uint64_t add_mod(uint64_t a, uint64_t b) {
+  uint64_t r = a + b;
+  return r >= P ? r - P : r;
+}
+
+inline uint64_t sub_mod(uint64_t a, uint64_t b) { return a >= b ? a - b : a + P - b; }
+
+inline uint64_t mul_mod(uint64_t a, uint64_t b) {
+  unsigned long long high;
+  unsigned long long low = _mulx_u64(a, b, &high);
+  uint64_t r = (low & P) + (low >> 61) + (high << 3);
+  return r >= P ? r - P : r;
+}
+
+// x mod p for a sum of up to 63 products.
+inline uint64_t reduce128(unsigned __int128 x) {
+  uint64_t r = ((uint64_t)x & P) + ((uint64_t)(x >> 61) & P) + (uint64_t)(x >> 122);
+  r = (r & P) + (r >> 61);
+  return r >= P ? r - P : r;
+}
+
+Coeffs to_raw(const std::vector<ZpLongEle>& v) {
+  Coeffs r(v.size());
+  for (std::size_t i = 0; i < v.size(); i++) r[i] = v[i].ele >= P ? v[i].ele - P : v[i].ele;
+  return r;
+}
+
+std::vector<ZpLongEle> from_raw(const Coeffs& v) {
+  std::vector<ZpLongEle> r(v.size());
+  for (std::size_t i = 0; i < v.size(); i++) r[i].ele = v[i];
+  return r;
+}
+
+// out[0, na + nb - 1) = a * b. The products of each output coefficient are
+// summed in 128 bits and reduced once per 32 terms.
+void mul_school(const uint64_t* a, std::size_t na, const uint64_t* b, std::size_t nb, uint64_t* out) {
+  for (std::size_t k = 0; k < na + nb - 1; k++) {
+    std::size_t lo = k >= nb ? k - nb + 1 : 0;
+    std::size_t hi = std::min(k, na - 1);
+    unsigned __int128 acc = 0;
+    for (std::size_t i = lo, c = 0; i <= hi; i++) {
+      acc += (unsigned __int128)a[i] * b[k - i];
+      if (++c == 32) {
+        acc = reduce128(acc);
+        c = 0;
+      }
+    }
+    out[k] = reduce128(acc);
+  }
+}
+
+// out[0, 2n - 1) = a * b for a and b of n coefficients. scratch holds 8n.
+void mul_kara(const uint64_t* a, const uint64_t* b, std::size_t n, uint64_t* out, uint64_t* scratch) {
+  if (n <= kara_threshold) {
+    mul_school(a, n, b, n, out);
+    return;
+  }
+
+  // a = a0 + x^h a1, a1 has k >= h coefficients.
+  std::size_t h = n / 2, k = n - h;
+  mul_kara(a, b, h, out, scratch);
+  out[2 * h - 1] = 0;
+  mul_kara(a + h, b + h, k, out + 2 * h, scratch);
+
+  uint64_t* sa = scratch;
+  uint64_t* sb = scratch + k;
+  uint64_t* z1 = scratch + 2 * k;
+  for (std::size_t i = 0; i < k; i++) {
+    sa[i] = i < h ? add_mod(a[i], a[h + i]) : a[h + i];
+    sb[i] = i < h ? add_mod(b[i], b[h + i]) : b[h + i];
+  }
+  mul_kara(sa, sb, k, z1, scratch + 4 * k);
+
+  // z1 = (a0 + a1)(b0 + b1) - a0 b0 - a1 b1, added at x^h.
+  for (std::size_t i = 0; i < 2 * k - 1; i++) {
+    uint64_t z = sub_mod(z1[i], out[2 * h + i]);
+    z1[i] = i < 2 * h - 1 ? sub_mod(z, out[i]) : z;
+  }
+  for (std::size_t i = 0; i < 2 * k - 1; i++) out[h + i] = add_mod(out[h + i], z1[i]);
+}
+
+Coeffs mul(const Coeffs& a, const Coeffs& b) {
+  if (a.empty() || b.empty()) return Coeffs();
+
+  const Coeffs& l = a.size() >= b.size() ? a : b;
+  const Coeffs& s = a.size() >= b.size() ? b : a;
+  auto nl = l.size(), ns = s.size();
+  Coeffs out(nl + ns - 1, 0);
+  if (ns <= kara_threshold) {
+    mul_school(l.data(), nl, s.data(), ns, out.data());
+    return out;
+  }
+
+  // the longer operand is cut into pieces of the shorter one's length, a
+  // shorter last piece is multiplied on its own.
+  Coeffs prod(2 * ns - 1), scratch(8 * ns);
+  std::size_t begin = 0;
+  for (; begin + ns <= nl; begin += ns) {
+    mul_kara(l.data() + begin, s.data(), ns, prod.data(), scratch.data());
+    for (std::size_t i = 0; i < 2 * ns - 1; i++) out[begin + i] = add_mod(out[begin + i], prod[i]);
+  }
+  if (begin < nl) {
+    prod = mul(Coeffs(l.begin() + begin, l.end()), s);
+    for (std::size_t i = 0; i < prod.size(); i++) out[begin + i] = add_mod(out[begin + i], prod[i]);
+  }
+  return out;
+}
+
+// g with f g = 1 mod x^k, by Newton iteration. f[0] must be 1.
+Coeffs inv_series(const Coeffs& f, std::size_t k) {
+  Coeffs g{1};
+  for (std::size_t l = 1; l < k;) {
+    l = std::min(2 * l, k);
+    Coeffs fl(f.begin(), f.begin() + std::min(l, f.size()));
+    auto e = mul(fl, g);
+    e.resize(l, 0);
+    for (auto& v : e) v = sub_mod(0, v);
+    e[0] = add_mod(e[0], 2);
+    g = mul(g, e);
+    g.resize(l);
+  }
+  g.resize(k, 0);
+  return g;
+}
+
+// a mod b for a monic b.
+Coeffs rem(const Coeffs& a, const Coeffs& b) {
+  auto na = a.size(), nb = b.size();
+  if (na < nb) return a;
+
+  auto k = na - nb + 1;
+  if (std::min(k, nb) <= naive_threshold) {
+    Coeffs r = a;
+    for (auto i = na; i-- > nb - 1;) {
+      auto c = r[i];
+      if (c == 0) continue;
+      auto shift = i - (nb - 1);
+      for (std::size_t j = 0; j < nb; j++) r[shift + j] = sub_mod(r[shift + j], mul_mod(c, b[j]));
+    }
+    r.resize(nb - 1);
+    return r;
+  }
+
+  // the reversed quotient is rev(a) / rev(b) mod x^k.
+  Coeffs ra(k), rb(std::min(k, nb));
+  for (std::size_t i = 0; i < k; i++) ra[i] = a[na - 1 - i];
+  for (std::size_t i = 0; i < rb.size(); i++) rb[i] = b[nb - 1 - i];
+  auto q = mul(ra, inv_series(rb, k));
+  q.resize(k);
+  std::reverse(q.begin(), q.end());
+
+  auto qb = mul(q, b);
+  Coeffs r(nb - 1);
+  for (std::size_t i = 0; i < nb - 1; i++) r[i] = sub_mod(a[i], qb[i]);
+  return r;
+}
+
+// tree[0][i] = x - X[i] and tree[l + 1][i] = tree[l][2i] * tree[l][2i + 1].
+// An odd last node is moved up unchanged, so node i of level l covers the
+// points [i 2^l, (i + 1) 2^l).
+typedef std::vector<std::vector<Coeffs>> SubproductTree;
+
+SubproductTree build_tree(const Coeffs& X) {
+  SubproductTree tree(1);
+  tree[0].reserve(X.size());
+  for (auto x : X) tree[0].push_back(Coeffs{sub_mod(0, x), 1});
+
+  while (tree.back().size() > 1) {
+    const auto& low = tree.back();
+    std::vector<Coeffs> up((low.size() + 1) / 2);
+    for (std::size_t i = 0; i < up.size(); i++)
+      up[i] = 2 * i + 1 < low.size() ? mul(low[2 * i], low[2 * i + 1]) : low[2 * i];
+    tree.push_back(std::move(up));
+  }
+  return tree;
+}
+
+// Y[j] = f(X[j]) for the points under node (level, idx), by reducing f
+// down the tree.
+void eval_down(const SubproductTree& tree, std::size_t level, std::size_t idx, const Coeffs& f,
+               const Coeffs& X, Coeffs& Y) {
+  auto r = rem(f, tree[level][idx]);
+  auto begin = idx << level;
+  auto end = std::min<std::size_t>(begin + (std::size_t(1) << level), X.size());
+
+  if (level == 0 || end - begin <= naive_threshold) {
+    ZpBatch::eval_points(Y.data() + begin, r.data(), r.size(), X.data() + begin, end - begin);
+    return;
+  }
+
+  eval_down(tree, level - 1, 2 * idx, r, X, Y);
+  if (2 * idx + 1 < tree[level - 1].size()) eval_down(tree, level - 1, 2 * idx + 1, r, X, Y);
+}
+
+}  // namespace
+
 void Poly::eval(ZpLongEle& Y, const std::vector<ZpLongEle>& coeff, ZpLongEle X) {
   ZpLongEle acc(0);
 
@@ -12,8 +224,74 @@ void Poly::eval(ZpLongEle& Y, const std::vector<ZpLongEle>& coeff, ZpLongEle X)
   Y = acc;
 }
 
+void Poly::multi_eval(std::vector<ZpLongEle>& Y, const std::vector<ZpLongEle>& co, const std::vector<ZpLongEle>& X) {
+  auto f = to_raw(co);
+  auto x = to_raw(X);
+  Coeffs y(x.size());
+
+  if (x.size() < fast_threshold || f.size() <= naive_threshold) {
+    ZpBatch::eval_points(y.data(), f.data(), f.size(), x.data(), x.size());
+  } else {
+    auto tree = build_tree(x);
+    eval_down(tree, tree.size() - 1, 0, f, x, y);
+  }
+
+  Y = from_raw(y);
+}
+
+void Poly::mul(std::vector<ZpLongEle>& co, const std::vector<ZpLongEle>& a, const std::vector<ZpLongEle>& b) {
+  co = from_raw(::mul(to_raw(a), to_raw(b)));
+}
 
 void Poly::interpolate(std::vector<ZpLongEle>& co, const std::vector<ZpLongEle>& X, std::vector<ZpLongEle>& Y) {
+  if (X.size() <= fast_threshold) {
+    interpolate_newton(co, X, Y);
+    return;
+  }
+  if (Y.size() != X.size()) std::cout << "interpolate: vector length mismatch" << std::endl;
+
+  auto x = to_raw(X);
+  auto y = to_raw(Y);
+  auto m = x.size();
+  auto tree = build_tree(x);
+
+  // f = sum_i y_i / M'(x_i) * M(x) / (x - x_i) with M the root of the tree.
+  const auto& M = tree.back()[0];
+  Coeffs dM(m);
+  for (std::size_t i = 0; i < m; i++) dM[i] = mul_mod(M[i + 1], i + 1);
+
+  Coeffs w(m);
+  eval_down(tree, tree.size() - 1, 0, dM, x, w);
+  auto w_inv = from_raw(w);
+  ZpLongEle::batch_inverse(w_inv);
+  w = to_raw(w_inv);
+
+  std::vector<Coeffs> level(m);
+  for (std::size_t i = 0; i < m; i++) level[i] = Coeffs{mul_mod(y[i], w[i])};
+
+  // up the tree, f of a node is f_l M_r + f_r M_l.
+  for (std::size_t l = 0; l + 1 < tree.size(); l++) {
+    std::vector<Coeffs> up((level.size() + 1) / 2);
+    for (std::size_t i = 0; i < up.size(); i++) {
+      if (2 * i + 1 == level.size()) {
+        up[i] = std::move(level[2 * i]);
+        continue;
+      }
+      auto a = ::mul(level[2 * i], tree[l][2 * i + 1]);
+      auto b = ::mul(level[2 * i + 1], tree[l][2 * i]);
+      if (a.size() < b.size()) std::swap(a, b);
+      for (std::size_t j = 0; j < b.size(); j++) a[j] = add_mod(a[j], b[j]);
+      up[i] = std::move(a);
+    }
+    level = std::move(up);
+  }
+
+  auto& res = level[0];
+  while (!res.empty() && res.back() == 0) res.pop_back();
+  co = from_raw(res);
+}
+
+void Poly::interpolate_newton(std::vector<ZpLongEle>& co, const std::vector<ZpLongEle>& X, std::vector<ZpLongEle>& Y) {
 
   int64_t m = X.size();
   if (Y.size() != X.size()) std::cout << "interpolate: vector length mismatch" << std::endl;
@@ -80,5 +358,3 @@ void Poly::interpolate(std::vector<ZpLongEle>& co, const std::vector<ZpLongEle>&
 
   co = res;
 }
-
-
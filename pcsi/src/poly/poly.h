@@ -9,7 +9,25 @@
 class Poly {
     public:
         static void eval(ZpLongEle& Y, const std::vector<ZpLongEle>& co, ZpLongEle X);
+
+        // Y[i] = co(X[i]). Large batches go down a subproduct tree over X,
+        // small ones are evaluated by Horner.
+        static void multi_eval(std::vector<ZpLongEle>& Y, const std::vector<ZpLongEle>& co, const std::vector<ZpLongEle>& X);
+
+        // co(X[i]) = Y[i], the X[i] must be distinct. With more than
+        // fast_threshold points this builds a subproduct tree over X, which
+        // takes O(M(m) log m) with Karatsuba multiplication, instead of the
+        // O(m^2) Newton interpolation.
         static void interpolate(std::vector<ZpLongEle>& co, const std::vector<ZpLongEle>& X, std::vector<ZpLongEle>& Y);
+
+        // co = a * b, Karatsuba above a few dozen coefficients.
+        static void mul(std::vector<ZpLongEle>& co, const std::vector<ZpLongEle>& a, const std::vector<ZpLongEle>& b);
+
+        // The O(m^2) interpolation interpolate uses up to fast_threshold
+        // points, public as the reference for the fast path.
+        static void interpolate_newton(std::vector<ZpLongEle>& co, const std::vector<ZpLongEle>& X, std::vector<ZpLongEle>& Y);
+
+        static const std::size_t fast_threshold = 128;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,319 @@
+#include "zp_batch.h"
+#include "zp.h"
+
+#include <immintrin.h>
+#include <vector>
+
+namespace {
+
+const uint64_t P = ZpLongEle::p;
+
+inline uint64_t add_mod(uint64_t a, uint64_t b) {
+  uint64_t r = a + b;
+  return r >= P ? r - P : r;
+}
+
+inline uint64_t mul_mod(uint64_t a, uint64_t b) {
+  unsigned long long high;
+  unsigned long long low = _mulx_u64(a, b, &high);
+  uint64_t r = (low & P) + (low >> 61) + (high << 3);
+  return r >= P ? r - P : r;
+}
+
+// pw[i] = x^i for i < n.
+std::vector<uint64_t> powers(uint64_t x, std::size_t n) {
+  std::vector<uint64_t> pw(n);
+  uint64_t acc = 1;
+  for (std::size_t i = 0; i < n; i++) {
+    pw[i] = acc;
+    acc = mul_mod(acc, x);
+  }
+  return pw;
+}
+
+// ---- scalar ----
+
+void add_scalar(uint64_t* out, const uint64_t* a, const uint64_t* b, std::size_t n) {
+  for (std::size_t i = 0; i < n; i++) out[i] = add_mod(a[i], b[i]);
+}
+
+void mul_scalar(uint64_t* out, const uint64_t* a, const uint64_t* b, std::size_t n) {
+  for (std::size_t i = 0; i < n; i++) out[i] = mul_mod(a[i], b[i]);
+}
+
+void eval_points_scalar(uint64_t* y, const uint64_t* f, std::size_t nf, const uint64_t* x, std::size_t n) {
+  std::size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    uint64_t a0 = 0, a1 = 0, a2 = 0, a3 = 0;
+    for (auto k = nf; k-- > 0;) {
+      a0 = add_mod(mul_mod(a0, x[i + 0]), f[k]);
+      a1 = add_mod(mul_mod(a1, x[i + 1]), f[k]);
+      a2 = add_mod(mul_mod(a2, x[i + 2]), f[k]);
+      a3 = add_mod(mul_mod(a3, x[i + 3]), f[k]);
+    }
+    y[i + 0] = a0;
+    y[i + 1] = a1;
+    y[i + 2] = a2;
+    y[i + 3] = a3;
+  }
+  for (; i < n; i++) {
+    uint64_t acc = 0;
+    for (auto k = nf; k-- > 0;) acc = add_mod(mul_mod(acc, x[i]), f[k]);
+    y[i] = acc;
+  }
+}
+
+uint64_t dot_scalar(const uint64_t* f, const uint64_t* pw, std::size_t n) {
+  uint64_t acc = 0;
+  for (std::size_t i = 0; i < n; i++) acc = add_mod(acc, mul_mod(f[i], pw[i]));
+  return acc;
+}
+
+// ---- AVX2, four lanes ----
+
+#define ZP_AVX2_TARGET __attribute__((target("avx2")))
+
+struct Avx2 {
+  ZP_AVX2_TARGET static inline __m256i p() { return _mm256_set1_epi64x(P); }
+
+  // r - p where r >= p, else r, for r < 2^62.
+  ZP_AVX2_TARGET static inline __m256i reduce_once(__m256i r) {
+    __m256i t = _mm256_sub_epi64(r, p());
+    return _mm256_castpd_si256(
+        _mm256_blendv_pd(_mm256_castsi256_pd(t), _mm256_castsi256_pd(r), _mm256_castsi256_pd(t)));
+  }
+
+  ZP_AVX2_TARGET static inline __m256i add(__m256i a, __m256i b) { return reduce_once(_mm256_add_epi64(a, b)); }
+
+  ZP_AVX2_TARGET static inline __m256i mul(__m256i a, __m256i b) {
+    const __m256i m29 = _mm256_set1_epi64x((1ull << 29) - 1);
+    __m256i a1 = _mm256_srli_epi64(a, 32);
+    __m256i b1 = _mm256_srli_epi64(b, 32);
+
+    __m256i ll = _mm256_mul_epu32(a, b);
+    __m256i hh = _mm256_mul_epu32(a1, b1);
+    __m256i mid = _mm256_add_epi64(_mm256_mul_epu32(a1, b), _mm256_mul_epu32(a, b1));
+
+    // ll + mid * 2^32 + hh * 2^64, each term folded below 2^61.
+    __m256i s = _mm256_add_epi64(_mm256_and_si256(ll, p()), _mm256_srli_epi64(ll, 61));
+    s = _mm256_add_epi64(s, _mm256_slli_epi64(hh, 3));
+    s = _mm256_add_epi64(s, _mm256_srli_epi64(mid, 29));
+    s = _mm256_add_epi64(s, _mm256_slli_epi64(_mm256_and_si256(mid, m29), 32));
+
+    s = _mm256_add_epi64(_mm256_and_si256(s, p()), _mm256_srli_epi64(s, 61));
+    return reduce_once(s);
+  }
+
+  ZP_AVX2_TARGET static inline __m256i load(const uint64_t* x) { return _mm256_loadu_si256((const __m256i*)x); }
+  ZP_AVX2_TARGET static inline void store(uint64_t* x, __m256i v) { _mm256_storeu_si256((__m256i*)x, v); }
+};
+
+ZP_AVX2_TARGET void add_avx2(uint64_t* out, const uint64_t* a, const uint64_t* b, std::size_t n) {
+  std::size_t i = 0;
+  for (; i + 4 <= n; i += 4) Avx2::store(out + i, Avx2::add(Avx2::load(a + i), Avx2::load(b + i)));
+  add_scalar(out + i, a + i, b + i, n - i);
+}
+
+ZP_AVX2_TARGET void mul_avx2(uint64_t* out, const uint64_t* a, const uint64_t* b, std::size_t n) {
+  std::size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i r0 = Avx2::mul(Avx2::load(a + i), Avx2::load(b + i));
+    __m256i r1 = Avx2::mul(Avx2::load(a + i + 4), Avx2::load(b + i + 4));
+    Avx2::store(out + i, r0);
+    Avx2::store(out + i + 4, r1);
+  }
+  mul_scalar(out + i, a + i, b + i, n - i);
+}
+
+ZP_AVX2_TARGET void eval_points_avx2(uint64_t* y, const uint64_t* f, std::size_t nf, const uint64_t* x,
+                                     std::size_t n) {
+  std::size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m256i x0 = Avx2::load(x + i), x1 = Avx2::load(x + i + 4);
+    __m256i x2 = Avx2::load(x + i + 8), x3 = Avx2::load(x + i + 12);
+    __m256i a0 = _mm256_setzero_si256(), a1 = a0, a2 = a0, a3 = a0;
+    for (auto k = nf; k-- > 0;) {
+      __m256i c = _mm256_set1_epi64x(f[k]);
+      a0 = Avx2::add(Avx2::mul(a0, x0), c);
+      a1 = Avx2::add(Avx2::mul(a1, x1), c);
+      a2 = Avx2::add(Avx2::mul(a2, x2), c);
+      a3 = Avx2::add(Avx2::mul(a3, x3), c);
+    }
+    Avx2::store(y + i, a0);
+    Avx2::store(y + i + 4, a1);
+    Avx2::store(y + i + 8, a2);
+    Avx2::store(y + i + 12, a3);
+  }
+  for (; i + 4 <= n; i += 4) {
+    __m256i x0 = Avx2::load(x + i), a0 = _mm256_setzero_si256();
+    for (auto k = nf; k-- > 0;) a0 = Avx2::add(Avx2::mul(a0, x0), _mm256_set1_epi64x(f[k]));
+    Avx2::store(y + i, a0);
+  }
+  eval_points_scalar(y + i, f, nf, x + i, n - i);
+}
+
+ZP_AVX2_TARGET uint64_t dot_avx2(const uint64_t* f, const uint64_t* pw, std::size_t n) {
+  __m256i a0 = _mm256_setzero_si256(), a1 = a0;
+  std::size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    a0 = Avx2::add(a0, Avx2::mul(Avx2::load(f + i), Avx2::load(pw + i)));
+    a1 = Avx2::add(a1, Avx2::mul(Avx2::load(f + i + 4), Avx2::load(pw + i + 4)));
+  }
+  alignas(32) uint64_t lanes[4];
+  Avx2::store(lanes, Avx2::add(a0, a1));
+  uint64_t acc = dot_scalar(f + i, pw + i, n - i);
+  for (auto l : lanes) acc = add_mod(acc, l);
+  return acc;
+}
+
+#undef ZP_AVX2_TARGET
+
+// ---- AVX-512, eight lanes ----
+
+#define ZP_AVX512_TARGET __attribute__((target("avx512f")))
+
+struct Avx512 {
+  ZP_AVX512_TARGET static inline __m512i p() { return _mm512_set1_epi64(P); }
+
+  ZP_AVX512_TARGET static inline __m512i reduce_once(__m512i r) {
+    return _mm512_min_epu64(r, _mm512_sub_epi64(r, p()));
+  }
+
+  ZP_AVX512_TARGET static inline __m512i add(__m512i a, __m512i b) { return reduce_once(_mm512_add_epi64(a, b)); }
+
+  ZP_AVX512_TARGET static inline __m512i mul(__m512i a, __m512i b) {
+    const __m512i m29 = _mm512_set1_epi64((1ull << 29) - 1);
+    __m512i a1 = _mm512_srli_epi64(a, 32);
+    __m512i b1 = _mm512_srli_epi64(b, 32);
+
+    __m512i ll = _mm512_mul_epu32(a, b);
+    __m512i hh = _mm512_mul_epu32(a1, b1);
+    __m512i mid = _mm512_add_epi64(_mm512_mul_epu32(a1, b), _mm512_mul_epu32(a, b1));
+
+    __m512i s = _mm512_add_epi64(_mm512_and_si512(ll, p()), _mm512_srli_epi64(ll, 61));
+    s = _mm512_add_epi64(s, _mm512_slli_epi64(hh, 3));
+    s = _mm512_add_epi64(s, _mm512_srli_epi64(mid, 29));
+    s = _mm512_add_epi64(s, _mm512_slli_epi64(_mm512_and_si512(mid, m29), 32));
+
+    s = _mm512_add_epi64(_mm512_and_si512(s, p()), _mm512_srli_epi64(s, 61));
+    return reduce_once(s);
+  }
+
+  ZP_AVX512_TARGET static inline __m512i load(const uint64_t* x) { return _mm512_loadu_si512(x); }
+  ZP_AVX512_TARGET static inline void store(uint64_t* x, __m512i v) { _mm512_storeu_si512(x, v); }
+};
+
+ZP_AVX512_TARGET void add_avx512(uint64_t* out, const uint64_t* a, const uint64_t* b, std::size_t n) {
+  std::size_t i = 0;
+  for (; i + 8 <= n; i += 8) Avx512::store(out + i, Avx512::add(Avx512::load(a + i), Avx512::load(b + i)));
+  add_scalar(out + i, a + i, b + i, n - i);
+}
+
+ZP_AVX512_TARGET void mul_avx512(uint64_t* out, const uint64_t* a, const uint64_t* b, std::size_t n) {
+  std::size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m512i r0 = Avx512::mul(Avx512::load(a + i), Avx512::load(b + i));
+    __m512i r1 = Avx512::mul(Avx512::load(a + i + 8), Avx512::load(b + i + 8));
+    Avx512::store(out + i, r0);
+    Avx512::store(out + i + 8, r1);
+  }
+  mul_scalar(out + i, a + i, b + i, n - i);
+}
+
+ZP_AVX512_TARGET void eval_points_avx512(uint64_t* y, const uint64_t* f, std::size_t nf, const uint64_t* x,
+                                         std::size_t n) {
+  std::size_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    __m512i x0 = Avx512::load(x + i), x1 = Avx512::load(x + i + 8);
+    __m512i x2 = Avx512::load(x + i + 16), x3 = Avx512::load(x + i + 24);
+    __m512i a0 = _mm512_setzero_si512(), a1 = a0, a2 = a0, a3 = a0;
+    for (auto k = nf; k-- > 0;) {
+      __m512i c = _mm512_set1_epi64(f[k]);
+      a0 = Avx512::add(Avx512::mul(a0, x0), c);
+      a1 = Avx512::add(Avx512::mul(a1, x1), c);
+      a2 = Avx512::add(Avx512::mul(a2, x2), c);
+      a3 = Avx512::add(Avx512::mul(a3, x3), c);
+    }
+    Avx512::store(y + i, a0);
+    Avx512::store(y + i + 8, a1);
+    Avx512::store(y + i + 16, a2);
+    Avx512::store(y + i + 24, a3);
+  }
+  for (; i + 8 <= n; i += 8) {
+    __m512i x0 = Avx512::load(x + i), a0 = _mm512_setzero_si512();
+    for (auto k = nf; k-- > 0;) a0 = Avx512::add(Avx512::mul(a0, x0), _mm512_set1_epi64(f[k]));
+    Avx512::store(y + i, a0);
+  }
+  eval_points_scalar(y + i, f, nf, x + i, n - i);
+}
+
+ZP_AVX512_TARGET uint64_t dot_avx512(const uint64_t* f, const uint64_t* pw, std::size_t n) {
+  __m512i a0 = _mm512_setzero_si512(), a1 = a0;
+  std::size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    a0 = Avx512::add(a0, Avx512::mul(Avx512::load(f + i), Avx512::load(pw + i)));
+    a1 = Avx512::add(a1, Avx512::mul(Avx512::load(f + i + 8), Avx512::load(pw + i + 8)));
+  }
+  alignas(64) uint64_t lanes[8];
+  Avx512::store(lanes, Avx512::add(a0, a1));
+  uint64_t acc = dot_scalar(f + i, pw + i, n - i);
+  for (auto l : lanes) acc = add_mod(acc, l);
+  return acc;
+}
+
+#undef ZP_AVX512_TARGET
+
+// the requested kernel, or the best supported one below it.
+ZpBatch::Isa clamp(ZpBatch::Isa isa) {
+  auto best = ZpBatch::best_isa();
+  return isa > best ? best : isa;
+}
+
+}  // namespace
+
+ZpBatch::Isa ZpBatch::best_isa() {
+  static const Isa isa = __builtin_cpu_supports("avx512f") ? Isa::avx512
+                         : __builtin_cpu_supports("avx2")  ? Isa::avx2
+                                                           : Isa::scalar;
+  return isa;
+}
+
+void ZpBatch::add(uint64_t* out, const uint64_t* a, const uint64_t* b, std::size_t n, Isa isa) {
+  switch (clamp(isa)) {
+    case Isa::avx512: add_avx512(out, a, b, n); break;
+    case Isa::avx2: add_avx2(out, a, b, n); break;
+    default: add_scalar(out, a, b, n);
+  }
+}
+
+void ZpBatch::mul(uint64_t* out, const uint64_t* a, const uint64_t* b, std::size_t n, Isa isa) {
+  switch (clamp(isa)) {
+    case Isa::avx512: mul_avx512(out, a, b, n); break;
+    case Isa::avx2: mul_avx2(out, a, b, n); break;
+    default: mul_scalar(out, a, b, n);
+  }
+}
+
+void ZpBatch::eval_points(uint64_t* y, const uint64_t* f, std::size_t nf, const uint64_t* x, std::size_t n,
+                          Isa isa) {
+  switch (clamp(isa)) {
+    case Isa::avx512: eval_points_avx512(y, f, nf, x, n); break;
+    case Isa::avx2: eval_points_avx2(y, f, nf, x, n); break;
+    default: eval_points_scalar(y, f, nf, x, n);
+  }
+}
+
+void ZpBatch::eval_polys(uint64_t* y, const uint64_t* polys, std::size_t nf, std::size_t count, uint64_t x,
+                         Isa isa) {
+  auto pw = powers(x, nf);
+  // too short for a vector of products.
+  isa = nf < 16 ? Isa::scalar : clamp(isa);
+  for (std::size_t i = 0; i < count; i++) {
+    auto f = polys + i * nf;
+    switch (isa) {
+      case Isa::avx512: y[i] = dot_avx512(f, pw.data(), nf); break;
+      case Isa::avx2: y[i] = dot_avx2(f, pw.data(), nf); break;
+      default: y[i] = dot_scalar(f, pw.data(), nf);
+    }
+  }
+}
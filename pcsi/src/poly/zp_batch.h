@@ -0,0 +1,43 @@
+#pragma once
+
+#ifndef _ZP_BATCH_H
+#define _ZP_BATCH_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Batched arithmetic mod p = 2^61 - 1 on raw elements in [0, p), the
+// representation of ZpLongEle::ele. Each call runs on AVX-512 or AVX2 when
+// the cpu has it, detected at runtime, and otherwise on scalar mulx code.
+//
+// The vector kernels multiply with 32x32-bit lane products: for a, b < 2^61
+// the four partial products fold back below 2^63 using 2^61 = 1 and
+// 2^64 = 8 (mod p), and one more fold and a conditional subtraction give the
+// reduced result.
+class ZpBatch {
+    public:
+        enum class Isa { scalar, avx2, avx512 };
+
+        // the best kernel the cpu supports.
+        static Isa best_isa();
+
+        // out[i] = a[i] + b[i], out may alias a or b.
+        static void add(uint64_t* out, const uint64_t* a, const uint64_t* b, std::size_t n, Isa isa = best_isa());
+
+        // out[i] = a[i] * b[i], out may alias a or b.
+        static void mul(uint64_t* out, const uint64_t* a, const uint64_t* b, std::size_t n, Isa isa = best_isa());
+
+        // y[i] = f(x[i]) for n points, f has nf coefficients, low degree
+        // first. Horner runs over several vectors of points at once so that
+        // the multiplications of different points overlap.
+        static void eval_points(uint64_t* y, const uint64_t* f, std::size_t nf, const uint64_t* x, std::size_t n,
+                                Isa isa = best_isa());
+
+        // y[i] = f_i(x) for count polynomials of nf coefficients each, stored
+        // one after another from polys. The powers of x are computed once and
+        // each f_i is a dot product with them.
+        static void eval_polys(uint64_t* y, const uint64_t* polys, std::size_t nf, std::size_t count, uint64_t x,
+                               Isa isa = best_isa());
+};
+
+#endif
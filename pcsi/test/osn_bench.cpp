@@ -0,0 +1,109 @@
+// Scaling of the OSN switching network, both parties in one process with
+// the random OTs simulated: routing, the sender's corrections and the
+// receiver's evaluation, for 2^min to 2^max bins and the odd and
+// non-power-of-two sizes in that range below, whose networks end in odd
+// wires. Each size is checked to output the permuted inputs under the
+// sender's output masks.
+//
+//   ./osn_bench [min_log2_bins] [max_log2_bins]
+//
+// Peak RSS is that of the process so far, the sizes run in increasing
+// order so it is the peak of the largest one.
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "common/osn.h"
+
+namespace {
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+double peak_rss_mb() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / 1024.0;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    int min_log = argc > 1 ? std::stoi(argv[1]) : 16;
+    int max_log = argc > 2 ? std::stoi(argv[2]) : 25;
+
+    std::cout << std::left << std::setw(10) << "bins" << std::setw(8) << "levels" << std::setw(11) << "route(s)"
+              << std::setw(11) << "corr(s)" << std::setw(11) << "eval(s)" << "peak_rss(MB)" << std::endl;
+
+    std::vector<int> sizes;
+    for (int log_bins = min_log; log_bins <= max_log; log_bins++) sizes.push_back(1 << log_bins);
+    for (int bins : {(1 << 16) + 1, 3 << 17, int(1.27 * (1 << 20))}) {
+        if (bins >= (1 << min_log) && bins <= (1 << max_log)) sizes.push_back(bins);
+    }
+    std::sort(sizes.begin(), sizes.end());
+
+    std::mt19937_64 engine(1);
+    for (int bins : sizes) {
+
+        // receiver's permutation, sender's values.
+        std::vector<int> src(bins), dest(bins);
+        std::iota(src.begin(), src.end(), 0);
+        std::iota(dest.begin(), dest.end(), 0);
+        std::shuffle(dest.begin(), dest.end(), engine);
+        std::vector<uint64_t> sets(bins), masks(bins);
+        for (auto &e : sets) e = engine();
+        for (auto &e : masks) e = engine();
+
+        Benes benes(bins);
+        std::size_t switch_num = std::size_t(benes.levels()) * (bins / 2);
+        std::vector<std::array<osuCrypto::block, 2>> ot_msg(switch_num);
+        for (auto &m : ot_msg) {
+            m[0] = osuCrypto::toBlock(engine(), engine());
+            m[1] = osuCrypto::toBlock(engine(), engine());
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        benes.route(src, dest);
+        auto choices = benes.retrieve_switches();
+        double t_route = seconds_since(start);
+
+        // sender
+        std::vector<uint64_t> output_masks(masks);
+        std::vector<osuCrypto::block> corr_blocks(switch_num);
+        start = std::chrono::steady_clock::now();
+        benes.gen_corr_block(output_masks, ot_msg, corr_blocks);
+        double t_corr = seconds_since(start);
+
+        // receiver, with the OTs of recv_osn
+        std::vector<osuCrypto::block> ot_output(switch_num);
+        for (std::size_t i = 0; i < switch_num; i++) {
+            ot_output[i] = choices[i] ? ot_msg[i][1] ^ corr_blocks[i] : ot_msg[i][0];
+        }
+        std::vector<uint64_t> input(bins);
+        for (int i = 0; i < bins; i++) input[i] = masks[i] ^ sets[i];
+        start = std::chrono::steady_clock::now();
+        benes.masked_eval(input, ot_output);
+        double t_eval = seconds_since(start);
+
+        for (int i = 0; i < bins; i++) {
+            if ((input[i] ^ output_masks[i]) != sets[dest[i]]) {
+                std::cout << "wrong output " << i << " for " << bins << " bins" << std::endl;
+                return 1;
+            }
+        }
+
+        std::cout << std::left << std::fixed << std::setprecision(3) << std::setw(10) << bins << std::setw(8)
+                  << benes.levels() << std::setw(11) << t_route << std::setw(11) << t_corr << std::setw(11) << t_eval
+                  << std::setprecision(1) << peak_rss_mb() << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,119 @@
+// Checks the subproduct tree paths of Poly against the quadratic ones:
+// interpolate above fast_threshold against interpolate_newton, multi_eval
+// against Horner evaluation with Poly::eval and mul against schoolbook
+// multiplication. The sizes straddle fast_threshold and the powers of two
+// the tree splits at.
+//
+//   ./poly_check [seed]
+
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "poly/poly.h"
+
+namespace {
+
+std::vector<ZpLongEle> random_eles(std::size_t n, std::mt19937_64 &engine) {
+    std::vector<ZpLongEle> v(n);
+    for (auto &e : v) e = ZpLongEle(engine() % ZpLongEle::p);
+    return v;
+}
+
+// n distinct random points.
+std::vector<ZpLongEle> random_points(std::size_t n, std::mt19937_64 &engine) {
+    std::vector<ZpLongEle> v;
+    std::vector<unsigned long long> seen;
+    while (v.size() < n) {
+        auto e = engine() % ZpLongEle::p;
+        bool dup = false;
+        for (auto s : seen) dup |= s == e;
+        if (dup) continue;
+        seen.push_back(e);
+        v.push_back(ZpLongEle(e));
+    }
+    return v;
+}
+
+bool same(const std::vector<ZpLongEle> &a, const std::vector<ZpLongEle> &b) {
+    if (a.size() != b.size()) return false;
+    for (std::size_t i = 0; i < a.size(); i++) {
+        if (a[i].ele != b[i].ele) return false;
+    }
+    return true;
+}
+
+std::vector<ZpLongEle> mul_school(const std::vector<ZpLongEle> &a, const std::vector<ZpLongEle> &b) {
+    std::vector<ZpLongEle> c(a.size() + b.size() - 1);
+    for (std::size_t i = 0; i < a.size(); i++) {
+        for (std::size_t j = 0; j < b.size(); j++) {
+            ZpLongEle t = a[i];
+            c[i + j] += t * b[j];
+        }
+    }
+    return c;
+}
+
+bool check(bool ok, const std::string &what) {
+    if (!ok) std::cout << "FAILED " << what << std::endl;
+    return ok;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    std::mt19937_64 engine(argc > 1 ? std::stoull(argv[1]) : 1);
+    bool ok = true;
+
+    for (std::size_t m : {1, 2, 127, 128, 129, 130, 200, 255, 256, 257, 300, 513, 1000}) {
+        auto X = random_points(m, engine);
+        auto Y = random_eles(m, engine);
+
+        std::vector<ZpLongEle> fast, newton;
+        Poly::interpolate(fast, X, Y);
+        Poly::interpolate_newton(newton, X, Y);
+        ok &= check(same(fast, newton), "interpolate, " + std::to_string(m) + " points");
+
+        bool hits = true;
+        for (std::size_t i = 0; i < m; i++) {
+            ZpLongEle y;
+            Poly::eval(y, fast, X[i]);
+            hits &= y.ele == Y[i].ele;
+        }
+        ok &= check(hits, "interpolate through the points, " + std::to_string(m) + " points");
+    }
+
+    for (std::size_t n : {1, 127, 128, 129, 200, 257, 1000}) {
+        for (std::size_t size : {std::size_t(1), std::size_t(5), n, 3 * n / 2 + 1}) {
+            auto co = random_eles(size, engine);
+            auto X = random_eles(n, engine);
+
+            std::vector<ZpLongEle> Y;
+            Poly::multi_eval(Y, co, X);
+
+            bool match = Y.size() == n;
+            for (std::size_t i = 0; match && i < n; i++) {
+                ZpLongEle y;
+                Poly::eval(y, co, X[i]);
+                match &= y.ele == Y[i].ele;
+            }
+            ok &= check(match, "multi_eval, " + std::to_string(size) + " coefficients at " +
+                                   std::to_string(n) + " points");
+        }
+    }
+
+    for (std::size_t na : {1, 31, 32, 33, 127, 128, 129, 200, 257, 1000}) {
+        for (std::size_t nb : {std::size_t(1), std::size_t(3), na - na / 3, na, na + 1}) {
+            auto a = random_eles(na, engine);
+            auto b = random_eles(nb, engine);
+
+            std::vector<ZpLongEle> c;
+            Poly::mul(c, a, b);
+            ok &= check(same(c, mul_school(a, b)), "mul, " + std::to_string(na) + " by " + std::to_string(nb));
+        }
+    }
+
+    std::cout << "same results as the quadratic paths? " << ok << std::endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,99 @@
+// Throughput of the batched mod 2^61 - 1 kernels, scalar against AVX2 and
+// AVX-512 as far as the cpu supports them. Every kernel is checked against
+// the scalar one.
+//
+//   ./zp_batch_bench [points] [poly_size] [polys]
+//
+// eval_points evaluates one polynomial of poly_size coefficients at points
+// values, as the client does for the bins of a mega-bin. eval_polys
+// evaluates polys polynomials at one value.
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "poly/zp_batch.h"
+#include "common/constants.h"
+
+namespace {
+
+std::vector<uint64_t> random_eles(std::size_t n, uint64_t seed) {
+    std::mt19937_64 engine(seed);
+    std::vector<uint64_t> v(n);
+    for (auto &e : v) {
+        do {
+            e = engine() & PCSI::_61_mask;
+        } while (e == PCSI::_61_mask);
+    }
+    return v;
+}
+
+// best of a few runs, in seconds.
+template <typename F>
+double best_time(F f) {
+    double best = 0;
+    for (int r = 0; r < 5; r++) {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        double t = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        best = r ? std::min(best, t) : t;
+    }
+    return best;
+}
+
+const char *isa_name(ZpBatch::Isa isa) {
+    switch (isa) {
+        case ZpBatch::Isa::avx512: return "avx512";
+        case ZpBatch::Isa::avx2: return "avx2";
+        default: return "scalar";
+    }
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    std::size_t points = argc > 1 ? std::stoull(argv[1]) : 1 << 16;
+    std::size_t poly_size = argc > 2 ? std::stoull(argv[2]) : 975;
+    std::size_t polys = argc > 3 ? std::stoull(argv[3]) : 1 << 12;
+
+    auto a = random_eles(points, 1);
+    auto b = random_eles(points, 2);
+    auto f = random_eles(poly_size * polys, 3);
+
+    std::vector<uint64_t> add_ref(points), mul_ref(points), points_ref(points), polys_ref(polys);
+    ZpBatch::add(add_ref.data(), a.data(), b.data(), points, ZpBatch::Isa::scalar);
+    ZpBatch::mul(mul_ref.data(), a.data(), b.data(), points, ZpBatch::Isa::scalar);
+    ZpBatch::eval_points(points_ref.data(), f.data(), poly_size, a.data(), points, ZpBatch::Isa::scalar);
+    ZpBatch::eval_polys(polys_ref.data(), f.data(), poly_size, polys, b[0], ZpBatch::Isa::scalar);
+
+    std::cout << "points " << points << ", poly_size " << poly_size << ", polys " << polys << std::endl;
+    std::cout << std::left << std::setw(8) << "isa" << std::setw(14) << "add(M/s)" << std::setw(14) << "mul(M/s)"
+              << std::setw(18) << "eval_points(M/s)" << "eval_polys(M/s)" << std::endl;
+
+    bool ok = true;
+    for (auto isa : {ZpBatch::Isa::scalar, ZpBatch::Isa::avx2, ZpBatch::Isa::avx512}) {
+        if (isa > ZpBatch::best_isa()) break;
+
+        std::vector<uint64_t> out(points), y(polys);
+        auto t_add = best_time([&]() { ZpBatch::add(out.data(), a.data(), b.data(), points, isa); });
+        ok &= out == add_ref;
+        auto t_mul = best_time([&]() { ZpBatch::mul(out.data(), a.data(), b.data(), points, isa); });
+        ok &= out == mul_ref;
+        auto t_points = best_time([&]() { ZpBatch::eval_points(out.data(), f.data(), poly_size, a.data(), points, isa); });
+        ok &= out == points_ref;
+        auto t_polys = best_time([&]() { ZpBatch::eval_polys(y.data(), f.data(), poly_size, polys, b[0], isa); });
+        ok &= y == polys_ref;
+
+        // multiply-adds per second for the evaluations.
+        double terms_points = double(points) * poly_size, terms_polys = double(polys) * poly_size;
+        std::cout << std::left << std::fixed << std::setprecision(1) << std::setw(8) << isa_name(isa)
+                  << std::setw(14) << points / t_add / 1e6 << std::setw(14) << points / t_mul / 1e6
+                  << std::setw(18) << terms_points / t_points / 1e6 << terms_polys / t_polys / 1e6 << std::endl;
+    }
+
+    std::cout << "same results as scalar? " << ok << std::endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,80 @@
+// Checks the inversions of ZpLongEle: x * x.inverse() == 1 for random
+// values and for 1, p - 1 and the powers of two, 0.inverse() == 0, and
+// batch_inverse against inverse with zero entries, which it must skip.
+//
+//   ./zp_check [seed]
+
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "poly/zp.h"
+
+namespace {
+
+bool is_inverse(ZpLongEle x) {
+    ZpLongEle one = x * x.inverse();
+    return one.ele == 1;
+}
+
+bool check(bool ok, const std::string &what) {
+    if (!ok) std::cout << "FAILED " << what << std::endl;
+    return ok;
+}
+
+// batch_inverse of v, which may hold zeros, against inverse of each entry.
+bool check_batch(const std::vector<ZpLongEle> &v, const std::string &what) {
+    auto inv = v;
+    ZpLongEle::batch_inverse(inv);
+
+    bool ok = inv.size() == v.size();
+    for (std::size_t i = 0; ok && i < v.size(); i++) {
+        if (v[i].ele == 0)
+            ok = inv[i].ele == 0;
+        else
+            ok = inv[i].ele == v[i].inverse().ele;
+    }
+    return check(ok, "batch_inverse, " + what);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    std::mt19937_64 engine(argc > 1 ? std::stoull(argv[1]) : 1);
+    const unsigned long long p = ZpLongEle::p;
+    bool ok = true;
+
+    ok &= check(is_inverse(ZpLongEle(1)), "inverse of 1");
+    ok &= check(is_inverse(ZpLongEle(p - 1)), "inverse of p - 1");
+    ok &= check(ZpLongEle(p - 1).inverse().ele == p - 1, "p - 1 is its own inverse");
+    ok &= check(is_inverse(ZpLongEle(p - 2)), "inverse of p - 2");
+    for (int k = 0; k < 61; k++) {
+        ok &= check(is_inverse(ZpLongEle(1ull << k)), "inverse of 2^" + std::to_string(k));
+    }
+    ok &= check(ZpLongEle(0).inverse().ele == 0, "inverse of 0");
+
+    bool random_ok = true;
+    for (int i = 0; i < 100000; i++) {
+        auto e = engine() % (p - 1) + 1;
+        random_ok &= is_inverse(ZpLongEle(e));
+    }
+    ok &= check(random_ok, "inverse of random values");
+
+    std::vector<ZpLongEle> v(1000);
+    for (auto &e : v) e = ZpLongEle(engine() % (p - 1) + 1);
+    ok &= check_batch(v, "no zeros");
+
+    auto holes = v;
+    for (std::size_t i = 0; i < holes.size(); i += 7) holes[i] = ZpLongEle(0);
+    holes.back() = ZpLongEle(0);
+    ok &= check_batch(holes, "zeros at the ends and inside");
+
+    ok &= check_batch(std::vector<ZpLongEle>(), "empty");
+    ok &= check_batch(std::vector<ZpLongEle>(5), "all zeros");
+    ok &= check_batch({ZpLongEle(0)}, "a single zero");
+    ok &= check_batch({ZpLongEle(1), ZpLongEle(0), ZpLongEle(p - 1), ZpLongEle(1ull << 60)}, "edge values");
+
+    std::cout << "all inverses correct? " << ok << std::endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,171 @@
+#include "psi/okvs/baxosfile.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace primihub::crypto::okvs {
+
+namespace {
+constexpr u64 kBaxosFileMagic = 0x31656c6946786142;  // "BaxFile1"
+
+// p starts at this offset, it is a multiple of the page size.
+constexpr u64 kDataOffset = 4096;
+
+struct FileHeader {
+  u64 mMagic;
+  u64 mVersion;
+
+  // Baxos.
+  u64 mNumItems;
+  u64 mNumBins;
+  u64 mItemsPerBin;
+  u64 mWeight;
+  u64 mSsp;
+  u64 mSeed[2];
+
+  // the PaxosParam of each bin.
+  u64 mSparseSize;
+  u64 mDenseSize;
+  u64 mBinWeight;
+  u64 mG;
+  u64 mBinSsp;
+  u64 mDt;
+
+  // p, mRows rows of mRowBytes bytes starting at mDataOffset.
+  u64 mRows;
+  u64 mRowBytes;
+  u64 mDataOffset;
+};
+static_assert(std::is_trivially_copyable<FileHeader>::value, "");
+static_assert(sizeof(FileHeader) <= kDataOffset, "");
+
+std::string errnoString() { return std::strerror(errno); }
+}  // namespace
+
+void BaxosFile::save(const std::string &path, const Baxos &paxos,
+                     MatrixView<const u8> p) {
+  auto &param = paxos.mPaxosParam;
+  u64 rows = paxos.mNumBins * param.size();
+  if (p.rows() != rows || p.cols() == 0)
+    throw std::runtime_error("Paxos encoding size mismatch. " LOCATION);
+
+  FileHeader header;
+  std::memset(&header, 0, sizeof(header));
+  header.mMagic = kBaxosFileMagic;
+  header.mVersion = kVersion;
+  header.mNumItems = paxos.mNumItems;
+  header.mNumBins = paxos.mNumBins;
+  header.mItemsPerBin = paxos.mItemsPerBin;
+  header.mWeight = paxos.mWeight;
+  header.mSsp = paxos.mSsp;
+  std::memcpy(header.mSeed, &paxos.mSeed, sizeof(block));
+  header.mSparseSize = param.mSparseSize;
+  header.mDenseSize = param.mDenseSize;
+  header.mBinWeight = param.mWeight;
+  header.mG = param.mG;
+  header.mBinSsp = param.mSsp;
+  header.mDt = param.mDt;
+  header.mRows = rows;
+  header.mRowBytes = p.cols();
+  header.mDataOffset = kDataOffset;
+
+  std::vector<char> page(kDataOffset, 0);
+  std::memcpy(page.data(), &header, sizeof(header));
+
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out.write(page.data(), page.size());
+  out.write((const char *)p.data(), p.size());
+  out.close();
+  if (!out)
+    throw std::runtime_error("Write paxos file " + path + " failed. " LOCATION);
+}
+
+void BaxosFile::open(const std::string &path) {
+  close();
+
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw std::runtime_error("Open paxos file " + path +
+                             " failed: " + errnoString() + ". " LOCATION);
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    auto err = errnoString();
+    ::close(fd);
+    throw std::runtime_error("Stat paxos file " + path + " failed: " + err +
+                             ". " LOCATION);
+  }
+
+  u64 fileSize = st.st_size;
+  if (fileSize < kDataOffset) {
+    ::close(fd);
+    throw std::runtime_error("Bad paxos file header. " LOCATION);
+  }
+
+  void *map = mmap(nullptr, fileSize, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (map == MAP_FAILED)
+    throw std::runtime_error("Map paxos file " + path +
+                             " failed: " + errnoString() + ". " LOCATION);
+  mMap = map;
+  mMapSize = fileSize;
+
+  FileHeader header;
+  std::memcpy(&header, map, sizeof(header));
+  if (header.mMagic != kBaxosFileMagic || header.mVersion != kVersion) {
+    close();
+    throw std::runtime_error("Bad paxos file header. " LOCATION);
+  }
+
+  u64 binSize = header.mSparseSize + header.mDenseSize;
+  if (header.mDataOffset != kDataOffset || header.mRowBytes == 0 ||
+      header.mNumBins == 0 || header.mRows != header.mNumBins * binSize ||
+      header.mDt > PaxosParam::GF128 ||
+      (fileSize - kDataOffset) / header.mRowBytes < header.mRows) {
+    close();
+    throw std::runtime_error("Bad paxos file header. " LOCATION);
+  }
+
+  mPaxos = Baxos{};
+  mPaxos.mNumItems = header.mNumItems;
+  mPaxos.mNumBins = header.mNumBins;
+  mPaxos.mItemsPerBin = header.mItemsPerBin;
+  mPaxos.mWeight = header.mWeight;
+  mPaxos.mSsp = header.mSsp;
+  std::memcpy(&mPaxos.mSeed, header.mSeed, sizeof(block));
+
+  auto &param = mPaxos.mPaxosParam;
+  param.mSparseSize = header.mSparseSize;
+  param.mDenseSize = header.mDenseSize;
+  param.mWeight = header.mBinWeight;
+  param.mG = header.mG;
+  param.mSsp = header.mBinSsp;
+  param.mDt = static_cast<PaxosParam::DenseType>(header.mDt);
+
+  mP = MatrixView<const u8>((const u8 *)map + kDataOffset, header.mRows,
+                            header.mRowBytes);
+}
+
+void BaxosFile::close() {
+  if (mMap) munmap(mMap, mMapSize);
+  mMap = nullptr;
+  mMapSize = 0;
+  mP = {};
+}
+
+void BaxosFile::checkWidth(u64 bytes) const {
+  if (!isOpen()) throw std::runtime_error("Paxos file is not open. " LOCATION);
+  if (bytes != mP.cols())
+    throw std::runtime_error("Paxos value width mismatch. " LOCATION);
+}
+
+}  // namespace primihub::crypto::okvs
@@ -0,0 +1,82 @@
+#pragma once
+#include <string>
+
+#include "psi/okvs/paxos.h"
+
+namespace primihub::crypto::okvs {
+
+// A solved Baxos stored in a file. The file is a fixed size header, holding
+// the parameters, the seed and the bin layout, followed by the encoding p,
+// bin after bin. p starts on a page boundary so that open can map it and
+// decode directly off the file, the pages are shared between processes
+// which map the same file and only the touched ones are read in.
+//
+// The format is versioned, open throws on a file written with another
+// version or a truncated one.
+class BaxosFile {
+ public:
+  static constexpr u64 kVersion = 1;
+
+  BaxosFile() = default;
+  BaxosFile(const BaxosFile &) = delete;
+  BaxosFile &operator=(const BaxosFile &) = delete;
+  ~BaxosFile() { close(); }
+
+  // Write paxos and its encoding p, p.rows() must be paxos.size(). A row of
+  // p is p.cols() bytes, decode must be called with values of that width.
+  static void save(const std::string &path, const Baxos &paxos,
+                   MatrixView<const u8> p);
+
+  template <typename ValueType>
+  static void save(const std::string &path, const Baxos &paxos,
+                   span<const ValueType> p) {
+    save(path, paxos,
+         MatrixView<const u8>((const u8 *)p.data(), p.size(),
+                              sizeof(ValueType)));
+  }
+
+  // Map a file written by save, read only.
+  void open(const std::string &path);
+
+  void close();
+
+  bool isOpen() const { return mMap != nullptr; }
+
+  // The parameters of the mapped paxos. mAddToDecode may be set before
+  // decoding.
+  Baxos &paxos() { return mPaxos; }
+
+  // The mapped encoding.
+  MatrixView<const u8> p() const { return mP; }
+
+  template <typename ValueType>
+  void decode(span<const block> inputs, span<ValueType> values,
+              Workers workers = {}) {
+    checkWidth(sizeof(ValueType));
+    mPaxos.decode<ValueType>(
+        inputs, values,
+        span<const ValueType>((const ValueType *)mP.data(), mP.rows()),
+        workers);
+  }
+
+  template <typename ValueType>
+  void decode(span<const block> inputs, MatrixView<ValueType> values,
+              Workers workers = {}) {
+    checkWidth(values.cols() * sizeof(ValueType));
+    mPaxos.decode<ValueType>(
+        inputs, values,
+        MatrixView<const ValueType>((const ValueType *)mP.data(), mP.rows(),
+                                    values.cols()),
+        workers);
+  }
+
+ private:
+  void checkWidth(u64 bytes) const;
+
+  Baxos mPaxos;
+  MatrixView<const u8> mP;
+  void *mMap = nullptr;
+  u64 mMapSize = 0;
+};
+
+}  // namespace primihub::crypto::okvs
@@ -0,0 +1,250 @@
+#include "psi/okvs/baxosstream.h"
+
+#include <array>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace primihub::crypto::okvs {
+
+void BaxosStream::init(const Baxos &paxos, u64 valueBytes) {
+  if (valueBytes == 0 || paxos.mNumBins == 0)
+    throw std::runtime_error("Bad paxos stream parameters. " LOCATION);
+
+  mPaxos = paxos;
+  mValueBytes = valueBytes;
+  mSize = 0;
+  mHasher.setKey(mPaxos.mSeed);
+  mBinHashes.assign(mPaxos.mNumBins, {});
+  mBinValues.assign(mPaxos.mNumBins, {});
+}
+
+void BaxosStream::push(span<const block> keys, MatrixView<const u8> values) {
+  static constexpr const u64 batchSize = 32;
+  if (values.rows() != keys.size() || values.cols() != mValueBytes)
+    throw std::runtime_error("Paxos stream value size mismatch. " LOCATION);
+  if (mSize + keys.size() > mPaxos.mNumItems)
+    throw std::runtime_error("Too many items pushed to paxos stream. "
+                             LOCATION);
+
+  auto numBins = mPaxos.mNumBins;
+  libdivide::libdivide_u64_t divider = libdivide::libdivide_u64_gen(numBins);
+  std::array<block, batchSize> hashes;
+  std::array<u64, batchSize> binIdxs;
+
+  auto add = [&](u64 i, const block &hash, u64 binIdx) {
+    auto &binHashes = mBinHashes[binIdx];
+    if (binHashes.size() == mPaxos.mItemsPerBin) throw RTE_LOC;
+
+    // most bins end up close to the average size, reserve that up front.
+    if (binHashes.capacity() == 0) {
+      auto expected = mPaxos.mNumItems / numBins + 1;
+      binHashes.reserve(expected);
+      mBinValues[binIdx].reserve(expected * mValueBytes);
+    }
+
+    binHashes.push_back(hash);
+    auto v = values[i];
+    mBinValues[binIdx].insert(mBinValues[binIdx].end(), v.begin(), v.end());
+  };
+
+  u64 i = 0;
+  auto main = keys.size() / batchSize * batchSize;
+  for (; i < main; i += batchSize) {
+    mHasher.hashBlocks<8>(keys.data() + i + 0, hashes.data() + 0);
+    mHasher.hashBlocks<8>(keys.data() + i + 8, hashes.data() + 8);
+    mHasher.hashBlocks<8>(keys.data() + i + 16, hashes.data() + 16);
+    mHasher.hashBlocks<8>(keys.data() + i + 24, hashes.data() + 24);
+
+    for (u64 k = 0; k < batchSize; ++k)
+      binIdxs[k] = mPaxos.binIdxCompress(hashes[k]);
+
+    doMod32(binIdxs.data(), &divider, numBins);
+
+    for (u64 k = 0; k < batchSize; ++k) add(i + k, hashes[k], binIdxs[k]);
+  }
+
+  for (; i < keys.size(); ++i) {
+    auto hash = mHasher.hashBlock(keys[i]);
+    add(i, hash, mPaxos.modNumBins(hash));
+  }
+
+  mSize += keys.size();
+}
+
+void BaxosStream::finalize(oc::PRNG *prng, Workers workers, const Emit &emit) {
+  if (!emit) throw std::runtime_error("Paxos stream needs an emit. " LOCATION);
+  finalize(MatrixView<u8>(), prng, workers, emit);
+}
+
+void BaxosStream::finalize(MatrixView<u8> output, oc::PRNG *prng,
+                           Workers workers, const Emit &emit) {
+  if (output.data() &&
+      (output.rows() != mPaxos.size() || output.cols() != mValueBytes))
+    throw std::runtime_error("Paxos stream output size mismatch. " LOCATION);
+
+  // select the smallest index type which will work.
+  auto bitLength = oc::roundUpTo(
+      oc::log2ceil((u64)(mPaxos.mPaxosParam.mSparseSize + 1)), 8);
+  auto blockValues = mValueBytes % sizeof(block) == 0;
+
+  if (bitLength <= 8)
+    blockValues ? finalizeImpl<u8, block>(output.data(), prng, workers, emit)
+                : finalizeImpl<u8, u8>(output.data(), prng, workers, emit);
+  else if (bitLength <= 16)
+    blockValues ? finalizeImpl<u16, block>(output.data(), prng, workers, emit)
+                : finalizeImpl<u16, u8>(output.data(), prng, workers, emit);
+  else if (bitLength <= 32)
+    blockValues ? finalizeImpl<u32, block>(output.data(), prng, workers, emit)
+                : finalizeImpl<u32, u8>(output.data(), prng, workers, emit);
+  else
+    blockValues ? finalizeImpl<u64, block>(output.data(), prng, workers, emit)
+                : finalizeImpl<u64, u8>(output.data(), prng, workers, emit);
+}
+
+template <typename IdxType, typename ValueType>
+void BaxosStream::finalizeImpl(u8 *output, oc::PRNG *prng, Workers workers,
+                               const Emit &emit) {
+  auto numBins = mPaxos.mNumBins;
+  auto sizePer = mPaxos.mPaxosParam.size();
+  auto cols = mValueBytes / sizeof(ValueType);
+  auto binBytes = sizePer * mValueBytes;
+  u64 window = workers.size();
+
+  // without an output, solved bins go to one of two window buffers. One is
+  // emitted while the other one is solved.
+  std::unique_ptr<block[]> buffers[2];
+  auto binOutput = [&](u64 binIdx) {
+    if (output) return output + binIdx * binBytes;
+    auto &buff = buffers[(binIdx / window) & 1];
+    if (!buff)
+      buff.reset(new block[oc::divCeil(window * binBytes, sizeof(block))]);
+    return (u8 *)buff.get() + (binIdx % window) * binBytes;
+  };
+
+  std::vector<Paxos<IdxType>> paxos(window);
+  std::vector<std::unique_ptr<u8[]>> allocations(window);
+  std::vector<block> seeds(window);
+
+  auto solveBin = [&](u64 binIdx, u64 thrdIdx) {
+    auto &hashes = mBinHashes[binIdx];
+    auto values = (const ValueType *)mBinValues[binIdx].data();
+    auto out = (ValueType *)binOutput(binIdx);
+    span<block> hh(hashes.data(), hashes.size());
+
+    // each bin gets its own prng so that the result does not depend on the
+    // order in which the bins are solved.
+    std::unique_ptr<PRNG> binPrng;
+    if (prng) binPrng.reset(new PRNG(seeds[thrdIdx]));
+
+    if (cols == 1) {
+      PxVector<const ValueType> V(
+          span<const ValueType>(values, hashes.size()));
+      PxVector<ValueType> P(span<ValueType>(out, sizePer));
+      auto h = P.defaultHelper();
+      mPaxos.implSolveBin(hh, V, P, binPrng.get(), h, paxos[thrdIdx],
+                          allocations[thrdIdx]);
+    } else {
+      PxMatrix<const ValueType> V(
+          MatrixView<const ValueType>(values, hashes.size(), cols));
+      PxMatrix<ValueType> P(MatrixView<ValueType>(out, sizePer, cols));
+      auto h = P.defaultHelper();
+      mPaxos.implSolveBin(hh, V, P, binPrng.get(), h, paxos[thrdIdx],
+                          allocations[thrdIdx]);
+    }
+
+    // the bin is solved, release its items.
+    std::vector<block>().swap(hashes);
+    std::vector<u8>().swap(mBinValues[binIdx]);
+  };
+
+  auto emitWindow = [&](u64 begin, u64 end) {
+    for (u64 binIdx = begin; binIdx < end; ++binIdx)
+      emit(binIdx, MatrixView<const u8>(binOutput(binIdx), sizePer,
+                                        mValueBytes));
+  };
+
+  // one thread, started once per finalize, emits the solved windows in
+  // order while the workers solve the next one. A window buffer is only
+  // reused once the window which last held it is emitted.
+  std::mutex emitMtx;
+  std::condition_variable emitCv;
+  u64 solvedEnd = 0, emittedEnd = 0;
+  bool stopEmit = false;
+  std::exception_ptr emitError;
+  std::thread emitter;
+  if (emit)
+    emitter = std::thread([&]() {
+      std::unique_lock<std::mutex> lock(emitMtx);
+      while (true) {
+        emitCv.wait(lock, [&]() { return stopEmit || emittedEnd < solvedEnd; });
+        if (stopEmit) return;
+
+        auto begin = emittedEnd;
+        auto end = std::min<u64>(begin + window, numBins);
+        lock.unlock();
+        try {
+          emitWindow(begin, end);
+        } catch (...) {
+          lock.lock();
+          emitError = std::current_exception();
+          emitCv.notify_all();
+          return;
+        }
+        lock.lock();
+        emittedEnd = end;
+        emitCv.notify_all();
+      }
+    });
+
+  // wait until bins [0, end) are emitted, or emit failed.
+  auto waitEmitted = [&](u64 end) {
+    std::unique_lock<std::mutex> lock(emitMtx);
+    emitCv.wait(lock, [&]() { return emitError || emittedEnd >= end; });
+    return !emitError;
+  };
+
+  auto stopEmitter = [&]() {
+    if (!emitter.joinable()) return;
+    {
+      std::lock_guard<std::mutex> lock(emitMtx);
+      stopEmit = true;
+    }
+    emitCv.notify_all();
+    emitter.join();
+  };
+
+  try {
+    for (u64 begin = 0; begin < numBins; begin += window) {
+      auto end = std::min<u64>(begin + window, numBins);
+      if (emit && begin >= window && !waitEmitted(begin - window)) break;
+
+      for (u64 t = 0; t < end - begin; ++t)
+        if (prng) seeds[t] = prng->get<block>();
+
+      // binOutput allocates lazily, allocate the buffer of this window before
+      // the workers write to it.
+      binOutput(begin);
+
+      workers.parallelFor(end - begin, [&](u64 t) { solveBin(begin + t, t); });
+
+      if (emit) {
+        std::lock_guard<std::mutex> lock(emitMtx);
+        solvedEnd = end;
+        emitCv.notify_all();
+      }
+    }
+
+    if (emit) waitEmitted(numBins);
+  } catch (...) {
+    stopEmitter();
+    throw;
+  }
+
+  stopEmitter();
+  if (emitError) std::rethrow_exception(emitError);
+}
+
+}  // namespace primihub::crypto::okvs
@@ -0,0 +1,66 @@
+#pragma once
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "psi/okvs/paxos.h"
+
+namespace primihub::crypto::okvs {
+
+// Solves a Baxos from key/value pairs which arrive in batches. push hashes
+// each batch into its bin right away, so the caller does not need to hold
+// all the keys and values. finalize then solves the bins one window of
+// workers.size() bins at a time and hands each solved bin to emit, in bin
+// order. emit runs on one thread per finalize and emits a window while the
+// next one is solved, so the first bins can be sent before the last ones
+// are solved.
+//
+// Any item can land in any bin, so no bin is solved before finalize.
+class BaxosStream {
+ public:
+  // emit(binIdx, p) receives the part of the paxos which belongs to bin
+  // binIdx, Baxos::size() / mNumBins rows of valueBytes bytes. p is only
+  // valid until emit returns.
+  using Emit = std::function<void(u64 binIdx, MatrixView<const u8> p)>;
+
+  // paxos must be initialized for the total number of items. Each value is
+  // valueBytes bytes.
+  void init(const Baxos &paxos, u64 valueBytes);
+
+  void push(span<const block> keys, MatrixView<const u8> values);
+
+  template <typename ValueType>
+  void push(span<const block> keys, span<const ValueType> values) {
+    push(keys, MatrixView<const u8>((const u8 *)values.data(), values.size(),
+                                    sizeof(ValueType)));
+  }
+
+  // The number of items pushed so far.
+  u64 size() const { return mSize; }
+
+  // Solve the bins and emit them in order. Solved bins are only held until
+  // they are emitted.
+  void finalize(oc::PRNG *prng, Workers workers, const Emit &emit);
+
+  // Solve the bins into output, Baxos::size() rows of valueBytes bytes. If
+  // set, emit is called on each bin once it is written.
+  void finalize(MatrixView<u8> output, oc::PRNG *prng, Workers workers,
+                const Emit &emit = {});
+
+  Baxos mPaxos;
+
+ private:
+  template <typename IdxType, typename ValueType>
+  void finalizeImpl(u8 *output, oc::PRNG *prng, Workers workers,
+                    const Emit &emit);
+
+  u64 mValueBytes = 0;
+  u64 mSize = 0;
+  oc::AES mHasher;
+
+  // the hashes and values pushed into each bin so far.
+  std::vector<std::vector<block>> mBinHashes;
+  std::vector<std::vector<u8>> mBinValues;
+};
+
+}  // namespace primihub::crypto::okvs
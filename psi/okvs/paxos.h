@@ -36,6 +36,7 @@
 #include "psi/okvs/pxutil.h"
 #include "psi/ot/tools/ldpc/mtx.h"
 #include "psi/ot/tools/ldpc/util.h"
+#include "psi/ot/tools/threadpool.h"
 
 // #include "volePSI/PxUtil.h"
 
@@ -84,6 +85,24 @@ class Paxos : public PaxosParam, public oc::TimerAdapter {
   // output, as opposed to overwriting.
   bool mAddToDecode = false;
 
+  // The size and wall time of the last decode. Only meaningful if decode is
+  // not called concurrently on the same object.
+  struct DecodeStats {
+    u64 mItems = 0;
+
+    // hashing the inputs and sorting them by bin.
+    u64 mSortNs = 0;
+
+    // decoding the sorted bins.
+    u64 mDecodeNs = 0;
+
+    double itemsPerSecond() const {
+      auto ns = mSortNs + mDecodeNs;
+      return ns ? mItems * 1e9 / ns : 0;
+    }
+  };
+  DecodeStats mDecodeStats;
+
   // the method for generating the row data based on the input value.
   PaxosHash<IdxType> mHasher;
 
@@ -397,7 +416,7 @@ class Baxos {
   template <typename ValueType>
   void solve(span<const block> inputs, span<const ValueType> values,
              span<ValueType> output, oc::PRNG *prng = nullptr,
-             u64 numThreads = 0);
+             Workers workers = {});
 
   // solve the system for the given input matrices.
   // inputs are the keys
@@ -407,12 +426,12 @@ class Baxos {
   template <typename ValueType>
   void solve(span<const block> inputs, MatrixView<const ValueType> values,
              MatrixView<ValueType> output, oc::PRNG *prng = nullptr,
-             u64 numThreads = 0);
+             Workers workers = {});
 
   // solve/encode the system.
   template <typename Vec, typename ConstVec, typename Helper>
   void solve(span<const block> inputs, ConstVec &values, Vec &output,
-             oc::PRNG *prng, u64 numThreads, Helper &h);
+             oc::PRNG *prng, Workers workers, Helper &h);
 
   // decode a single input given the paxos p.
   template <typename ValueType>
@@ -428,7 +447,7 @@ class Baxos {
   // p is the paxos vector.
   template <typename ValueType>
   void decode(span<const block> input, span<ValueType> values,
-              span<const ValueType> p, u64 numThreads = 0);
+              span<const ValueType> p, Workers workers = {});
 
   // decode the given input matrix and write the result to values.
   // inputs are the keys.
@@ -436,11 +455,28 @@ class Baxos {
   // p is the paxos matrix.
   template <typename ValueType>
   void decode(span<const block> input, MatrixView<ValueType> values,
-              MatrixView<const ValueType> p, u64 numThreads = 0);
+              MatrixView<const ValueType> p, Workers workers = {});
+
+  // decode as above and call post(idxs, batch) on each batch of decoded
+  // values before it is written to values. batch[k] is the value of
+  // input[idxs[k]] and post may change it, so work that follows the decode
+  // runs while the batch is in cache instead of in a second pass over
+  // values. post is called concurrently by the workers. mAddToDecode must be
+  // false.
+  template <typename ValueType, typename Post>
+  void decode(span<const block> input, span<ValueType> values,
+              span<const ValueType> p, Workers workers, const Post &post);
 
-  template <typename Vec, typename ConstVec, typename Helper>
+  // The post of the decode functions below when there is none.
+  struct NoDecodePost {
+    template <typename Vec>
+    void operator()(span<const u64>, Vec &) const {}
+  };
+
+  template <typename Vec, typename ConstVec, typename Helper,
+            typename Post = NoDecodePost>
   void decode(span<const block> inputs, Vec &values, ConstVec &p, Helper &h,
-              u64 numThreads);
+              Workers workers, const Post &post = {});
 
   //////////////////////////////////////////
   // private impl
@@ -449,26 +485,46 @@ class Baxos {
   // solve/encode the system.
   template <typename IdxType, typename Vec, typename ConstVec, typename Helper>
   void implParSolve(span<const block> inputs, ConstVec &values, Vec &output,
-                    oc::PRNG *prng, u64 numThreads, Helper &h);
+                    oc::PRNG *prng, Workers workers, Helper &h);
 
-  // create the desired number of threads and split up the work.
+  // solve a single bin given the hashes of its inputs. output is the part of
+  // the paxos which belongs to the bin. allocation is scratch space, it is
+  // allocated on first use and can be reused across bins.
   template <typename IdxType, typename Vec, typename ConstVec, typename Helper>
+  void implSolveBin(span<block> hashes, ConstVec &values, Vec &output,
+                    oc::PRNG *prng, Helper &h, Paxos<IdxType> &paxos,
+                    std::unique_ptr<u8[]> &allocation);
+
+  // create the desired number of threads and split up the work. Large
+  // inputs are first sorted by bin so that each thread decodes whole bins
+  // while their part of p is in cache.
+  template <typename IdxType, typename Vec, typename ConstVec, typename Helper,
+            typename Post>
   void implParDecode(span<const block> inputs, Vec &values, ConstVec &p,
-                     Helper &h, u64 numThreads);
+                     Helper &h, Workers workers, const Post &post);
+
+  // decode the given inputs by first counting and scattering their hashes
+  // into bin order. Each task then decodes a contiguous range of bins.
+  template <typename IdxType, typename Vec, typename ConstVec, typename Helper,
+            typename Post>
+  void implDecodeSorted(span<const block> inputs, Vec &values, ConstVec &p,
+                        Helper &h, Workers workers, const Post &post);
 
   // decode the given inputs based on the paxos p. The output is written to
   // values.
-  template <typename IdxType, typename Vec, typename ConstVec, typename Helper>
+  template <typename IdxType, typename Vec, typename ConstVec, typename Helper,
+            typename Post>
   void implDecodeBatch(span<const block> inputs, Vec &values, ConstVec &p,
-                       Helper &h);
+                       Helper &h, const Post &post);
 
   // decode the given inputs based on the paxos p. The output is written to
   // values. this differs from implDecode in that all inputs must be for the
   // same paxos bin.
-  template <typename IdxType, typename Vec, typename ConstVec, typename Helper>
+  template <typename IdxType, typename Vec, typename ConstVec, typename Helper,
+            typename Post>
   void implDecodeBin(u64 binIdx, span<block> hashes, Vec &values,
                      Vec &valuesBuff, span<u64> inIdxs, ConstVec &p, Helper &h,
-                     Paxos<IdxType> &paxos);
+                     Paxos<IdxType> &paxos, const Post &post);
 
   // the size of the paxos.
   u64 size() {
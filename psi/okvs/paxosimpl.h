@@ -20,6 +20,7 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#include <chrono>
 #include <future>
 #include <numeric>
 #include <unordered_set>
@@ -1251,9 +1252,9 @@ void Paxos<IdxType>::backfillBinary(span<IdxType> mainRows,
   // the dense columns which index the gap.
   std::vector<u64> gapCols;
 
-  // masks that will be used to select the
-  // bits of the dense columns.
-  std::vector<u64> denseMasks(g);
+  // the dense columns which can be non-zero, as bits. Each row then adds
+  // the set bits of its dense value under this mask.
+  u64 denseMask = 0;
 
   // the dense part of the paxos.
   auto p2 = P.subspan(mSparseSize);
@@ -1294,7 +1295,7 @@ void Paxos<IdxType>::backfillBinary(span<IdxType> mainRows,
     }
 
     for (u64 i = 0; i < g; ++i) {
-      denseMasks[i] = 1ull << gapCols[i];
+      denseMask |= 1ull << gapCols[i];
     }
 
   } else if (prng) {
@@ -1303,6 +1304,10 @@ void Paxos<IdxType>::backfillBinary(span<IdxType> mainRows,
     // prng->get(p2.data(), p2.size());
   }
 
+  // when randomized, every dense column is set.
+  assert(mDenseSize <= 64);
+  if (prng) denseMask = mDenseSize == 64 ? ~0ull : (1ull << mDenseSize) - 1;
+
   auto outColIter = mainCols.rbegin();
   auto rowIter = mainRows.rbegin();
 
@@ -1329,24 +1334,11 @@ void Paxos<IdxType>::backfillBinary(span<IdxType> mainRows,
       h.add(y, P[cc]);
     }
 
-    assert(mDenseSize <= 64);
-    // TODO, merge these two if statements
-    if (prng) {
-      auto d = mDense[i].template get<u64>(0);
-      for (u64 j = 0; j < mDenseSize; ++j) {
-        if (d & 1) {
-          // y += p2[j]
-          h.add(y, p2[j]);
-        }
-        d >>= 1;
-      }
-    } else {
-      for (u64 j = 0; j < g; ++j) {
-        assert(mDenseSize <= 64);
-        if (mDense[i].template get<u64>(0) & denseMasks[j]) {
-          h.add(y, p2[gapCols[j]]);
-        }
-      }
+    // y += p2[j] for the set bits j of the dense row.
+    auto d = mDense[i].template get<u64>(0) & denseMask;
+    while (d) {
+      h.add(y, p2[__builtin_ctzll(d)]);
+      d &= d - 1;
     }
 
     h.assign(P[c], y);
@@ -1531,6 +1523,11 @@ void Paxos<IdxType>::decode32(const IdxType *rows_, const block *dense_,
 
   const ValueType *__restrict p = p_[0];
 
+  // The sparse columns are scattered over the bin, issue all the loads of
+  // the batch first so the misses overlap.
+  for (u64 k = 0; k < 32 * mWeight; ++k)
+    _mm_prefetch((const char *)h.iterPlus(p, rows_[k]), _MM_HINT_T0);
+
   for (u64 j = 0; j < 4; ++j) {
     const IdxType *__restrict rows = rows_ + j * 8 * mWeight;
     ValueType *__restrict values = h.iterPlus(values_, j * 8);
@@ -1938,11 +1935,13 @@ void Paxos<IdxType>::decode1(const IdxType *rows, const block *dense,
       // values[0] = values[0] ^ x.gf128Mul(p2[i + mSparseSize]);
     }
   } else {
-    for (u64 i = 0; i < mDenseSize; ++i) {
-      if (*BitIterator((u8 *)dense, i)) {
-        // values[0] = values[0] ^ p[i + mSparseSize];
-        h.add(values, p[i + mSparseSize]);
-      }
+    assert(mDenseSize <= 64);
+    auto d = dense->get<u64>(0);
+    if (mDenseSize < 64) d &= (1ull << mDenseSize) - 1;
+    while (d) {
+      // values[0] = values[0] ^ p[i + mSparseSize];
+      h.add(values, p[__builtin_ctzll(d) + mSparseSize]);
+      d &= d - 1;
     }
   }
 }
@@ -2227,21 +2226,21 @@ inline u64 Baxos::getBinSize(u64 numBins, u64 numBalls, u64 statSecParam) {
 
 template <typename ValueType>
 void Baxos::solve(span<const block> inputs, span<const ValueType> values,
-                  span<ValueType> output, PRNG *prng, u64 numThreads) {
+                  span<ValueType> output, PRNG *prng, Workers workers) {
   PxVector<const ValueType> V(values);
   PxVector<ValueType> P(output);
   auto h = P.defaultHelper();
-  solve(inputs, V, P, prng, numThreads, h);
+  solve(inputs, V, P, prng, workers, h);
 }
 
 template <typename ValueType>
 void Baxos::solve(span<const block> inputs, MatrixView<const ValueType> values,
-                  MatrixView<ValueType> output, PRNG *prng, u64 numThreads) {
+                  MatrixView<ValueType> output, PRNG *prng, Workers workers) {
   if (values.cols() != output.cols()) throw RTE_LOC;
 
   if (values.cols() == 1) {
     solve(inputs, span<const ValueType>(values), span<ValueType>(output), prng,
-          numThreads);
+          workers);
   } else if (values.cols() * sizeof(ValueType) % sizeof(block) == 0 &&
              std::is_same<ValueType, block>::value == false) {
     // reduce ValueType to block if possible.
@@ -2251,37 +2250,37 @@ void Baxos::solve(span<const block> inputs, MatrixView<const ValueType> values,
 
     solve<block>(inputs, MatrixView<const block>((block *)values.data(), n, m),
                  MatrixView<block>((block *)output.data(), output.rows(), m),
-                 prng, numThreads);
+                 prng, workers);
   } else {
     PxMatrix<const ValueType> V(values);
     PxMatrix<ValueType> P(output);
     auto h = P.defaultHelper();
-    solve(inputs, V, P, prng, numThreads, h);
+    solve(inputs, V, P, prng, workers, h);
   }
 }
 
 template <typename Vec, typename ConstVec, typename Helper>
 void Baxos::solve(span<const block> inputs, ConstVec &V, Vec &P, PRNG *prng,
-                  u64 numThreads, Helper &h) {
+                  Workers workers, Helper &h) {
   // select the smallest index type which will work.
   auto bitLength =
       oc::roundUpTo(oc::log2ceil((u64)(mPaxosParam.mSparseSize + 1)), 8);
 
   if (bitLength <= 8)
-    implParSolve<u8>(inputs, V, P, prng, numThreads, h);
+    implParSolve<u8>(inputs, V, P, prng, workers, h);
   else if (bitLength <= 16)
-    implParSolve<u16>(inputs, V, P, prng, numThreads, h);
+    implParSolve<u16>(inputs, V, P, prng, workers, h);
   else if (bitLength <= 32)
-    implParSolve<u32>(inputs, V, P, prng, numThreads, h);
+    implParSolve<u32>(inputs, V, P, prng, workers, h);
   else
-    implParSolve<u64>(inputs, V, P, prng, numThreads, h);
+    implParSolve<u64>(inputs, V, P, prng, workers, h);
 
   if (mDebug) this->check(inputs, V, P);
 }
 
 template <typename IdxType, typename Vec, typename ConstVec, typename Helper>
 void Baxos::implParSolve(span<const block> inputs_, ConstVec &vals_, Vec &p_,
-                         PRNG *prng, u64 numThreads, Helper &h) {
+                         PRNG *prng, Workers workers, Helper &h) {
 #ifndef NDEBUG
   {
     std::unordered_set<block> inputSet;
@@ -2307,7 +2306,7 @@ void Baxos::implParSolve(span<const block> inputs_, ConstVec &vals_, Vec &p_,
     return;
   }
 
-  numThreads = std::max<u64>(1, numThreads);
+  u64 numThreads = workers.size();
 
   static constexpr const u64 batchSize = 32;
 
@@ -2367,10 +2366,6 @@ void Baxos::implParSolve(span<const block> inputs_, ConstVec &vals_, Vec &p_,
   libdivide::libdivide_u64_t divider = libdivide::libdivide_u64_gen(mNumBins);
   AES hasher(mSeed);
 
-  std::atomic<u64> numDone(0);
-  std::promise<void> hashingDoneProm;
-  auto hashingDoneFu = hashingDoneProm.get_future().share();
-
   auto routine = [&](u64 thrdIdx) {
     auto begin = (inputs_.size() * thrdIdx) / numThreads;
     auto end = (inputs_.size() * (thrdIdx + 1)) / numThreads;
@@ -2428,22 +2423,13 @@ void Baxos::implParSolve(span<const block> inputs_, ConstVec &vals_, Vec &p_,
         getHashes(thrdIdx, binIdx)[bs] = hashes[k];
       }
     }
+  };
 
+  // once all items are mapped, task thrdIdx solves the bins
+  // binIdx = thrdIdx mod numThreads.
+  auto solveRoutine = [&](u64 thrdIdx) {
     auto paxosSizePer = mPaxosParam.size();
-    auto allocSize = sizeof(IdxType) * (mItemsPerBin * mWeight * 2 +
-                                        mPaxosParam.mSparseSize) +
-                     sizeof(span<IdxType>) * mPaxosParam.mSparseSize /*+
-                     sizeof(block) * mItemsPerBin*/
-        ;
-
-    std::unique_ptr<u8[]> allocation(new u8[allocSize]);
-
-    // block until all threads have mapped all items.
-    if (++numDone == numThreads)
-      hashingDoneProm.set_value();
-    else
-      hashingDoneFu.get();
-
+    std::unique_ptr<u8[]> allocation;
     Paxos<IdxType> paxos;
 
     // this thread will iterator over its assigned bins. This thread
@@ -2454,21 +2440,6 @@ void Baxos::implParSolve(span<const block> inputs_, ConstVec &vals_, Vec &p_,
       u64 binSize = 0;
       for (u64 i = 0; i < numThreads; ++i) binSize += thrdBinSizes(i, binIdx);
 
-      if (binSize > mItemsPerBin) throw RTE_LOC;
-
-      paxos.init(binSize, mPaxosParam, mSeed);
-
-      auto iter = allocation.get();
-      // span<block> hashes = initSpan<block>(iter, binSize);
-      MatrixView<IdxType> rows = initMV<IdxType>(iter, binSize, mWeight);
-      span<IdxType> colBacking = initSpan<IdxType>(iter, binSize * mWeight);
-      span<IdxType> colWeights =
-          initSpan<IdxType>(iter, mPaxosParam.mSparseSize);
-      span<span<IdxType>> cols =
-          initSpan<span<IdxType>>(iter, mPaxosParam.mSparseSize);
-
-      if (iter > allocation.get() + allocSize) throw RTE_LOC;
-
       auto binBegin = combinedMaxBinSize * binIdx;
       auto values = valBacking.subspan(binBegin, binSize);
       auto hashes = span<block>(hashBacking.get() + binBegin, binSize);
@@ -2486,99 +2457,115 @@ void Baxos::implParSolve(span<const block> inputs_, ConstVec &vals_, Vec &p_,
         auto thrdHashes = getHashes(i, binIdx);
         auto thrdVals = getValues(i, binIdx);
 
-        // u8* db = (u8*)(hashes.data() + binPos);
-        // u8* de = db + size * sizeof(block);
-        // u8* sb = (u8*)thrdHashes.data();
-        // u8* se = sb + size * sizeof(block);
-
-        // if ((block*)sb != hashes.data() + i * perThrdMaxBinSize)
-        //	throw RTE_LOC;
-
-        // if(de > sb)
-        //	throw RTE_LOC;
-
         memmove(hashes.data() + binPos, thrdHashes.data(),
                 size * sizeof(block));
-        // memcpy(values.data() + binPos, thrdVals.data() , size *
-        // sizeof(block));
         for (u64 j = 0; j < size; ++j)
           h.assign(values[binPos + j], thrdVals[j]);
 
         binPos += size;
-        // auto mapping = getThrdMapping(i);
-        // auto m = thrdBinSizes(i, binIdx);
-        // for (u64 j = 0; j < m; ++j, ++binPos)
-        //{
-        //    auto inIdx = mapping(binIdx, j);
-        //    hashes[binPos] = hashes_[inIdx];
-        //    h.assign(values[binPos], vals_[inIdx]);
-        //}
       }
 
-      // compute the rows and count the column weight.
-      std::memset(colWeights.data(), 0, colWeights.size() * sizeof(IdxType));
-      auto rIter = rows.data();
-      if (mWeight == 3) {
-        auto main = binSize / batchSize * batchSize;
-
-        u64 i = 0;
-        for (; i < main; i += batchSize) {
-          paxos.mHasher.buildRow32(&hashes[i], rIter);
-          for (u64 j = 0; j < batchSize; ++j) {
-            ++colWeights[rIter[0]];
-            ++colWeights[rIter[1]];
-            ++colWeights[rIter[2]];
-            rIter += mWeight;
-          }
-        }
-        for (; i < binSize; ++i) {
-          paxos.mHasher.buildRow(hashes[i], rIter);
-
-          ++colWeights[rIter[0]];
-          ++colWeights[rIter[1]];
-          ++colWeights[rIter[2]];
-          rIter += mWeight;
-        }
-      } else {
-        for (u64 i = 0; i < binSize; ++i) {
-          paxos.mHasher.buildRow(hashes[i], rIter);
-          for (u64 k = 0; k < mWeight; ++k) ++colWeights[rIter[k]];
-          rIter += mWeight;
-        }
-      }
-
-      paxos.setInput(rows, hashes, cols, colBacking, colWeights);
-      paxos.encode(values, output, h, prng);
+      implSolveBin(hashes, values, output, prng, h, paxos, allocation);
     }
   };
 
-  std::vector<std::thread> thrds(numThreads - 1);
+  workers.run(routine);
+  workers.run(solveRoutine);
+}
+
+template <typename IdxType, typename Vec, typename ConstVec, typename Helper>
+void Baxos::implSolveBin(span<block> hashes, ConstVec &values, Vec &output,
+                         PRNG *prng, Helper &h, Paxos<IdxType> &paxos,
+                         std::unique_ptr<u8[]> &allocation) {
+  static constexpr const u64 batchSize = 32;
+  auto binSize = hashes.size();
+  if (binSize > mItemsPerBin) throw RTE_LOC;
+
+  auto allocSize = sizeof(IdxType) * (mItemsPerBin * mWeight * 2 +
+                                      mPaxosParam.mSparseSize) +
+                   sizeof(span<IdxType>) * mPaxosParam.mSparseSize;
+  if (!allocation) allocation.reset(new u8[allocSize]);
+
+  paxos.init(binSize, mPaxosParam, mSeed);
 
-  for (u64 i = 0; i < thrds.size(); ++i) thrds[i] = std::thread(routine, i);
+  auto iter = allocation.get();
+  MatrixView<IdxType> rows = initMV<IdxType>(iter, binSize, mWeight);
+  span<IdxType> colBacking = initSpan<IdxType>(iter, binSize * mWeight);
+  span<IdxType> colWeights = initSpan<IdxType>(iter, mPaxosParam.mSparseSize);
+  span<span<IdxType>> cols =
+      initSpan<span<IdxType>>(iter, mPaxosParam.mSparseSize);
 
-  routine(thrds.size());
+  if (iter > allocation.get() + allocSize) throw RTE_LOC;
 
-  for (u64 i = 0; i < thrds.size(); ++i) thrds[i].join();
+  // compute the rows and count the column weight.
+  std::memset(colWeights.data(), 0, colWeights.size() * sizeof(IdxType));
+  auto rIter = rows.data();
+  if (mWeight == 3) {
+    auto main = binSize / batchSize * batchSize;
+
+    u64 i = 0;
+    for (; i < main; i += batchSize) {
+      paxos.mHasher.buildRow32(&hashes[i], rIter);
+      for (u64 j = 0; j < batchSize; ++j) {
+        ++colWeights[rIter[0]];
+        ++colWeights[rIter[1]];
+        ++colWeights[rIter[2]];
+        rIter += mWeight;
+      }
+    }
+    for (; i < binSize; ++i) {
+      paxos.mHasher.buildRow(hashes[i], rIter);
+
+      ++colWeights[rIter[0]];
+      ++colWeights[rIter[1]];
+      ++colWeights[rIter[2]];
+      rIter += mWeight;
+    }
+  } else {
+    for (u64 i = 0; i < binSize; ++i) {
+      paxos.mHasher.buildRow(hashes[i], rIter);
+      for (u64 k = 0; k < mWeight; ++k) ++colWeights[rIter[k]];
+      rIter += mWeight;
+    }
+  }
+
+  paxos.setInput(rows, hashes, cols, colBacking, colWeights);
+  paxos.encode(values, output, h, prng);
 }
 
 template <typename ValueType>
 void Baxos::decode(span<const block> inputs, span<ValueType> values,
-                   span<const ValueType> p, u64 numThreads) {
+                   span<const ValueType> p, Workers workers) {
+  PxVector<ValueType> V(values);
+  PxVector<const ValueType> P(p);
+  auto h = V.defaultHelper();
+
+  decode(inputs, V, P, h, workers);
+}
+
+template <typename ValueType, typename Post>
+void Baxos::decode(span<const block> inputs, span<ValueType> values,
+                   span<const ValueType> p, Workers workers, const Post &post) {
+  if (mAddToDecode) throw RTE_LOC;
+
   PxVector<ValueType> V(values);
   PxVector<const ValueType> P(p);
   auto h = V.defaultHelper();
 
-  decode(inputs, V, P, h, numThreads);
+  auto vecPost = [&](span<const u64> idxs, auto &buff) {
+    post(idxs, span<ValueType>(buff[0], idxs.size()));
+  };
+  decode(inputs, V, P, h, workers, vecPost);
 }
 
 template <typename ValueType>
 void Baxos::decode(span<const block> inputs, MatrixView<ValueType> values,
-                   MatrixView<const ValueType> p, u64 numThreads) {
+                   MatrixView<const ValueType> p, Workers workers) {
   if (values.cols() != p.cols()) throw RTE_LOC;
 
   if (values.cols() == 1) {
     decode(inputs, span<ValueType>(values), span<const ValueType>(p),
-           numThreads);
+           workers);
   } else if (values.cols() * sizeof(ValueType) % sizeof(block) == 0 &&
              std::is_same<ValueType, block>::value == false) {
     // reduce ValueType to block if possible.
@@ -2587,54 +2574,73 @@ void Baxos::decode(span<const block> inputs, MatrixView<ValueType> values,
     auto m = values.cols() * sizeof(ValueType) / sizeof(block);
 
     decode<block>(inputs, MatrixView<block>((block *)values.data(), n, m),
-                  MatrixView<const block>((block *)p.data(), p.rows(), m));
+                  MatrixView<const block>((block *)p.data(), p.rows(), m),
+                  workers);
   } else {
     PxMatrix<ValueType> V(values);
     PxMatrix<const ValueType> P(p);
     auto h = V.defaultHelper();
 
-    decode(inputs, V, P, h, numThreads);
+    decode(inputs, V, P, h, workers);
   }
 }
 
-template <typename Vec, typename ConstVec, typename Helper>
+template <typename Vec, typename ConstVec, typename Helper, typename Post>
 void Baxos::decode(span<const block> inputs, Vec &V, ConstVec &P, Helper &h,
-                   u64 numThreads) {
+                   Workers workers, const Post &post) {
   auto bitLength =
       oc::roundUpTo(oc::log2ceil((u64)(mPaxosParam.mSparseSize + 1)), 8);
   if (bitLength <= 8)
-    implParDecode<u8>(inputs, V, P, h, numThreads);
+    implParDecode<u8>(inputs, V, P, h, workers, post);
   else if (bitLength <= 16)
-    implParDecode<u16>(inputs, V, P, h, numThreads);
+    implParDecode<u16>(inputs, V, P, h, workers, post);
   else if (bitLength <= 32)
-    implParDecode<u32>(inputs, V, P, h, numThreads);
+    implParDecode<u32>(inputs, V, P, h, workers, post);
   else
-    implParDecode<u64>(inputs, V, P, h, numThreads);
+    implParDecode<u64>(inputs, V, P, h, workers, post);
 }
 
-template <typename IdxType, typename Vec, typename ConstVec, typename Helper>
+template <typename IdxType, typename Vec, typename ConstVec, typename Helper,
+          typename Post>
 void Baxos::implDecodeBin(u64 binIdx, span<block> hashes, Vec &values,
                           Vec &valuesBuff, span<u64> inIdxs, ConstVec &PP,
-                          Helper &h, Paxos<IdxType> &paxos) {
+                          Helper &h, Paxos<IdxType> &paxos,
+                          const Post &post) {
   constexpr u64 batchSize = 32;
+  constexpr bool hasPost = !std::is_same<Post, NoDecodePost>::value;
   constexpr u64 maxWeightSize = 20;
 
   auto main = (hashes.size() / batchSize) * batchSize;
 
   assert(mWeight <= maxWeightSize);
-  std::array<IdxType, maxWeightSize * batchSize> _backing;
-  MatrixView<IdxType> row(_backing.data(), batchSize, mWeight);
+  std::array<IdxType, maxWeightSize * batchSize * 2> _backing;
+  MatrixView<IdxType> rows[2] = {
+      MatrixView<IdxType>(_backing.data(), batchSize, mWeight),
+      MatrixView<IdxType>(_backing.data() + maxWeightSize * batchSize,
+                          batchSize, mWeight)};
+  auto &row = rows[0];
   assert(valuesBuff.size() >= batchSize);
-  // std::array<block, decodeSize> vals;
 
-  // todo, parallelize this
+  // The rows of the next batch are built and their sparse columns
+  // prefetched before the current batch is decoded, so that the misses
+  // overlap with the gathers of the current batch.
+  auto p0 = PP[0];
+  if (main) paxos.mHasher.buildRow32(&hashes[0], rows[0].data());
+
   u64 i = 0;
-  // std::array<block, decodeSize> dense;
-  for (; i < main; i += batchSize) {
-    // for (u64 k = 0; k < decodeSize; ++k)
-    //	paxos.mHasher.buildRow(hashes[i + k], row.data() + mWeight * k);
-    paxos.mHasher.buildRow32(&hashes[i], row.data());
-    paxos.decode32(row.data(), &hashes[i], valuesBuff[0], PP, h);
+  for (u64 b = 0; i < main; i += batchSize, ++b) {
+    auto &cur = rows[b & 1];
+    auto &next = rows[~b & 1];
+    if (i + batchSize < main) {
+      paxos.mHasher.buildRow32(&hashes[i + batchSize], next.data());
+      for (u64 k = 0; k < batchSize * mWeight; ++k)
+        _mm_prefetch((const char *)h.iterPlus(p0, next.data()[k]),
+                     _MM_HINT_T0);
+    }
+
+    paxos.decode32(cur.data(), &hashes[i], valuesBuff[0], PP, h);
+    if constexpr (hasPost)
+      post(span<const u64>(&inIdxs[i], batchSize), valuesBuff);
 
     if (mAddToDecode) {
       for (u64 k = 0; k < batchSize; ++k)
@@ -2645,6 +2651,21 @@ void Baxos::implDecodeBin(u64 binIdx, span<block> hashes, Vec &values,
     }
   }
 
+  if constexpr (hasPost) {
+    // the tail is decoded into valuesBuff so that post sees it as a batch.
+    auto tail = hashes.size() - i;
+    if (tail == 0) return;
+
+    for (u64 k = 0; k < tail; ++k) {
+      paxos.mHasher.buildRow(hashes[i + k], row.data());
+      paxos.decode1(row.data(), &hashes[i + k], valuesBuff[k], PP, h);
+    }
+    post(span<const u64>(&inIdxs[i], tail), valuesBuff);
+    for (u64 k = 0; k < tail; ++k)
+      h.assign(values[inIdxs[i + k]], valuesBuff[k]);
+    return;
+  }
+
   for (; i < hashes.size(); ++i) {
     paxos.mHasher.buildRow(hashes[i], row.data());
     auto v = values[inIdxs[i]];
@@ -2657,9 +2678,10 @@ void Baxos::implDecodeBin(u64 binIdx, span<block> hashes, Vec &values,
   }
 }
 
-template <typename IdxType, typename Vec, typename ConstVec, typename Helper>
+template <typename IdxType, typename Vec, typename ConstVec, typename Helper,
+          typename Post>
 void Baxos::implDecodeBatch(span<const block> inputs, Vec &values, ConstVec &pp,
-                            Helper &h) {
+                            Helper &h, const Post &post) {
   u64 decodeSize = std::min<u64>(512, inputs.size());
   Matrix<block> batches(mNumBins, decodeSize);
   Matrix<u64> inIdxs(mNumBins, decodeSize);
@@ -2711,7 +2733,8 @@ void Baxos::implDecodeBatch(span<const block> inputs, Vec &values, ConstVec &pp,
       if (batchSizes[binIdx] == decodeSize) {
         auto p = pp.subspan(binIdx * sizePer, sizePer);
         auto idxs = inIdxs[binIdx];
-        implDecodeBin(binIdx, batches[binIdx], values, buff, idxs, p, h, paxos);
+        implDecodeBin(binIdx, batches[binIdx], values, buff, idxs, p, h, paxos,
+                      post);
 
         batchSizes[binIdx] = 0;
       }
@@ -2737,7 +2760,7 @@ void Baxos::implDecodeBatch(span<const block> inputs, Vec &values, ConstVec &pp,
     if (batchSizes[binIdx] == decodeSize) {
       auto p = pp.subspan(binIdx * sizePer, sizePer);
       implDecodeBin(binIdx, batches[binIdx], values, buff, inIdxs[binIdx], p, h,
-                    paxos);
+                    paxos, post);
 
       batchSizes[binIdx] = 0;
     }
@@ -2747,38 +2770,195 @@ void Baxos::implDecodeBatch(span<const block> inputs, Vec &values, ConstVec &pp,
     if (batchSizes[binIdx]) {
       auto p = pp.subspan(binIdx * sizePer, sizePer);
       auto b = batches[binIdx].subspan(0, batchSizes[binIdx]);
-      implDecodeBin(binIdx, b, values, buff, inIdxs[binIdx], p, h, paxos);
+      implDecodeBin(binIdx, b, values, buff, inIdxs[binIdx], p, h, paxos, post);
     }
   }
 }
 
-template <typename IdxType, typename Vec, typename ConstVec, typename Helper>
+template <typename IdxType, typename Vec, typename ConstVec, typename Helper,
+          typename Post>
 void Baxos::implParDecode(span<const block> inputs, Vec &values, ConstVec &pp,
-                          Helper &h, u64 numThreads) {
+                          Helper &h, Workers workers, const Post &post) {
+  constexpr bool hasPost = !std::is_same<Post, NoDecodePost>::value;
+  mDecodeStats = DecodeStats{};
+  mDecodeStats.mItems = inputs.size();
+
+  // With fewer than a batch of items per bin, sorting does not pay off and
+  // the per bin buffers of implDecodeBatch are used instead.
+  if (mNumBins > 1 && inputs.size() >= mNumBins * 32) {
+    implDecodeSorted<IdxType>(inputs, values, pp, h, workers, post);
+    return;
+  }
+
+  auto start = std::chrono::steady_clock::now();
   if (mNumBins == 1) {
     Paxos<IdxType> paxos;
     paxos.init(1, mPaxosParam, mSeed);
     paxos.mAddToDecode = mAddToDecode;
     paxos.decode(inputs, values, pp, h);
-    return;
+
+    // Paxos decodes straight into values, post is applied to them in place.
+    if constexpr (hasPost) {
+      std::array<u64, 32> idxs;
+      for (u64 i = 0; i < inputs.size(); i += idxs.size()) {
+        auto size = std::min<u64>(idxs.size(), inputs.size() - i);
+        for (u64 k = 0; k < size; ++k) idxs[k] = i + k;
+        auto batch = values.subspan(i, size);
+        post(span<const u64>(idxs.data(), size), batch);
+      }
+    }
+  } else {
+    u64 numThreads = workers.size();
+
+    auto routine = [&](u64 i) {
+      auto begin = (inputs.size() * i) / numThreads;
+      auto end = (inputs.size() * (i + 1)) / numThreads;
+      span<const block> in(inputs.begin() + begin, inputs.begin() + end);
+      auto va = values.subspan(begin, end - begin);
+      if constexpr (hasPost) {
+        // implDecodeBatch indexes the items of the task from 0.
+        auto taskPost = [&](span<const u64> idxs, auto &buff) {
+          std::array<u64, 32> inIdxs;
+          for (u64 k = 0; k < idxs.size(); ++k) inIdxs[k] = idxs[k] + begin;
+          post(span<const u64>(inIdxs.data(), idxs.size()), buff);
+        };
+        implDecodeBatch<IdxType>(in, va, pp, h, taskPost);
+      } else
+        implDecodeBatch<IdxType>(in, va, pp, h, post);
+    };
+
+    workers.run(routine);
   }
 
-  numThreads = std::max<u64>(numThreads, 1ull);
+  mDecodeStats.mDecodeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                               std::chrono::steady_clock::now() - start)
+                               .count();
+}
+
+template <typename IdxType, typename Vec, typename ConstVec, typename Helper,
+          typename Post>
+void Baxos::implDecodeSorted(span<const block> inputs, Vec &values,
+                             ConstVec &pp, Helper &h, Workers workers,
+                             const Post &post) {
+  static constexpr const u64 batchSize = 32;
+  auto start = std::chrono::steady_clock::now();
+
+  u64 n = inputs.size();
+  u64 numThreads = workers.size();
+
+  // the hash and bin of each input, in input order.
+  std::unique_ptr<block[]> hashes(new block[n]);
+  std::unique_ptr<u32[]> binIdxs(new u32[n]);
+
+  // the number of items each thread maps to each bin. After the prefix sum
+  // below, where the next item of the thread, bin goes.
+  Matrix<u64> thrdBinPos(numThreads, mNumBins);
+
+  libdivide::libdivide_u64_t divider = libdivide::libdivide_u64_gen(mNumBins);
+  AES hasher(mSeed);
 
-  std::vector<std::thread> thrds(numThreads - 1);
-  auto routine = [&](u64 i) {
-    auto begin = (inputs.size() * i) / numThreads;
-    auto end = (inputs.size() * (i + 1)) / numThreads;
-    span<const block> in(inputs.begin() + begin, inputs.begin() + end);
-    auto va = values.subspan(begin, end - begin);
-    implDecodeBatch<IdxType>(in, va, pp, h);
+  auto hashRoutine = [&](u64 thrdIdx) {
+    auto begin = (n * thrdIdx) / numThreads;
+    auto end = (n * (thrdIdx + 1)) / numThreads;
+    auto binSizes = thrdBinPos[thrdIdx];
+    std::array<u64, batchSize> bins;
+
+    u64 i = begin;
+    auto main = begin + (end - begin) / batchSize * batchSize;
+    for (; i < main; i += batchSize) {
+      auto hh = hashes.get() + i;
+      hasher.hashBlocks<8>(inputs.data() + i + 0, hh + 0);
+      hasher.hashBlocks<8>(inputs.data() + i + 8, hh + 8);
+      hasher.hashBlocks<8>(inputs.data() + i + 16, hh + 16);
+      hasher.hashBlocks<8>(inputs.data() + i + 24, hh + 24);
+
+      for (u64 k = 0; k < batchSize; ++k) bins[k] = binIdxCompress(hh[k]);
+
+      doMod32(bins.data(), &divider, mNumBins);
+
+      for (u64 k = 0; k < batchSize; ++k) {
+        binIdxs[i + k] = static_cast<u32>(bins[k]);
+        ++binSizes[bins[k]];
+      }
+    }
+
+    for (; i < end; ++i) {
+      hashes[i] = hasher.hashBlock(inputs[i]);
+      binIdxs[i] = static_cast<u32>(modNumBins(hashes[i]));
+      ++binSizes[binIdxs[i]];
+    }
   };
 
-  for (u64 i = 0; i < thrds.size(); ++i) thrds[i] = std::thread(routine, i);
+  workers.run(hashRoutine);
+
+  // bins are laid out in order and, within a bin, the items of thread 0
+  // come first. Items therefore keep their input order within a bin.
+  std::vector<u64> binBegin(mNumBins + 1);
+  u64 pos = 0;
+  for (u64 binIdx = 0; binIdx < mNumBins; ++binIdx) {
+    binBegin[binIdx] = pos;
+    for (u64 t = 0; t < numThreads; ++t) {
+      auto size = thrdBinPos(t, binIdx);
+      thrdBinPos(t, binIdx) = pos;
+      pos += size;
+    }
+  }
+  binBegin[mNumBins] = pos;
+  assert(pos == n);
+
+  std::unique_ptr<block[]> sortedHashes(new block[n]);
+  std::unique_ptr<u64[]> sortedIdxs(new u64[n]);
+
+  auto scatterRoutine = [&](u64 thrdIdx) {
+    auto begin = (n * thrdIdx) / numThreads;
+    auto end = (n * (thrdIdx + 1)) / numThreads;
+    auto binPos = thrdBinPos[thrdIdx];
+
+    for (u64 i = begin; i < end; ++i) {
+      auto dest = binPos[binIdxs[i]]++;
+      sortedHashes[dest] = hashes[i];
+      sortedIdxs[dest] = i;
+    }
+  };
+
+  workers.run(scatterRoutine);
+  hashes.reset();
+  binIdxs.reset();
+
+  auto sorted = std::chrono::steady_clock::now();
+
+  // task thrdIdx decodes the bins [thrdIdx * mNumBins / numThreads, ...).
+  auto sizePer = size() / mNumBins;
+  auto decodeRoutine = [&](u64 thrdIdx) {
+    auto binEnd = (mNumBins * (thrdIdx + 1)) / numThreads;
+
+    Paxos<IdxType> paxos;
+    paxos.init(1, mPaxosParam, mSeed);
+    auto buff = h.newVec(batchSize);
+
+    for (u64 binIdx = (mNumBins * thrdIdx) / numThreads; binIdx < binEnd;
+         ++binIdx) {
+      auto begin = binBegin[binIdx];
+      auto size = binBegin[binIdx + 1] - begin;
+      if (size == 0) continue;
+
+      auto p = pp.subspan(binIdx * sizePer, sizePer);
+      span<block> binHashes(sortedHashes.get() + begin, size);
+      span<u64> inIdxs(sortedIdxs.get() + begin, size);
+      implDecodeBin(binIdx, binHashes, values, buff, inIdxs, p, h, paxos,
+                    post);
+    }
+  };
 
-  routine(thrds.size());
+  workers.run(decodeRoutine);
 
-  for (u64 i = 0; i < thrds.size(); ++i) thrds[i].join();
+  auto end = std::chrono::steady_clock::now();
+  mDecodeStats.mSortNs =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(sorted - start)
+          .count();
+  mDecodeStats.mDecodeNs =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(end - sorted)
+          .count();
 }
 
 }  // namespace primihub::crypto::okvs
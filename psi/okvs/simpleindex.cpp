@@ -2,13 +2,18 @@
 
 #include <boost/math/special_functions/binomial.hpp>
 #include <boost/multiprecision/cpp_bin_float.hpp>
+#include <array>
 #include <cassert>
+#include <cstring>
+#include <limits>
 #include <numeric>
 #include <random>
+#include <stdexcept>
 
 #include "cryptoTools/Common/CuckooIndex.h"
 #include "cryptoTools/Common/Log.h"
 #include "cryptoTools/Crypto/PRNG.h"
+#include "psi/okvs/paxos.h"
 
 namespace primihub::crypto::okvs {
 
@@ -987,176 +992,119 @@ void SimpleIndex::init(u64 numBins, u64 numBalls, u64 statSecParam,
   mNumBins = numBins;
 }
 
-void SimpleIndex::insertItems(span<block> items, block hashingSeed) {
-  std::array<block, 8> hashs;
-  oc::AES hasher(hashingSeed);
-
-  auto mainSteps = items.size() / hashs.size();
-  auto remSteps = items.size() % hashs.size();
-  u64 itemIdx = 0;
-  if (mNumHashFunctions == 3) {
-    for (u64 i = 0; i < mainSteps; ++i, itemIdx += 8) {
-      auto min = std::min<u64>(items.size() - itemIdx, hashs.size());
-
-      hasher.ecbEncBlocks(items.data() + itemIdx, min, hashs.data());
-
-      auto itemIdx0 = itemIdx + 0;
-      auto itemIdx1 = itemIdx + 1;
-      auto itemIdx2 = itemIdx + 2;
-      auto itemIdx3 = itemIdx + 3;
-      auto itemIdx4 = itemIdx + 4;
-      auto itemIdx5 = itemIdx + 5;
-      auto itemIdx6 = itemIdx + 6;
-      auto itemIdx7 = itemIdx + 7;
-
-      hashs[0] = hashs[0] ^ items[itemIdx0];
-      hashs[1] = hashs[1] ^ items[itemIdx1];
-      hashs[2] = hashs[2] ^ items[itemIdx2];
-      hashs[3] = hashs[3] ^ items[itemIdx3];
-      hashs[4] = hashs[4] ^ items[itemIdx4];
-      hashs[5] = hashs[5] ^ items[itemIdx5];
-      hashs[6] = hashs[6] ^ items[itemIdx6];
-      hashs[7] = hashs[7] ^ items[itemIdx7];
-
-      auto bIdx00 = oc::CuckooIndex<>::getHash(hashs[0], 0, mNumBins);
-      auto bIdx10 = oc::CuckooIndex<>::getHash(hashs[1], 0, mNumBins);
-      auto bIdx20 = oc::CuckooIndex<>::getHash(hashs[2], 0, mNumBins);
-      auto bIdx30 = oc::CuckooIndex<>::getHash(hashs[3], 0, mNumBins);
-      auto bIdx40 = oc::CuckooIndex<>::getHash(hashs[4], 0, mNumBins);
-      auto bIdx50 = oc::CuckooIndex<>::getHash(hashs[5], 0, mNumBins);
-      auto bIdx60 = oc::CuckooIndex<>::getHash(hashs[6], 0, mNumBins);
-      auto bIdx70 = oc::CuckooIndex<>::getHash(hashs[7], 0, mNumBins);
-
-      mBins(bIdx00, mBinSizes[bIdx00]++).set(itemIdx0, 0, false);
-      mBins(bIdx10, mBinSizes[bIdx10]++).set(itemIdx1, 0, false);
-      mBins(bIdx20, mBinSizes[bIdx20]++).set(itemIdx2, 0, false);
-      mBins(bIdx30, mBinSizes[bIdx30]++).set(itemIdx3, 0, false);
-      mBins(bIdx40, mBinSizes[bIdx40]++).set(itemIdx4, 0, false);
-      mBins(bIdx50, mBinSizes[bIdx50]++).set(itemIdx5, 0, false);
-      mBins(bIdx60, mBinSizes[bIdx60]++).set(itemIdx6, 0, false);
-      mBins(bIdx70, mBinSizes[bIdx70]++).set(itemIdx7, 0, false);
-
-      mItemToBinMap(itemIdx0, 0) = bIdx00;
-      mItemToBinMap(itemIdx1, 0) = bIdx10;
-      mItemToBinMap(itemIdx2, 0) = bIdx20;
-      mItemToBinMap(itemIdx3, 0) = bIdx30;
-      mItemToBinMap(itemIdx4, 0) = bIdx40;
-      mItemToBinMap(itemIdx5, 0) = bIdx50;
-      mItemToBinMap(itemIdx6, 0) = bIdx60;
-      mItemToBinMap(itemIdx7, 0) = bIdx70;
-
-      auto bIdx01 = oc::CuckooIndex<>::getHash(hashs[0], 1, mNumBins);
-      auto bIdx11 = oc::CuckooIndex<>::getHash(hashs[1], 1, mNumBins);
-      auto bIdx21 = oc::CuckooIndex<>::getHash(hashs[2], 1, mNumBins);
-      auto bIdx31 = oc::CuckooIndex<>::getHash(hashs[3], 1, mNumBins);
-      auto bIdx41 = oc::CuckooIndex<>::getHash(hashs[4], 1, mNumBins);
-      auto bIdx51 = oc::CuckooIndex<>::getHash(hashs[5], 1, mNumBins);
-      auto bIdx61 = oc::CuckooIndex<>::getHash(hashs[6], 1, mNumBins);
-      auto bIdx71 = oc::CuckooIndex<>::getHash(hashs[7], 1, mNumBins);
-
-      bool c01 = bIdx00 == bIdx01;
-      bool c11 = bIdx10 == bIdx11;
-      bool c21 = bIdx20 == bIdx21;
-      bool c31 = bIdx30 == bIdx31;
-      bool c41 = bIdx40 == bIdx41;
-      bool c51 = bIdx50 == bIdx51;
-      bool c61 = bIdx60 == bIdx61;
-      bool c71 = bIdx70 == bIdx71;
-
-      mBins(bIdx01, mBinSizes[bIdx01]++).set(itemIdx0, 1, c01);
-      mBins(bIdx11, mBinSizes[bIdx11]++).set(itemIdx1, 1, c11);
-      mBins(bIdx21, mBinSizes[bIdx21]++).set(itemIdx2, 1, c21);
-      mBins(bIdx31, mBinSizes[bIdx31]++).set(itemIdx3, 1, c31);
-      mBins(bIdx41, mBinSizes[bIdx41]++).set(itemIdx4, 1, c41);
-      mBins(bIdx51, mBinSizes[bIdx51]++).set(itemIdx5, 1, c51);
-      mBins(bIdx61, mBinSizes[bIdx61]++).set(itemIdx6, 1, c61);
-      mBins(bIdx71, mBinSizes[bIdx71]++).set(itemIdx7, 1, c71);
-
-      mItemToBinMap(itemIdx0, 1) = bIdx01 | ((u8)c01 & 1) * u64(-1);
-      mItemToBinMap(itemIdx1, 1) = bIdx11 | ((u8)c11 & 1) * u64(-1);
-      mItemToBinMap(itemIdx2, 1) = bIdx21 | ((u8)c21 & 1) * u64(-1);
-      mItemToBinMap(itemIdx3, 1) = bIdx31 | ((u8)c31 & 1) * u64(-1);
-      mItemToBinMap(itemIdx4, 1) = bIdx41 | ((u8)c41 & 1) * u64(-1);
-      mItemToBinMap(itemIdx5, 1) = bIdx51 | ((u8)c51 & 1) * u64(-1);
-      mItemToBinMap(itemIdx6, 1) = bIdx61 | ((u8)c61 & 1) * u64(-1);
-      mItemToBinMap(itemIdx7, 1) = bIdx71 | ((u8)c71 & 1) * u64(-1);
+namespace {
+// The word which CuckooIndex<>::getHash reduces modulo the number of bins,
+// the 64 bits at byte offset 2 * hashIdx of the hash.
+inline u64 hashWord(const block &hash, u64 hashIdx) {
+  u64 w;
+  memcpy(&w, (const u8 *)&hash + 2 * hashIdx, sizeof(w));
+  return w;
+}
+}  // namespace
 
-      auto bIdx02 = oc::CuckooIndex<>::getHash(hashs[0], 2, mNumBins);
-      auto bIdx12 = oc::CuckooIndex<>::getHash(hashs[1], 2, mNumBins);
-      auto bIdx22 = oc::CuckooIndex<>::getHash(hashs[2], 2, mNumBins);
-      auto bIdx32 = oc::CuckooIndex<>::getHash(hashs[3], 2, mNumBins);
-      auto bIdx42 = oc::CuckooIndex<>::getHash(hashs[4], 2, mNumBins);
-      auto bIdx52 = oc::CuckooIndex<>::getHash(hashs[5], 2, mNumBins);
-      auto bIdx62 = oc::CuckooIndex<>::getHash(hashs[6], 2, mNumBins);
-      auto bIdx72 = oc::CuckooIndex<>::getHash(hashs[7], 2, mNumBins);
+void SimpleIndex::insertItems(span<block> items, block hashingSeed,
+                              Workers workers) {
+  static constexpr const u64 batchSize = 32;
+  auto n = items.size();
+  auto numHashes = mNumHashFunctions;
+  if (n > mItemToBinMap.rows() || numHashes > 4 ||
+      mNumBins > std::numeric_limits<u32>::max())
+    throw RTE_LOC;
 
-      bool c02 = bIdx00 == bIdx02 || bIdx01 == bIdx02;
-      bool c12 = bIdx10 == bIdx12 || bIdx11 == bIdx12;
-      bool c22 = bIdx20 == bIdx22 || bIdx21 == bIdx22;
-      bool c32 = bIdx30 == bIdx32 || bIdx31 == bIdx32;
-      bool c42 = bIdx40 == bIdx42 || bIdx41 == bIdx42;
-      bool c52 = bIdx50 == bIdx52 || bIdx51 == bIdx52;
-      bool c62 = bIdx60 == bIdx62 || bIdx61 == bIdx62;
-      bool c72 = bIdx70 == bIdx72 || bIdx71 == bIdx72;
+  // the items are split into numTasks ranges, and so are the bins.
+  u64 numTasks = std::max<u64>(
+      1, std::min<u64>(workers.size(), oc::divCeil(n, batchSize)));
+  auto itemBegin = [&](u64 t) { return n * t / numTasks; };
+  auto binRange = [&](u64 bIdx) { return bIdx * numTasks / mNumBins; };
 
-      mBins(bIdx02, mBinSizes[bIdx02]++).set(itemIdx0, 2, c02);
-      mBins(bIdx12, mBinSizes[bIdx12]++).set(itemIdx1, 2, c12);
-      mBins(bIdx22, mBinSizes[bIdx22]++).set(itemIdx2, 2, c22);
-      mBins(bIdx32, mBinSizes[bIdx32]++).set(itemIdx3, 2, c32);
-      mBins(bIdx42, mBinSizes[bIdx42]++).set(itemIdx4, 2, c42);
-      mBins(bIdx52, mBinSizes[bIdx52]++).set(itemIdx5, 2, c52);
-      mBins(bIdx62, mBinSizes[bIdx62]++).set(itemIdx6, 2, c62);
-      mBins(bIdx72, mBinSizes[bIdx72]++).set(itemIdx7, 2, c72);
+  // (i, h) is the bin of item i under hash h.
+  std::vector<u32> itemBins(n * numHashes);
+  auto collision = [&](u64 i, u64 h) {
+    bool c = false;
+    for (u64 hh = 0; hh < h; ++hh)
+      c |= itemBins[i * numHashes + hh] == itemBins[i * numHashes + h];
+    return c;
+  };
 
-      mItemToBinMap(itemIdx0, 2) = bIdx02 | ((u8)c02 & 1) * u64(-1);
-      mItemToBinMap(itemIdx1, 2) = bIdx12 | ((u8)c12 & 1) * u64(-1);
-      mItemToBinMap(itemIdx2, 2) = bIdx22 | ((u8)c22 & 1) * u64(-1);
-      mItemToBinMap(itemIdx3, 2) = bIdx32 | ((u8)c32 & 1) * u64(-1);
-      mItemToBinMap(itemIdx4, 2) = bIdx42 | ((u8)c42 & 1) * u64(-1);
-      mItemToBinMap(itemIdx5, 2) = bIdx52 | ((u8)c52 & 1) * u64(-1);
-      mItemToBinMap(itemIdx6, 2) = bIdx62 | ((u8)c62 & 1) * u64(-1);
-      mItemToBinMap(itemIdx7, 2) = bIdx72 | ((u8)c72 & 1) * u64(-1);
-    }
+  // pass one, hash the items and count how many items of each item range
+  // go to each bin range.
+  Matrix<u64> counts(numTasks, numTasks);
+  auto libdivider = libdivide::libdivide_u64_gen(mNumBins);
+  workers.parallelFor(numTasks, [&](u64 t) {
+    oc::AES hasher(hashingSeed);
+    std::array<block, batchSize> hashes;
+    std::vector<u64> binIdxs(numHashes * batchSize);
+    auto count = counts[t];
+    auto end = itemBegin(t + 1);
 
-    hasher.ecbEncBlocks(items.data() + itemIdx, remSteps, hashs.data());
-    for (u64 i = 0; i < remSteps; ++i) {
-      hashs[i] = hashs[i] ^ items[itemIdx + i];
+    for (u64 begin = itemBegin(t); begin < end; begin += batchSize) {
+      auto size = std::min<u64>(batchSize, end - begin);
+      hasher.ecbEncBlocks(items.data() + begin, size, hashes.data());
+      for (u64 k = 0; k < size; ++k) hashes[k] = hashes[k] ^ items[begin + k];
 
-      std::vector<u64> bIdxs(mNumHashFunctions);
-      for (u64 h = 0; h < mNumHashFunctions; ++h) {
-        auto bIdx = oc::CuckooIndex<>::getHash(hashs[i], (u8)h, mNumBins);
-        bool collision = false;
+      for (u64 h = 0; h < numHashes; ++h) {
+        auto b = binIdxs.data() + h * batchSize;
+        for (u64 k = 0; k < size; ++k) b[k] = hashWord(hashes[k], h);
 
-        bIdxs[h] = bIdx;
-        for (u64 hh = 0; hh < h; ++hh) collision |= (bIdxs[hh] == bIdx);
+        if (size == batchSize)
+          doMod32(b, &libdivider, mNumBins);
+        else
+          for (u64 k = 0; k < size; ++k) b[k] %= mNumBins;
+      }
 
-        mBins(bIdx, mBinSizes[bIdx]++).set(itemIdx + i, u8(h), collision);
-        mItemToBinMap(itemIdx + i, h) = bIdx | ((u8)collision & 1) * u64(-1);
+      for (u64 k = 0; k < size; ++k) {
+        auto i = begin + k;
+        for (u64 h = 0; h < numHashes; ++h) {
+          auto bIdx = binIdxs[h * batchSize + k];
+          itemBins[i * numHashes + h] = bIdx;
+          ++count[binRange(bIdx)];
+        }
+        for (u64 h = 0; h < numHashes; ++h)
+          mItemToBinMap(i, h) =
+              itemBins[i * numHashes + h] | collision(i, h) * u64(-1);
       }
     }
-  } else {
-    std::vector<u64> bIdxs(mNumHashFunctions);
-    for (u64 i = 0; i < u64(items.size()); i += u64(hashs.size())) {
-      auto min = std::min<u64>(items.size() - i, hashs.size());
-
-      hasher.ecbEncBlocks(items.data() + i, min, hashs.data());
-
-      for (u64 j = 0, itemIdx = i; j < min; ++j, ++itemIdx) {
-        hashs[j] = hashs[j] ^ items[itemIdx];
+  });
 
-        for (u64 h = 0; h < mNumHashFunctions; ++h) {
-          auto bIdx = oc::CuckooIndex<>::getHash(hashs[j], (u8)h, mNumBins);
-          bool collision = false;
-
-          bIdxs[h] = bIdx;
-          for (u64 hh = 0; hh < h; ++hh) collision |= (bIdxs[hh] == bIdx);
+  // prefix sum, items of bin range r are grouped together and within the
+  // group ordered by item range. counts(t, r) becomes the position where
+  // item range t starts writing into group r.
+  std::vector<u64> groupBegin(numTasks + 1);
+  for (u64 r = 0, pos = 0; r < numTasks; ++r) {
+    groupBegin[r] = pos;
+    for (u64 t = 0; t < numTasks; ++t) {
+      auto c = counts(t, r);
+      counts(t, r) = pos;
+      pos += c;
+    }
+  }
+  groupBegin[numTasks] = n * numHashes;
 
-          mBins(bIdx, mBinSizes[bIdx]++).set(itemIdx, u8(h), collision);
-          mItemToBinMap(itemIdx + i, h) = bIdx | ((u8)collision & 1) * u64(-1);
-        }
+  // pass two, scatter the entries into their groups.
+  std::vector<u32> entryBins(n * numHashes);
+  std::vector<Item> entries(n * numHashes);
+  workers.parallelFor(numTasks, [&](u64 t) {
+    auto pos = counts[t];
+    for (u64 i = itemBegin(t); i < itemBegin(t + 1); ++i)
+      for (u64 h = 0; h < numHashes; ++h) {
+        auto bIdx = itemBins[i * numHashes + h];
+        auto &p = pos[binRange(bIdx)];
+        entryBins[p] = bIdx;
+        entries[p].set(i, u8(h), collision(i, h));
+        ++p;
       }
+  });
+
+  // pass three, each task fills the bins of its range in order.
+  workers.parallelFor(numTasks, [&](u64 r) {
+    for (u64 p = groupBegin[r]; p < groupBegin[r + 1]; ++p) {
+      auto bIdx = entryBins[p];
+      auto &size = mBinSizes[bIdx];
+      if (size == mMaxBinSize)
+        throw std::runtime_error("Simple index bin overflow. " LOCATION);
+      mBins(bIdx, size++) = entries[p];
     }
-  }
+  });
 }
 
 }  // namespace primihub::crypto::okvs
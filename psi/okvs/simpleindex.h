@@ -23,6 +23,7 @@
 #include "cryptoTools/Common/Defines.h"
 #include "cryptoTools/Common/Matrix.h"
 #include "psi/okvs/defines.h"
+#include "psi/ot/tools/threadpool.h"
 
 namespace primihub::crypto::okvs {
 
@@ -53,15 +54,9 @@ class SimpleIndex {
       mVal = idx;
       ((u8 *)&mVal)[7] = hashIdx | ((collision & 1) << 7);
     }
-#ifdef THREAD_SAFE_SIMPLE_INDEX
-    Item(const Item &b) : mVal(b.mVal.load(std::memory_order_relaxed)) {}
-    Item(Item &&b) : mVal(b.mVal.load(std::memory_order_relaxed)) {}
-    std::atomic<u64> mVal;
-#else
     Item(const Item &b) : mVal(b.mVal) {}
     Item(Item &&b) : mVal(b.mVal) {}
     u64 mVal;
-#endif
   };
 
   u64 mMaxBinSize, mNumHashFunctions;
@@ -86,7 +81,12 @@ class SimpleIndex {
 
   void init(u64 numBins, u64 numBalls, u64 statSecParam = 40,
             u64 numHashFunction = 3);
-  void insertItems(span<block> items, block hashingSeed);
+
+  // Hash the items into the bins. The items are hashed by ranges of items
+  // in parallel, then each task places the items of a range of bins, so no
+  // two tasks write the same bin. Within a bin, items are in input order,
+  // then hash function order. Throws if a bin overflows mMaxBinSize.
+  void insertItems(span<block> items, block hashingSeed, Workers workers = {});
 };
 
 }  // namespace primihub::crypto::okvs
@@ -0,0 +1,214 @@
+#pragma once
+// The Expand-Accumulate code of [Correlated Pseudorandomness from
+// Expand-Accumulate Codes, https://eprint.iacr.org/2022/1014].
+#include <cryptoTools/Common/Defines.h>
+#include <cryptoTools/Common/Timer.h>
+#include <cryptoTools/Crypto/PRNG.h>
+#include <immintrin.h>
+
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+using namespace osuCrypto;
+
+namespace primihub::crypto {
+
+// The Expand-Accumulate code. Its dual encoding maps a noisy vector e of
+// mCodeSize elements to mMessageSize outputs: e is first accumulated,
+// e[i] ^= e[i - 1], and then each output is the sum of mExpanderWeight
+// entries of e, one drawn from each of mExpanderWeight regions of e.
+//
+// The sampled positions only depend on mSeed, so both parties derive the
+// same code without communicating.
+class EACode : public TimerAdapter {
+public:
+  // The number of outputs.
+  u64 mMessageSize = 0;
+
+  // The size of the noisy vector.
+  u64 mCodeSize = 0;
+
+  // The number of entries of e that are summed into each output.
+  u64 mExpanderWeight = 0;
+
+  block mSeed = block(33333, 33333);
+
+  void config(u64 messageSize, u64 codeSize, u64 expanderWeight,
+              block seed = block(33333, 33333)) {
+    if (expanderWeight == 0 || codeSize < expanderWeight ||
+        codeSize / expanderWeight > (1ull << 32))
+      throw RTE_LOC;
+
+    mMessageSize = messageSize;
+    mCodeSize = codeSize;
+    mExpanderWeight = expanderWeight;
+    mSeed = seed;
+
+    // region j is [mRegionBegin[j], mRegionBegin[j] + mRegionSize[j]).
+    // They cover all of e so that none of the noise is dropped.
+    mRegionBegin.resize(expanderWeight);
+    mRegionSize.resize(expanderWeight);
+    for (u64 j = 0; j < expanderWeight; ++j) {
+      mRegionBegin[j] = j * codeSize / expanderWeight;
+      mRegionSize[j] = (j + 1) * codeSize / expanderWeight - mRegionBegin[j];
+    }
+  }
+
+  // w := expand(accumulate(e)). e is accumulated in place.
+  template <typename T> void dualEncode(span<T> e, span<T> w) {
+    if ((u64)e.size() != mCodeSize || (u64)w.size() != mMessageSize)
+      throw RTE_LOC;
+
+    accumulate<T>(e);
+    setTimePoint("EACode.dualEncode.accumulate");
+
+    const T *__restrict ee = e.data();
+    T *__restrict ww = w.data();
+    auto weight = mExpanderWeight;
+    expandRows(
+        [&](const u64 *idx) {
+          for (u64 k = 0; k < kRowBatch * weight; ++k)
+            _mm_prefetch((const char *)&ee[idx[k]], _MM_HINT_T0);
+        },
+        [&](u64 begin, u64 rows, const u64 *idx) {
+          for (u64 r = 0; r < rows; ++r, idx += weight) {
+            T sum = ee[idx[0]];
+            for (u64 j = 1; j < weight; ++j)
+              sum = sum ^ ee[idx[j]];
+            ww[begin + r] = sum;
+          }
+        });
+    setTimePoint("EACode.dualEncode.expand");
+  }
+
+  // The same as dualEncode for two vectors at once, they share the sampled
+  // positions.
+  template <typename T0, typename T1>
+  void dualEncode2(span<T0> e0, span<T0> w0, span<T1> e1, span<T1> w1) {
+    if ((u64)e0.size() != mCodeSize || (u64)w0.size() != mMessageSize ||
+        (u64)e1.size() != mCodeSize || (u64)w1.size() != mMessageSize)
+      throw RTE_LOC;
+
+    accumulate<T0>(e0);
+    accumulate<T1>(e1);
+    setTimePoint("EACode.dualEncode2.accumulate");
+
+    const T0 *__restrict ee0 = e0.data();
+    const T1 *__restrict ee1 = e1.data();
+    T0 *__restrict ww0 = w0.data();
+    T1 *__restrict ww1 = w1.data();
+    auto weight = mExpanderWeight;
+    expandRows(
+        [&](const u64 *idx) {
+          for (u64 k = 0; k < kRowBatch * weight; ++k) {
+            _mm_prefetch((const char *)&ee0[idx[k]], _MM_HINT_T0);
+            _mm_prefetch((const char *)&ee1[idx[k]], _MM_HINT_T0);
+          }
+        },
+        [&](u64 begin, u64 rows, const u64 *idx) {
+          for (u64 r = 0; r < rows; ++r, idx += weight) {
+            T0 sum0 = ee0[idx[0]];
+            T1 sum1 = ee1[idx[0]];
+            for (u64 j = 1; j < weight; ++j) {
+              sum0 = sum0 ^ ee0[idx[j]];
+              sum1 = sum1 ^ ee1[idx[j]];
+            }
+            ww0[begin + r] = sum0;
+            ww1[begin + r] = sum1;
+          }
+        });
+    setTimePoint("EACode.dualEncode2.expand");
+  }
+
+  // e[i] ^= e[i - 1], in place.
+  template <typename T> static void accumulate(span<T> e) {
+    u64 n = e.size();
+    if (n == 0)
+      return;
+
+    T *__restrict x = e.data();
+    if constexpr (std::is_same_v<T, u8>) {
+      // Eight bytes per step: a prefix xor within the word, then the
+      // carry of the previous word is xored into every byte.
+      u64 i = 0;
+      u64 carry = 0;
+      for (; i + 8 <= n; i += 8) {
+        u64 v;
+        std::memcpy(&v, x + i, 8);
+        v ^= v << 8;
+        v ^= v << 16;
+        v ^= v << 32;
+        v ^= carry * 0x0101010101010101ull;
+        std::memcpy(x + i, &v, 8);
+        carry = v >> 56;
+      }
+      for (; i < n; ++i) {
+        x[i] = x[i] ^ u8(carry);
+        carry = x[i];
+      }
+    } else {
+      u64 i = 1;
+      auto n8 = (n - 1) / 8 * 8 + 1;
+      for (; i < n8; i += 8) {
+        x[i + 0] = x[i + 0] ^ x[i - 1];
+        x[i + 1] = x[i + 1] ^ x[i + 0];
+        x[i + 2] = x[i + 2] ^ x[i + 1];
+        x[i + 3] = x[i + 3] ^ x[i + 2];
+        x[i + 4] = x[i + 4] ^ x[i + 3];
+        x[i + 5] = x[i + 5] ^ x[i + 4];
+        x[i + 6] = x[i + 6] ^ x[i + 5];
+        x[i + 7] = x[i + 7] ^ x[i + 6];
+      }
+      for (; i < n; ++i)
+        x[i] = x[i] ^ x[i - 1];
+    }
+  }
+
+private:
+  // Rows whose positions are sampled and prefetched together.
+  static constexpr u64 kRowBatch = 16;
+
+  std::vector<u64> mRegionBegin;
+  std::vector<u64> mRegionSize;
+
+  // Samples the positions of each output row, kRowBatch rows at a time.
+  // The positions of the next batch are sampled and passed to prefetch
+  // before sum is called on the current batch, so that the random reads
+  // of e overlap with the sums.
+  template <typename Prefetch, typename Sum>
+  void expandRows(Prefetch &&prefetch, Sum &&sum) const {
+    auto weight = mExpanderWeight;
+    auto batchSize = kRowBatch * weight;
+    PRNG prng(mSeed);
+    std::vector<u32> rand(batchSize);
+    std::vector<u64> idx[2]{std::vector<u64>(batchSize),
+                            std::vector<u64>(batchSize)};
+
+    // Map a 32 bit random value into region j by a multiply-shift.
+    auto sample = [&](std::vector<u64> &out) {
+      prng.get(rand.data(), rand.size());
+      for (u64 r = 0, k = 0; r < kRowBatch; ++r)
+        for (u64 j = 0; j < weight; ++j, ++k)
+          out[k] = mRegionBegin[j] + ((u64(rand[k]) * mRegionSize[j]) >> 32);
+    };
+
+    u64 numBatches = (mMessageSize + kRowBatch - 1) / kRowBatch;
+    if (numBatches)
+      sample(idx[0]);
+
+    for (u64 b = 0; b < numBatches; ++b) {
+      auto &cur = idx[b & 1];
+      auto &next = idx[~b & 1];
+      if (b + 1 < numBatches) {
+        sample(next);
+        prefetch(next.data());
+      }
+
+      auto begin = b * kRowBatch;
+      sum(begin, std::min<u64>(kRowBatch, mMessageSize - begin), cur.data());
+    }
+  }
+};
+
+} // namespace primihub::crypto
@@ -0,0 +1,179 @@
+#include "psi/ot/tools/gf128.h"
+
+#include <immintrin.h>
+#include <wmmintrin.h>
+
+#include <stdexcept>
+
+namespace primihub::crypto {
+using osuCrypto::u64;
+
+namespace {
+// x^128 = x^7 + x^2 + x + 1.
+constexpr u64 kMod = 0b10000111;
+
+// d broadcast to each 128 bit lane, with the xor of its halves in the low
+// half of dk for the middle Karatsuba term.
+struct MulConst128 {
+  explicit MulConst128(block d) {
+    mD = _mm_loadu_si128((const __m128i *)&d);
+    mDk = _mm_xor_si128(mD, _mm_shuffle_epi32(mD, 0x4E));
+    mMod = _mm_set_epi64x(0, kMod);
+  }
+
+  inline __m128i mul(__m128i x) const {
+    __m128i lo = _mm_clmulepi64_si128(x, mD, 0x00);
+    __m128i hi = _mm_clmulepi64_si128(x, mD, 0x11);
+    __m128i xk = _mm_xor_si128(x, _mm_shuffle_epi32(x, 0x4E));
+    __m128i mid = _mm_clmulepi64_si128(xk, mDk, 0x00);
+    mid = _mm_xor_si128(mid, _mm_xor_si128(lo, hi));
+    lo = _mm_xor_si128(lo, _mm_slli_si128(mid, 8));
+    hi = _mm_xor_si128(hi, _mm_srli_si128(mid, 8));
+
+    // reduce the high half, its top 64 bits first.
+    __m128i t = _mm_clmulepi64_si128(hi, mMod, 0x01);
+    lo = _mm_xor_si128(lo, _mm_slli_si128(t, 8));
+    hi = _mm_xor_si128(hi, _mm_srli_si128(t, 8));
+    t = _mm_clmulepi64_si128(hi, mMod, 0x00);
+    return _mm_xor_si128(lo, t);
+  }
+
+  __m128i mD, mDk, mMod;
+};
+
+template <bool XorOut>
+void mulConstPclmul(block d, const block *in, block *out, u64 n) {
+  MulConst128 m(d);
+  auto apply = [&](u64 i, __m128i p) {
+    if (XorOut) p = _mm_xor_si128(p, _mm_loadu_si128((__m128i *)(out + i)));
+    _mm_storeu_si128((__m128i *)(out + i), p);
+  };
+
+  u64 i = 0;
+  auto main = n / 4 * 4;
+  for (; i < main; i += 4) {
+    auto p0 = m.mul(_mm_loadu_si128((const __m128i *)(in + i + 0)));
+    auto p1 = m.mul(_mm_loadu_si128((const __m128i *)(in + i + 1)));
+    auto p2 = m.mul(_mm_loadu_si128((const __m128i *)(in + i + 2)));
+    auto p3 = m.mul(_mm_loadu_si128((const __m128i *)(in + i + 3)));
+    apply(i + 0, p0);
+    apply(i + 1, p1);
+    apply(i + 2, p2);
+    apply(i + 3, p3);
+  }
+  for (; i < n; ++i)
+    apply(i, m.mul(_mm_loadu_si128((const __m128i *)(in + i))));
+}
+
+#define GF128_VPCLMUL_TARGET \
+  __attribute__((target("avx512f,avx512bw,vpclmulqdq")))
+
+struct MulConst512 {
+  GF128_VPCLMUL_TARGET explicit MulConst512(const MulConst128 &m) {
+    mD = _mm512_broadcast_i32x4(m.mD);
+    mDk = _mm512_broadcast_i32x4(m.mDk);
+    mMod = _mm512_broadcast_i32x4(m.mMod);
+  }
+
+  GF128_VPCLMUL_TARGET inline __m512i mul(__m512i x) const {
+    __m512i lo = _mm512_clmulepi64_epi128(x, mD, 0x00);
+    __m512i hi = _mm512_clmulepi64_epi128(x, mD, 0x11);
+    __m512i xk = _mm512_xor_si512(x, _mm512_shuffle_epi32(x, _MM_PERM_BADC));
+    __m512i mid = _mm512_clmulepi64_epi128(xk, mDk, 0x00);
+    mid = _mm512_ternarylogic_epi64(mid, lo, hi, 0x96);
+    lo = _mm512_xor_si512(lo, _mm512_bslli_epi128(mid, 8));
+    hi = _mm512_xor_si512(hi, _mm512_bsrli_epi128(mid, 8));
+
+    __m512i t = _mm512_clmulepi64_epi128(hi, mMod, 0x01);
+    lo = _mm512_xor_si512(lo, _mm512_bslli_epi128(t, 8));
+    hi = _mm512_xor_si512(hi, _mm512_bsrli_epi128(t, 8));
+    t = _mm512_clmulepi64_epi128(hi, mMod, 0x00);
+    return _mm512_xor_si512(lo, t);
+  }
+
+  __m512i mD, mDk, mMod;
+};
+
+template <bool XorOut>
+GF128_VPCLMUL_TARGET inline void store4(block *out, __m512i p) {
+  if (XorOut) p = _mm512_xor_si512(p, _mm512_loadu_si512(out));
+  _mm512_storeu_si512(out, p);
+}
+
+template <bool XorOut>
+GF128_VPCLMUL_TARGET void mulConstVpclmul(block d, const block *in,
+                                          block *out, u64 n) {
+  MulConst128 m128(d);
+  MulConst512 m(m128);
+
+  // eight blocks per iteration so that the two multiplications overlap.
+  u64 i = 0;
+  auto main = n / 8 * 8;
+  for (; i < main; i += 8) {
+    auto p0 = m.mul(_mm512_loadu_si512(in + i + 0));
+    auto p1 = m.mul(_mm512_loadu_si512(in + i + 4));
+    store4<XorOut>(out + i + 0, p0);
+    store4<XorOut>(out + i + 4, p1);
+  }
+  if (n - i >= 4) {
+    store4<XorOut>(out + i, m.mul(_mm512_loadu_si512(in + i)));
+    i += 4;
+  }
+  if (i < n) {
+    if (XorOut)
+      mulConstPclmul<true>(d, in + i, out + i, n - i);
+    else
+      mulConstPclmul<false>(d, in + i, out + i, n - i);
+  }
+}
+
+#undef GF128_VPCLMUL_TARGET
+
+void checkSizes(span<const block> in, span<block> out) {
+  if (in.size() != out.size())
+    throw std::runtime_error("gf128MulConst size mismatch. " LOCATION);
+}
+
+using Kernel = void (*)(block, span<const block>, span<block>, bool);
+
+Kernel selectKernel() {
+  return gf128HasVpclmul() ? &gf128MulConstVpclmul : &gf128MulConstPclmul;
+}
+}  // namespace
+
+bool gf128HasVpclmul() {
+  static const bool has = __builtin_cpu_supports("avx512f") &&
+                          __builtin_cpu_supports("avx512bw") &&
+                          __builtin_cpu_supports("vpclmulqdq");
+  return has;
+}
+
+void gf128MulConstPclmul(block d, span<const block> in, span<block> out,
+                         bool xorOut) {
+  checkSizes(in, out);
+  if (xorOut)
+    mulConstPclmul<true>(d, in.data(), out.data(), in.size());
+  else
+    mulConstPclmul<false>(d, in.data(), out.data(), in.size());
+}
+
+void gf128MulConstVpclmul(block d, span<const block> in, span<block> out,
+                          bool xorOut) {
+  checkSizes(in, out);
+  if (xorOut)
+    mulConstVpclmul<true>(d, in.data(), out.data(), in.size());
+  else
+    mulConstVpclmul<false>(d, in.data(), out.data(), in.size());
+}
+
+void gf128MulConst(block d, span<const block> in, span<block> out) {
+  static const Kernel kernel = selectKernel();
+  kernel(d, in, out, false);
+}
+
+void gf128MulConstXor(block d, span<const block> in, span<block> out) {
+  static const Kernel kernel = selectKernel();
+  kernel(d, in, out, true);
+}
+
+}  // namespace primihub::crypto
@@ -0,0 +1,27 @@
+#pragma once
+#include <cryptoTools/Common/Defines.h>
+
+namespace primihub::crypto {
+using osuCrypto::block;
+using osuCrypto::span;
+
+// Batched GF(2^128) multiplication by a fixed element, in the field and bit
+// order of block::gf128Mul. out[i] = d * in[i], or out[i] ^= d * in[i] for
+// the Xor variant. out may alias in.
+//
+// The halves of d are folded once per call so each product takes three
+// carry-less multiplications and two more to reduce. With AVX-512 and
+// VPCLMULQDQ four blocks are multiplied per instruction, this is detected
+// at runtime and otherwise the PCLMUL kernel is used.
+void gf128MulConst(block d, span<const block> in, span<block> out);
+void gf128MulConstXor(block d, span<const block> in, span<block> out);
+
+// The kernels behind gf128MulConst, exposed for testing. The VPCLMULQDQ
+// one may only be called if gf128HasVpclmul().
+bool gf128HasVpclmul();
+void gf128MulConstPclmul(block d, span<const block> in, span<block> out,
+                         bool xorOut);
+void gf128MulConstVpclmul(block d, span<const block> in, span<block> out,
+                          bool xorOut);
+
+}  // namespace primihub::crypto
@@ -396,6 +396,102 @@ void SilverRightEncoder::init(u64 rows, SilverCode c, bool extend) {
   mCols = extend ? rows : rows - mGap;
 }
 
+u64 SilverRightEncoder::period() {
+  switch (mCode) {
+  case SilverCode::Weight5:
+    return 16;
+  case SilverCode::Weight11:
+    return 32;
+  default:
+    throw RTE_LOC;
+  }
+}
+
+u64 SilverRightEncoder::bandWeight() {
+  switch (mCode) {
+  case SilverCode::Weight5:
+    return 4 + mOffsets.size();
+  case SilverCode::Weight11:
+    return 10 + mOffsets.size();
+  default:
+    throw RTE_LOC;
+  }
+}
+
+std::vector<u8> SilverRightEncoder::bandDists() {
+  auto p = period();
+  auto w = bandWeight();
+  std::vector<u8> dists(p * w);
+  for (u64 i = 0; i < p; ++i) {
+    auto d = dists.data() + i * w;
+    for (u64 j = 0; j < w - mOffsets.size(); ++j) {
+      if (mCode == SilverCode::Weight5)
+        *d++ = p - diagMtx_g16_w5_seed1_t36[i][j];
+      else
+        *d++ = p - diagMtx_g32_w11_seed2_t36[i][j];
+    }
+
+    for (u64 j = 0; j < mOffsets.size(); ++j) {
+      if (mOffsets[j] + mGap >= 64)
+        throw RTE_LOC;
+      *d++ = mOffsets[j] + mGap;
+    }
+  }
+
+  return dists;
+}
+
+namespace {
+// a after b: entry d of the result masks the inputs of b.
+std::array<u64, 64> composeTransfer(const std::array<u64, 64> &a,
+                                    const std::array<u64, 64> &b) {
+  std::array<u64, 64> r{};
+  for (u64 d = 0; d < 64; ++d)
+    for (u64 k = 0, m = a[d]; m; ++k, m >>= 1)
+      if (m & 1)
+        r[d] ^= b[k];
+  return r;
+}
+} // namespace
+
+std::array<u64, 64> SilverRightEncoder::bandTransfer(u64 len) {
+  auto p = period();
+  if (len % p)
+    throw RTE_LOC;
+
+  // Solve one period with zero rows and bit d set in what enters row
+  // hi - 1 - d. The band repeats, so this is the same for every period.
+  auto dists = bandDists();
+  std::vector<u64> zeros(p);
+  std::array<u64, 64> ring{};
+  u64 lo = 64, hi = 64 + p;
+  for (u64 d = 0; d < 64; ++d)
+    ring[(hi - 1 - d) & 63] = 1ull << d;
+
+  if (mCode == SilverCode::Weight5)
+    solveBand<6, u64>(dists.data(), p - 1, zeros.data(), nullptr, lo, hi,
+                      ring.data());
+  else
+    solveBand<12, u64>(dists.data(), p - 1, zeros.data(), nullptr, lo, hi,
+                       ring.data());
+
+  std::array<u64, 64> step;
+  for (u64 d = 0; d < 64; ++d)
+    step[d] = ring[(lo - 1 - d) & 63];
+
+  // step^(len / p) by squaring.
+  std::array<u64, 64> ret;
+  for (u64 d = 0; d < 64; ++d)
+    ret[d] = 1ull << d;
+  for (auto e = len / p; e; e >>= 1) {
+    if (e & 1)
+      ret = composeTransfer(ret, step);
+    step = composeTransfer(step, step);
+  }
+
+  return ret;
+}
+
 void SilverRightEncoder::encode(span<u8> x, span<const u8> y) {
   assert(mExtend);
   for (u64 i = 0; i < mRows; ++i) {
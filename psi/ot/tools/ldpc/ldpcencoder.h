@@ -28,6 +28,7 @@
 #include <numeric>
 
 #include "psi/ot/tools/ldpc/mtx.h"
+#include "psi/ot/tools/threadpool.h"
 
 using namespace osuCrypto;
 
@@ -192,14 +193,23 @@ public:
   SparseMtx getTransMatrix();
 
   // perform the circuit transpose of the encoding algorithm.
-  // the output it written to ppp.
-  template <typename T> void dualEncode(span<T> ppp, span<const T> mm);
+  // the output it written to ppp. The rows of ppp are split over workers.
+  template <typename T>
+  void dualEncode(span<T> ppp, span<const T> mm, const Workers &workers = {});
 
   // perform the circuit transpose of the encoding algorithm twice.
   // the output it written to ppp0 and ppp1.
   template <typename T0, typename T1>
   void dualEncode2(span<T0> ppp0, span<T1> ppp1, span<const T0> mm0,
-                   span<const T1> mm1);
+                   span<const T1> mm1, const Workers &workers = {});
+
+  // dualEncode restricted to the output rows [begin, end).
+  template <typename T>
+  void dualEncodeRows(span<T> ppp, span<const T> mm, u64 begin, u64 end);
+
+  template <typename T0, typename T1>
+  void dualEncode2Rows(span<T0> ppp0, span<T1> ppp1, span<const T0> mm0,
+                       span<const T1> mm1, u64 begin, u64 end);
 };
 
 class SilverRightEncoder {
@@ -297,6 +307,47 @@ public:
   // the inputs and output is x0 and x1.
   template <typename T0, typename T1>
   void dualEncode2(span<T0> x0, span<T1> x1);
+
+  // The same as dualEncode(x), split over workers.
+  //
+  // Row i is solved from the top and then added into the rows at most 63
+  // below it, so x is cut into chunks of whole band periods. Every chunk
+  // but the bottom one is first solved assuming nothing is added into it
+  // from above, which gives what it adds into the 64 rows below it. A
+  // short sequential pass then carries these across the chunk boundaries
+  // with the band's transfer matrix, and every chunk but the top one is
+  // solved again starting from what really enters it.
+  template <typename T> void dualEncode(span<T> x, const Workers &workers);
+
+  template <typename T0, typename T1>
+  void dualEncode2(span<T0> x0, span<T1> x1, const Workers &workers);
+
+  // The diagonal band repeats every period() rows.
+  u64 period();
+
+  // The number of rows below row i that x[i] is added into.
+  u64 bandWeight();
+
+  // The distances i - col of the rows that x[i] is added into, bandWeight()
+  // entries for each i mod period().
+  std::vector<u8> bandDists();
+
+  // The map from what is added into the 64 rows below row hi to what is
+  // added into the 64 rows below row hi - len, when rows [hi - len, hi) are
+  // zero. hi and len are multiples of period(). Entry d is the bit mask of
+  // the incoming values that are summed into row hi - len - 1 - d.
+  std::array<u64, 64> bandTransfer(u64 len);
+
+  // Solve rows [lo, hi) from the top, reading row i from in[i - lo] and
+  // writing it to out[i - lo] if out is set. ring holds what is added
+  // into row i at ring[i % 64]. What is added into rows below lo is left
+  // in ring.
+  template <u64 W, typename T>
+  static void solveBand(const u8 *dists, u64 periodMask, const T *in, T *out,
+                        u64 lo, u64 hi, T *ring);
+
+  template <u64 W, typename T>
+  void dualEncodeChunks(span<T> x, const Workers &workers, u64 chunkSize);
 };
 
 // a full encoder expressed and the left and right encoder.
@@ -326,20 +377,21 @@ public:
     mR.encode(pp, pp);
   }
 
-  template <typename T> void dualEncode(span<T> c) {
+  template <typename T>
+  void dualEncode(span<T> c, const Workers &workers = {}) {
     auto k = cols() - rows();
     assert(c.size() == cols());
     setTimePoint("encode_begin");
     span<T> pp(c.subspan(k, rows()));
 
-    mR.template dualEncode<T>(pp);
+    mR.template dualEncode<T>(pp, workers);
     setTimePoint("diag");
-    mL.template dualEncode<T>(c.subspan(0, k), pp);
+    mL.template dualEncode<T>(c.subspan(0, k), pp, workers);
     setTimePoint("L");
   }
 
   template <typename T0, typename T1>
-  void dualEncode2(span<T0> c0, span<T1> c1) {
+  void dualEncode2(span<T0> c0, span<T1> c1, const Workers &workers = {}) {
     auto k = cols() - rows();
     assert(c0.size() == cols());
 
@@ -347,11 +399,11 @@ public:
     span<T0> pp0(c0.subspan(k, rows()));
     span<T1> pp1(c1.subspan(k, rows()));
 
-    mR.template dualEncode2<T0, T1>(pp0, pp1);
+    mR.template dualEncode2<T0, T1>(pp0, pp1, workers);
 
     setTimePoint("diag");
     mL.template dualEncode2<T0, T1>(c0.subspan(0, k), c1.subspan(0, k), pp0,
-                                    pp1);
+                                    pp1, workers);
     setTimePoint("L");
   }
 
@@ -398,20 +450,49 @@ void LdpcComposit_RegRepDiagBand_Trans_test();
 
 } // namespace tests
 
+namespace details {
+// Rows of the left encoder below which it is not split over workers.
+constexpr u64 kMinParallelRows = 1 << 14;
+} // namespace details
+
+template <typename T>
+void details::SilverLeftEncoder::dualEncode(span<T> ppp, span<const T> mm,
+                                            const Workers &workers) {
+  auto n = std::min<u64>(workers.size(), divCeil(mRows, kMinParallelRows));
+  workers.parallelFor(n, [&](u64 t) {
+    dualEncodeRows<T>(ppp, mm, t * mRows / n, (t + 1) * mRows / n);
+  });
+}
+
+template <typename T0, typename T1>
+void details::SilverLeftEncoder::dualEncode2(span<T0> ppp0, span<T1> ppp1,
+                                             span<const T0> mm0,
+                                             span<const T1> mm1,
+                                             const Workers &workers) {
+  auto n = std::min<u64>(workers.size(), divCeil(mRows, kMinParallelRows));
+  workers.parallelFor(n, [&](u64 t) {
+    dualEncode2Rows<T0, T1>(ppp0, ppp1, mm0, mm1, t * mRows / n,
+                            (t + 1) * mRows / n);
+  });
+}
+
 // perform the circuit transpose of the encoding algorithm.
 // the output it written to ppp.
 template <typename T>
-void details::SilverLeftEncoder::dualEncode(span<T> ppp, span<const T> mm) {
+void details::SilverLeftEncoder::dualEncodeRows(span<T> ppp, span<const T> mm,
+                                                u64 begin, u64 rowEnd) {
   auto cols = mRows;
   assert(ppp.size() == mRows);
   assert(mm.size() == cols);
 
   auto v = mYs;
+  for (auto &vj : v)
+    vj = (vj + begin) % mRows;
   T *__restrict pp = ppp.data();
   const T *__restrict m = mm.data();
 
-  for (u64 i = 0; i < cols;) {
-    auto end = cols;
+  for (u64 i = begin; i < rowEnd;) {
+    auto end = rowEnd;
     for (u64 j = 0; j < mWeight; ++j) {
       if (v[j] == mRows)
         v[j] = 0;
@@ -514,19 +595,22 @@ void details::SilverLeftEncoder::dualEncode(span<T> ppp, span<const T> mm) {
 // perform the circuit transpose of the encoding algorithm twice.
 // the output it written to ppp0 and ppp1.
 template <typename T0, typename T1>
-void details::SilverLeftEncoder::dualEncode2(span<T0> ppp0, span<T1> ppp1,
-                                             span<const T0> mm0,
-                                             span<const T1> mm1) {
+void details::SilverLeftEncoder::dualEncode2Rows(span<T0> ppp0, span<T1> ppp1,
+                                                 span<const T0> mm0,
+                                                 span<const T1> mm1,
+                                                 u64 begin, u64 rowEnd) {
   auto cols = mRows;
   // pp = pp + m * A
   auto v = mYs;
+  for (auto &vj : v)
+    vj = (vj + begin) % mRows;
   T0 *__restrict pp0 = ppp0.data();
   T1 *__restrict pp1 = ppp1.data();
   const T0 *__restrict m0 = mm0.data();
   const T1 *__restrict m1 = mm1.data();
 
-  for (u64 i = 0; i < cols;) {
-    auto end = cols;
+  for (u64 i = begin; i < rowEnd;) {
+    auto end = rowEnd;
     for (u64 j = 0; j < mWeight; ++j) {
       if (v[j] == mRows)
         v[j] = 0;
@@ -981,4 +1065,135 @@ void details::SilverRightEncoder::dualEncode2(span<T0> x0, span<T1> x1) {
   }
 }
 
+template <u64 W, typename T>
+void details::SilverRightEncoder::solveBand(const u8 *dists, u64 periodMask,
+                                            const T *in, T *out, u64 lo,
+                                            u64 hi, T *ring) {
+  for (u64 i = hi; i-- > lo;) {
+    auto &r = ring[i & 63];
+    T xi = in[i - lo] ^ r;
+    r = T{};
+    if (out)
+      out[i - lo] = xi;
+
+    const u8 *d = dists + (i & periodMask) * W;
+    for (u64 j = 0; j < W; ++j) {
+      auto &c = ring[(i - d[j]) & 63];
+      c = c ^ xi;
+    }
+  }
+}
+
+template <u64 W, typename T>
+void details::SilverRightEncoder::dualEncodeChunks(span<T> x,
+                                                   const Workers &workers,
+                                                   u64 chunkSize) {
+  using State = std::array<T, 64>;
+  auto dists = bandDists();
+  auto periodMask = period() - 1;
+  auto numChunks = divCeil(mRows, chunkSize);
+  auto top = numChunks - 1;
+  auto lo = [&](u64 c) { return c * chunkSize; };
+  auto hi = [&](u64 c) { return std::min<u64>(mRows, (c + 1) * chunkSize); };
+
+  // out[c] is what chunk c adds into the 64 rows below it when nothing
+  // enters it from above. Nothing enters the top chunk, so it is solved in
+  // place, the others only read x.
+  std::vector<State> out(numChunks);
+  workers.parallelFor(top, [&](u64 k) {
+    auto c = k + 1;
+    State ring{};
+    solveBand<W, T>(dists.data(), periodMask, &x[lo(c)],
+                    c == top ? &x[lo(c)] : nullptr, lo(c), hi(c),
+                    ring.data());
+    for (u64 d = 0; d < 64; ++d)
+      out[c][d] = ring[(lo(c) - 1 - d) & 63];
+  });
+
+  // in[c] is what really enters chunk c from above.
+  auto transfer = bandTransfer(chunkSize);
+  std::vector<State> in(numChunks);
+  in[top - 1] = out[top];
+  for (u64 c = top - 1; c > 0; --c) {
+    for (u64 d = 0; d < 64; ++d) {
+      T v = out[c][d];
+      for (u64 b = 0, m = transfer[d]; m; ++b, m >>= 1)
+        if (m & 1)
+          v = v ^ in[c][b];
+      in[c - 1][d] = v;
+    }
+  }
+
+  // The serial dualEncode solves whole band periods down to row split and
+  // only then checks bounds, so the rows of its last period also add into
+  // the entries just before x. The bottom chunk does the same, so that the
+  // code does not depend on the number of workers.
+  auto mainEnd = roundUpTo(
+      *std::max_element(mOffsets.begin(), mOffsets.end()) + mGap, period());
+  auto split = mRows;
+  if (mRows - 1 > mainEnd)
+    split -= roundUpTo(mRows - 1 - mainEnd, period());
+
+  workers.parallelFor(top, [&](u64 c) {
+    State ring{};
+    for (u64 d = 0; d < 64; ++d)
+      ring[(hi(c) - 1 - d) & 63] = in[c][d];
+
+    if (c) {
+      solveBand<W, T>(dists.data(), periodMask, &x[lo(c)], &x[lo(c)], lo(c),
+                      hi(c), ring.data());
+      return;
+    }
+
+    solveBand<W, T>(dists.data(), periodMask, &x[split], &x[split], split,
+                    hi(c), ring.data());
+    // ring now holds rows [split - 63, split), the negative ones are before x.
+    for (u64 d = 1; d + split < 64; ++d) {
+      auto &r = ring[(0 - d) & 63];
+      x.data()[-i64(d)] = x.data()[-i64(d)] ^ r;
+      r = T{};
+    }
+    solveBand<W, T>(dists.data(), periodMask, &x[0], &x[0], 0, split,
+                    ring.data());
+  });
+}
+
+template <typename T>
+void details::SilverRightEncoder::dualEncode(span<T> x,
+                                             const Workers &workers) {
+  assert(mExtend);
+  assert(cols() == x.size());
+
+  auto numChunks = std::min<u64>(workers.size(), mRows / kMinParallelRows);
+  if (numChunks < 2) {
+    dualEncode<T>(x);
+    return;
+  }
+
+  auto chunkSize = roundUpTo(divCeil(mRows, numChunks), period());
+  switch (mCode) {
+  case SilverCode::Weight5:
+    dualEncodeChunks<6, T>(x, workers, chunkSize);
+    break;
+  case SilverCode::Weight11:
+    dualEncodeChunks<12, T>(x, workers, chunkSize);
+    break;
+  default:
+    throw RTE_LOC;
+    break;
+  }
+}
+
+template <typename T0, typename T1>
+void details::SilverRightEncoder::dualEncode2(span<T0> x0, span<T1> x1,
+                                              const Workers &workers) {
+  if (std::min<u64>(workers.size(), mRows / kMinParallelRows) < 2) {
+    dualEncode2<T0, T1>(x0, x1);
+    return;
+  }
+
+  dualEncode<T0>(x0, workers);
+  dualEncode<T1>(x1, workers);
+}
+
 } // namespace primihub::crypto
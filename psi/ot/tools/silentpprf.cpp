@@ -593,7 +593,7 @@ void SilentMultiPprfSender::expand(std::shared_ptr<Channel> chl,
                                    span<const block> value, PRNG &prng,
                                    MatrixView<block> output,
                                    PprfOutputFormat oFormat,
-                                   bool activeChildXorDelta, u64 numThreads) {
+                                   bool activeChildXorDelta, Workers workers) {
   if (activeChildXorDelta)
     setValue(value);
   setTimePoint("SilentMultiPprfSender.start");
@@ -646,11 +646,11 @@ void SilentMultiPprfSender::expand(std::shared_ptr<Channel> chl,
   u64 i = 0;
   u64 dd = 0;
 
-  if (oFormat == PprfOutputFormat::Callback && numThreads > 1)
+  if (oFormat == PprfOutputFormat::Callback && workers.size() > 1)
     throw RTE_LOC;
 
   dd = mDepth + (oFormat == PprfOutputFormat::Interleaved ? 0 : 1);
-  mTreeAlloc.reserve(numThreads, (1ull << dd) + (32 * dd));
+  mTreeAlloc.reserve(workers.size(), (1ull << dd) + (32 * dd));
   setTimePoint("SilentMultiPprfSender.reserve");
 
   mExps.clear();
@@ -659,17 +659,12 @@ void SilentMultiPprfSender::expand(std::shared_ptr<Channel> chl,
   for (i = 0; i < mPntCount; i += 8) {
     mExps.emplace_back(*this, prng.get(), i, oFormat, output,
                        activeChildXorDelta, chl->fork());
-    // mExps.back().mFuture = macoro::make_eager(mExps.back().run());
     // MC_AWAIT(mExps.back().run());
-    Expander *inst = &(mExps.back());
-    auto run_fn = [inst]() { inst->run(); };
-    mExps.back().mFuture = std::async(run_fn);
   }
 
-  for (i = 0; i < mExps.size(); ++i) {
-    // MC_AWAIT(mExps[i].mFuture);
-    mExps[i].mFuture.get();
-  }
+  // Each expander has its own fork, they only send so they never wait on
+  // one another.
+  workers.parallelFor(mExps.size(), [this](u64 j) { mExps[j].run(); });
 
   mExps.clear();
   setTimePoint("SilentMultiPprfSender.join");
@@ -1089,7 +1084,7 @@ void SilentMultiPprfReceiver::Expander::run() {
 void SilentMultiPprfReceiver::expand(std::shared_ptr<Channel> chl, PRNG &prng,
                                      MatrixView<block> output,
                                      PprfOutputFormat oFormat,
-                                     bool activeChildXorDelta, u64 numThreads) {
+                                     bool activeChildXorDelta, Workers workers) {
 
   setTimePoint("SilentMultiPprfReceiver.start");
 
@@ -1147,7 +1142,7 @@ void SilentMultiPprfReceiver::expand(std::shared_ptr<Channel> chl, PRNG &prng,
   u64 dd = 0;
 
   dd = mDepth + (oFormat == PprfOutputFormat::Interleaved ? 0 : 1);
-  mTreeAlloc.reserve(numThreads, (1ull << (dd)) + (32 * dd));
+  mTreeAlloc.reserve(workers.size(), (1ull << (dd)) + (32 * dd));
   setTimePoint("SilentMultiPprfReceiver.reserve");
 
   mExps.clear();
@@ -1155,17 +1150,16 @@ void SilentMultiPprfReceiver::expand(std::shared_ptr<Channel> chl, PRNG &prng,
   for (i = 0; i < mPntCount; i += 8) {
     mExps.emplace_back(*this, chl->fork(), oFormat, output, activeChildXorDelta,
                        i);
-    Expander *inst = &(mExps.back());
-    auto run_fn = [inst] { inst->run(); };
-    mExps.back().mFuture = std::async(run_fn);
-    // mExps.back().mFuture = macoro::make_eager(mExps.back().run());
     // MC_AWAIT(mExps.back().run());
   }
 
-  for (i = 0; i < mExps.size(); ++i) {
-    mExps[i].mFuture.get();
-    // MC_AWAIT(mExps[i].mFuture);
-  }
+  // Expander j only waits for the sender's expander j, which its caller
+  // runs in the same order, so a busy pool can't deadlock them. They do
+  // block in recv on the pool's workers, at most workers.size() - 1 of them
+  // at a time. Each waits for one tree, which the sender expands at about
+  // the speed the receiver does, so that is kept instead of a thread per
+  // expander as before.
+  workers.parallelFor(mExps.size(), [this](u64 j) { mExps[j].run(); });
   setTimePoint("SilentMultiPprfReceiver.join");
 
   mBaseOTs = {};
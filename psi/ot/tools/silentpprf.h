@@ -29,6 +29,7 @@
 #include <cryptoTools/Crypto/PRNG.h>
 
 #include "network/channel_interface.h"
+#include "psi/ot/tools/threadpool.h"
 
 using namespace osuCrypto;
 
@@ -162,15 +163,15 @@ public:
 
   void expand(std::shared_ptr<Channel> chls, span<const block> value,
               PRNG &prng, span<block> output, PprfOutputFormat oFormat,
-              bool activeChildXorDelta, u64 numThreads) {
+              bool activeChildXorDelta, Workers workers) {
     MatrixView<block> o(output.data(), output.size(), 1);
     return expand(chls, value, prng, o, oFormat, activeChildXorDelta,
-                  numThreads);
+                  workers);
   }
 
   void expand(std::shared_ptr<Channel> chl, span<const block> value,
               PRNG &prng, MatrixView<block> output, PprfOutputFormat oFormat,
-              bool activeChildXorDelta, u64 numThreads);
+              bool activeChildXorDelta, Workers workers);
 
   void setValue(span<const block> value);
 
@@ -184,8 +185,6 @@ public:
     u64 dd, treeIdx, min, d;
     bool mActiveChildXorDelta = true;
 
-    std::future<void> mFuture;
-
     std::vector<span<AlignedArray<block, 8>>> mLevels;
 
     // std::unique_ptr<block[]> uPtr_;
@@ -276,9 +275,9 @@ public:
 
   void expand(std::shared_ptr<Channel> chl, PRNG &prng,
               span<block> output, PprfOutputFormat oFormat,
-              bool activeChildXorDelta, u64 numThreads) {
+              bool activeChildXorDelta, Workers workers) {
     MatrixView<block> o(output.data(), output.size(), 1);
-    return expand(chl, prng, o, oFormat, activeChildXorDelta, numThreads);
+    return expand(chl, prng, o, oFormat, activeChildXorDelta, workers);
   }
 
   // activeChildXorDelta says whether the sender is trying to program the
@@ -286,7 +285,7 @@ public:
   // active child will just take a random value.
   void expand(std::shared_ptr<Channel> chl, PRNG &prng,
               MatrixView<block> output, PprfOutputFormat oFormat,
-              bool activeChildXorDelta, u64 numThreads);
+              bool activeChildXorDelta, Workers workers);
 
   void clear() {
     mBaseOTs.resize(0, 0);
@@ -306,9 +305,6 @@ public:
     PprfOutputFormat oFormat;
     MatrixView<block> output;
 
-    // macoro::eager_task<void> mFuture;
-    std::future<void> mFuture;
-
     std::vector<span<AlignedArray<block, 8>>> mLevels;
 
     // mySums will hold the left and right GGM tree sums
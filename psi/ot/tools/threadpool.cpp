@@ -0,0 +1,214 @@
+#include "psi/ot/tools/threadpool.h"
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include <glog/logging.h>
+
+namespace primihub::crypto {
+namespace {
+// Parse a sysfs cpu list like "0-3,8-11".
+std::vector<int> parseCpuList(const std::string &list) {
+  std::vector<int> cpus;
+  std::stringstream ss(list);
+  std::string range;
+  while (std::getline(ss, range, ',')) {
+    if (range.empty())
+      continue;
+
+    auto dash = range.find('-');
+    int first = std::stoi(range.substr(0, dash));
+    int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+    for (int cpu = first; cpu <= last; ++cpu)
+      cpus.push_back(cpu);
+  }
+
+  return cpus;
+}
+
+// All cpus, grouped by NUMA node. Without sysfs it's just 0..n-1.
+std::vector<int> cpusByNode() {
+  std::vector<int> cpus;
+  for (int node = 0;; ++node) {
+    std::ifstream in("/sys/devices/system/node/node" + std::to_string(node) +
+                     "/cpulist");
+    if (!in)
+      break;
+
+    std::string list;
+    std::getline(in, list);
+    try {
+      auto nodeCpus = parseCpuList(list);
+      cpus.insert(cpus.end(), nodeCpus.begin(), nodeCpus.end());
+    } catch (const std::exception &e) {
+      LOG(WARNING) << "Parse cpu list of node " << node << " failed, "
+                   << e.what() << ".";
+    }
+  }
+
+  if (cpus.empty()) {
+    int num = std::max(1U, std::thread::hardware_concurrency());
+    for (int cpu = 0; cpu < num; ++cpu)
+      cpus.push_back(cpu);
+  }
+
+  return cpus;
+}
+} // namespace
+
+ThreadPool::ThreadPool(uint64_t numThreads, bool pinThreads) {
+  if (numThreads == 0)
+    numThreads = std::max(1U, std::thread::hardware_concurrency());
+
+  std::vector<int> cpus;
+  if (pinThreads)
+    cpus = cpusByNode();
+
+  mWorkers.reserve(numThreads);
+  for (uint64_t i = 0; i < numThreads; ++i) {
+    int cpu = cpus.size() ? cpus[i % cpus.size()] : -1;
+    mWorkers.emplace_back([this, i, cpu]() { workerLoop(i, cpu); });
+  }
+
+  VLOG(3) << "Start thread pool with " << numThreads << " workers"
+          << (pinThreads ? ", pinned." : ".");
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mMtx);
+    mStop = true;
+  }
+  mCond.notify_all();
+
+  for (auto &thrd : mWorkers)
+    thrd.join();
+}
+
+ThreadPool &ThreadPool::global() {
+  static ThreadPool pool;
+  return pool;
+}
+
+bool ThreadPool::runOne(Group &group) {
+  uint64_t idx = group.mNext++;
+  if (idx >= group.mSize)
+    return false;
+
+  try {
+    (*group.mFn)(idx);
+  } catch (...) {
+    std::lock_guard<std::mutex> lock(group.mMtx);
+    if (!group.mError)
+      group.mError = std::current_exception();
+  }
+
+  if (++group.mDone == group.mSize) {
+    std::lock_guard<std::mutex> lock(group.mMtx);
+    group.mCond.notify_all();
+  }
+
+  return true;
+}
+
+void ThreadPool::removeGroup(const std::shared_ptr<Group> &group) {
+  std::lock_guard<std::mutex> lock(mMtx);
+  auto iter = std::find(mGroups.begin(), mGroups.end(), group);
+  if (iter != mGroups.end())
+    mGroups.erase(iter);
+}
+
+void ThreadPool::workerLoop(uint64_t idx, int cpu) {
+  if (cpu >= 0) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    int ret = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (ret)
+      LOG(WARNING) << "Pin worker " << idx << " to cpu " << cpu
+                   << " failed, error " << ret << ".";
+  }
+
+  while (true) {
+    std::shared_ptr<Group> group;
+    {
+      std::unique_lock<std::mutex> lock(mMtx);
+      mCond.wait(lock, [this]() { return mStop || mGroups.size(); });
+      if (mStop)
+        return;
+
+      group = mGroups.front();
+      if (++group->mRunners == group->mMaxRunners)
+        mGroups.pop_front();
+    }
+
+    while (runOne(*group))
+      ;
+
+    // Every task is claimed, stop handing it out.
+    removeGroup(group);
+  }
+}
+
+void ThreadPool::parallelFor(uint64_t n,
+                             const std::function<void(uint64_t)> &fn,
+                             uint64_t maxThreads) {
+  if (n == 0)
+    return;
+
+  // The caller is one of the threads, no worker needs more than one task.
+  uint64_t helpers = n - 1;
+  if (maxThreads)
+    helpers = std::min(helpers, maxThreads - 1);
+
+  if (helpers == 0) {
+    std::exception_ptr error;
+    for (uint64_t i = 0; i < n; ++i) {
+      try {
+        fn(i);
+      } catch (...) {
+        if (!error)
+          error = std::current_exception();
+      }
+    }
+
+    if (error)
+      std::rethrow_exception(error);
+    return;
+  }
+
+  auto group = std::make_shared<Group>();
+  group->mFn = &fn;
+  group->mSize = n;
+  group->mMaxRunners = helpers + 1;
+  {
+    std::lock_guard<std::mutex> lock(mMtx);
+    mGroups.push_back(group);
+  }
+
+  if (helpers < mWorkers.size()) {
+    for (uint64_t i = 0; i < helpers; ++i)
+      mCond.notify_one();
+  } else {
+    mCond.notify_all();
+  }
+
+  while (runOne(*group))
+    ;
+  removeGroup(group);
+
+  {
+    std::unique_lock<std::mutex> lock(group->mMtx);
+    group->mCond.wait(lock, [&]() { return group->mDone == group->mSize; });
+  }
+
+  if (group->mError)
+    std::rethrow_exception(group->mError);
+}
+
+} // namespace primihub::crypto
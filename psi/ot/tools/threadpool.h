@@ -0,0 +1,106 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace primihub::crypto {
+
+// Persistent worker threads shared by the parallel phases of the OT, VOLE
+// and OKVS code, so that concurrent sessions share a fixed set of cores
+// instead of each phase creating numThreads new threads.
+//
+// Work is submitted with parallelFor. Idle workers take tasks from any
+// pending parallelFor, and the calling thread runs tasks of its own call
+// until all are done. So parallelFor can be called from inside a task, and
+// a call always makes progress even when every worker is busy. A call can
+// cap how many threads, the caller included, run its tasks at once.
+class ThreadPool {
+public:
+  // numThreads 0 means one worker per cpu. If pinThreads, worker i is pinned
+  // to the i'th cpu with cpus ordered by NUMA node, so neighbouring workers
+  // share a node.
+  explicit ThreadPool(uint64_t numThreads = 0, bool pinThreads = false);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  uint64_t numThreads() const { return mWorkers.size(); }
+
+  // Run fn(i) for i in [0, n) on at most maxThreads threads, 0 means no
+  // limit, and wait for them. The first exception thrown by a task is
+  // rethrown once all tasks are finished.
+  void parallelFor(uint64_t n, const std::function<void(uint64_t)> &fn,
+                   uint64_t maxThreads = 0);
+
+  // Process wide pool with one worker per cpu.
+  static ThreadPool &global();
+
+private:
+  struct Group {
+    const std::function<void(uint64_t)> *mFn = nullptr;
+    uint64_t mSize = 0;
+    // Threads running tasks of the group and their limit, under the pool's
+    // mMtx. The group leaves mGroups once it has mMaxRunners of them.
+    uint64_t mRunners = 1;
+    uint64_t mMaxRunners = 0;
+    std::atomic<uint64_t> mNext{0};
+    std::atomic<uint64_t> mDone{0};
+    std::mutex mMtx;
+    std::condition_variable mCond;
+    std::exception_ptr mError;
+  };
+
+  // Claim and run one task of group, return false if none is left.
+  bool runOne(Group &group);
+  void removeGroup(const std::shared_ptr<Group> &group);
+  void workerLoop(uint64_t idx, int cpu);
+
+  std::vector<std::thread> mWorkers;
+  std::mutex mMtx;
+  std::condition_variable mCond;
+  std::deque<std::shared_ptr<Group>> mGroups;
+  bool mStop = false;
+};
+
+// Where a parallel routine runs: a pool and how many threads of it the
+// routine may use, which is also the number of tasks run() splits the work
+// into. It converts from a thread count, which uses that many threads of the
+// global pool, or from a pool, which may use all its workers. So the
+// routines that used to take u64 numThreads accept either, and Workers(1)
+// runs everything on the calling thread as numThreads = 1 did.
+class Workers {
+public:
+  Workers(uint64_t numThreads = 0)
+      : mPool(&ThreadPool::global()),
+        mNumTasks(numThreads ? numThreads : 1) {}
+  Workers(ThreadPool &pool)
+      : mPool(&pool), mNumTasks(pool.numThreads() ? pool.numThreads() : 1) {}
+
+  ThreadPool &pool() const { return *mPool; }
+  uint64_t size() const { return mNumTasks; }
+
+  // Run fn(i) for i in [0, n) on at most size() threads.
+  void parallelFor(uint64_t n, const std::function<void(uint64_t)> &fn) const {
+    mPool->parallelFor(n, fn, mNumTasks);
+  }
+
+  // Run fn(i) for i in [0, size()), one task per thread.
+  void run(const std::function<void(uint64_t)> &fn) const {
+    mPool->parallelFor(mNumTasks, fn, mNumTasks);
+  }
+
+private:
+  ThreadPool *mPool;
+  uint64_t mNumTasks;
+};
+
+} // namespace primihub::crypto
@@ -147,6 +147,10 @@ void SilverConfigure(u64 numOTs, u64 secParam, MultType mMultType,
                      u64 &mRequestedNumOTs, u64 &mNumPartitions, u64 &mSizePer,
                      u64 &mN2, u64 &mN, u64 &gap, SilverEncoder &mEncoder);
 
+void EAConfigure(u64 numOTs, u64 secParam, MultType mMultType,
+                 u64 &mRequestedNumOTs, u64 &mNumPartitions, u64 &mSizePer,
+                 u64 &mN2, u64 &mN, EACode &mEncoder);
+
 void SilentOtExtReceiver::configure(u64 numOTs, u64 scaler, u64 numThreads,
                                     SilentSecType malType) {
   mMalType = malType;
@@ -167,9 +171,20 @@ void SilentOtExtReceiver::configure(u64 numOTs, u64 scaler, u64 numThreads,
     mGapOts.resize(gap);
     break;
   }
+  case MultType::ExAcc7:
+  case MultType::ExAcc11:
+  case MultType::ExAcc21:
+  case MultType::ExAcc40:
+    if (scaler != 2)
+      throw std::runtime_error(
+          "only scaler = 2 is supported for ExAcc. " LOCATION);
+
+    EAConfigure(numOTs, 128, mMultType, mRequestedNumOts, mNumPartitions,
+                mSizePer, mN2, mN, mEAEncoder);
+    break;
   default:
-    LOG(ERROR) << "Only support multtype slv5 and slv11.";
-    throw std::runtime_error("Only support multtype slv5 and slv11.");
+    LOG(ERROR) << "Unsupported multtype " << mMultType << ".";
+    throw std::runtime_error("Unsupported multtype.");
     break;
   }
 
@@ -568,8 +583,10 @@ void SilentOtExtReceiver::compress(ChoiceBitPacking packing) // )
 
   setTimePoint("recver.expand.ldpc.mult");
 
-  if (mTimer)
+  if (mTimer) {
     mEncoder.setTimer(getTimer());
+    mEAEncoder.setTimer(getTimer());
+  }
 
   if (packing == ChoiceBitPacking::True) {
     // zero out the lsb of mA. We will store mC there.
@@ -599,11 +616,20 @@ void SilentOtExtReceiver::compress(ChoiceBitPacking packing) // )
     switch (mMultType) {
     case MultType::slv5:
     case MultType::slv11:
-      mEncoder.dualEncode<block>(mA);
+      mEncoder.dualEncode<block>(mA, mNumThreads);
+      break;
+    case MultType::ExAcc7:
+    case MultType::ExAcc11:
+    case MultType::ExAcc21:
+    case MultType::ExAcc40: {
+      AlignedUnVector<block> A2(mRequestedNumOts);
+      mEAEncoder.dualEncode<block>(mA, A2);
+      std::swap(mA, A2);
       break;
+    }
     default:
-      LOG(ERROR) << "Only support multtype slv5 and slv11.";
-      throw std::runtime_error("Only support multtype slv5 and slv11.");
+      LOG(ERROR) << "Unsupported multtype " << mMultType << ".";
+      throw std::runtime_error("Unsupported multtype.");
       break;
     }
 
@@ -625,10 +651,21 @@ void SilentOtExtReceiver::compress(ChoiceBitPacking packing) // )
     switch (mMultType) {
     case MultType::slv5:
     case MultType::slv11:
-      mEncoder.dualEncode2<block, u8>(mA, mC);
+      mEncoder.dualEncode2<block, u8>(mA, mC, mNumThreads);
       break;
+    case MultType::ExAcc7:
+    case MultType::ExAcc11:
+    case MultType::ExAcc21:
+    case MultType::ExAcc40: {
+      AlignedUnVector<block> A2(mRequestedNumOts);
+      AlignedUnVector<u8> C2(mRequestedNumOts);
+      mEAEncoder.dualEncode2<block, u8>(mA, A2, mC, C2);
+      std::swap(mA, A2);
+      std::swap(mC, C2);
+      break;
+    }
     default:
-      throw std::runtime_error("Only support slv5 and slv11.");
+      throw std::runtime_error("Unsupported multtype.");
       break;
     }
 
@@ -34,6 +34,7 @@
 #include "psi/ot/tools/tools.h"
 #include "psi/ot/twochooseone/softspokenot/softspokenmalotext.h"
 #include "psi/ot/twochooseone/tcootdefines.h"
+#include "psi/ot/tools/eacode.h"
 #include "psi/ot/tools/ldpc/ldpcencoder.h"
 
 using namespace osuCrypto;
@@ -116,6 +117,9 @@ public:
   // The Silver encoder for MultType::slv5, MultType::slv11
   SilverEncoder mEncoder;
 
+  // The Expand-Accumulate encoder for MultType::ExAcc*
+  EACode mEAEncoder;
+
   // A flag that helps debug
   bool mDebug = false;
 
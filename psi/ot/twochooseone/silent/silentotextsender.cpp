@@ -97,6 +97,43 @@ void SilverConfigure(u64 numOTs, u64 secParam, MultType mMultType,
   mEncoder.mR.init(mN, code, true);
 }
 
+void EAConfigure(u64 numOTs, u64 secParam, MultType mMultType,
+                 u64 &mRequestedNumOTs, u64 &mNumPartitions, u64 &mSizePer,
+                 u64 &mN2, u64 &mN, EACode &mEncoder) {
+  auto mScaler = 2;
+  u64 w;
+  double minDist;
+  switch (mMultType) {
+  case MultType::ExAcc7:
+    w = 7;
+    minDist = 0.05;
+    break;
+  case MultType::ExAcc11:
+    w = 11;
+    minDist = 0.1;
+    break;
+  case MultType::ExAcc21:
+    w = 21;
+    minDist = 0.1;
+    break;
+  case MultType::ExAcc40:
+    w = 40;
+    minDist = 0.2;
+    break;
+  default:
+    throw RTE_LOC;
+  }
+
+  mRequestedNumOTs = numOTs;
+  mNumPartitions = getRegNoiseWeight(minDist, secParam);
+  mSizePer =
+      roundUpTo((numOTs * mScaler + mNumPartitions - 1) / mNumPartitions, 8);
+  mN2 = mSizePer * mNumPartitions;
+  mN = mN2 / mScaler;
+
+  mEncoder.config(numOTs, mN2, w);
+}
+
 // sets the KOS base OTs that are then used to extend
 void SilentOtExtSender::setBaseOts(span<block> baseRecvOts,
                                    const BitVector &choices) {
@@ -203,9 +240,20 @@ void SilentOtExtSender::configure(u64 numOTs, u64 scaler, u64 numThreads,
     mGapOts.resize(gap);
     break;
   }
+  case MultType::ExAcc7:
+  case MultType::ExAcc11:
+  case MultType::ExAcc21:
+  case MultType::ExAcc40:
+    if (scaler != 2)
+      throw std::runtime_error(
+          "only scaler = 2 is supported for ExAcc. " LOCATION);
+
+    EAConfigure(numOTs, 128, mMultType, mRequestNumOts, mNumPartitions,
+                mSizePer, mN2, mN, mEAEncoder);
+    break;
   default:
-    LOG(ERROR) << "Only support multtype slv5 and slv11.";
-    throw std::runtime_error("Only support multtype slv5 and slv11.");
+    LOG(ERROR) << "Unsupported multtype " << mMultType << ".";
+    throw std::runtime_error("Unsupported multtype.");
     break;
   }
 
@@ -533,13 +581,25 @@ void SilentOtExtSender::compress() {
   case MultType::slv11:
     if (mTimer)
       mEncoder.setTimer(getTimer());
-    mEncoder.dualEncode<block>(mB);
+    mEncoder.dualEncode<block>(mB, mNumThreads);
     setTimePoint("sender.expand.ldpc.dualEncode");
 
     break;
+  case MultType::ExAcc7:
+  case MultType::ExAcc11:
+  case MultType::ExAcc21:
+  case MultType::ExAcc40: {
+    if (mTimer)
+      mEAEncoder.setTimer(getTimer());
+    AlignedUnVector<block> B2(mRequestNumOts);
+    mEAEncoder.dualEncode<block>(mB, B2);
+    std::swap(mB, B2);
+    setTimePoint("sender.expand.ExAcc.dualEncode");
+    break;
+  }
   default:
-    LOG(ERROR) << "Only support multtype slv5 and slv11.";
-    throw std::runtime_error("Only support multtype slv5 and slv11.");
+    LOG(ERROR) << "Unsupported multtype " << mMultType << ".";
+    throw std::runtime_error("Unsupported multtype.");
     break;
   }
 }
@@ -33,6 +33,7 @@
 #include "psi/ot/tools/silentpprf.h"
 #include "psi/ot/twochooseone/softspokenot/softspokenmalotext.h"
 #include "psi/ot/twochooseone/tcootdefines.h"
+#include "psi/ot/tools/eacode.h"
 #include "psi/ot/tools/ldpc/ldpcencoder.h"
 
 using namespace osuCrypto;
@@ -130,6 +131,9 @@ public:
   // The Silver encoder for MultType::slv5, MultType::slv11
   SilverEncoder mEncoder;
 
+  // The Expand-Accumulate encoder for MultType::ExAcc*
+  EACode mEAEncoder;
+
   // The OTs send msgs which will be used to flood the
   // last gap bits of the noisy vector for the slv code.
   std::vector<std::array<block, 2>> mGapOts;
@@ -115,6 +115,10 @@ void SilverConfigure(u64 numOTs, u64 secParam, MultType mMultType,
                      u64 &mRequestedNumOTs, u64 &mNumPartitions, u64 &mSizePer,
                      u64 &mN2, u64 &mN, u64 &gap, SilverEncoder &mEncoder);
 
+void EAConfigure(u64 numOTs, u64 secParam, MultType mMultType,
+                 u64 &mRequestedNumOTs, u64 &mNumPartitions, u64 &mSizePer,
+                 u64 &mN2, u64 &mN, EACode &mEncoder);
+
 void SilentVoleReceiver::configure(u64 numOTs, SilentBaseType type,
                                    u64 secParam) {
   mState = State::Configured;
@@ -129,8 +133,15 @@ void SilentVoleReceiver::configure(u64 numOTs, SilentBaseType type,
                     mNumPartitions, mSizePer, mN2, mN, gap, mEncoder);
 
     break;
+  case MultType::ExAcc7:
+  case MultType::ExAcc11:
+  case MultType::ExAcc21:
+  case MultType::ExAcc40:
+    EAConfigure(numOTs, secParam, mMultType, mRequestedNumOTs, mNumPartitions,
+                mSizePer, mN2, mN, mEAEncoder);
+    break;
   default:
-    throw std::runtime_error("Only support multtype slv5 and slv11.");
+    throw std::runtime_error("Unsupported multtype.");
     break;
   }
 
@@ -443,11 +454,25 @@ void SilentVoleReceiver::silentReceiveInplace(
       mEncoder.setTimer(getTimer());
 
     // compress both mA and mC in place.
-    mEncoder.dualEncode2<block, block>(mA, mC);
+    mEncoder.dualEncode2<block, block>(mA, mC, mNumThreads);
     setTimePoint("SilentVoleReceiver.expand.cirTransEncode.a");
     break;
+  case MultType::ExAcc7:
+  case MultType::ExAcc11:
+  case MultType::ExAcc21:
+  case MultType::ExAcc40: {
+    if (mTimer)
+      mEAEncoder.setTimer(getTimer());
+
+    AlignedUnVector<block> A2(mRequestedNumOTs), C2(mRequestedNumOTs);
+    mEAEncoder.dualEncode2<block, block>(mA, A2, mC, C2);
+    std::swap(mA, A2);
+    std::swap(mC, C2);
+    setTimePoint("SilentVoleReceiver.expand.ExAcc");
+    break;
+  }
   default:
-    throw std::runtime_error("Only support multtype slv5 and slv11.");
+    throw std::runtime_error("Unsupported multtype.");
     break;
   }
   end = clock();
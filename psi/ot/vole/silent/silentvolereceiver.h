@@ -31,6 +31,7 @@
 #include "psi/ot/tools/silentpprf.h"
 #include "psi/ot/tools/tools.h"
 #include "psi/ot/twochooseone/softspokenot/softspokenmalotext.h"
+#include "psi/ot/tools/eacode.h"
 #include "psi/ot/tools/ldpc/ldpcencoder.h"
 #include "psi/ot/twochooseone/tcootdefines.h"
 
@@ -75,6 +76,9 @@ public:
   // The silver encoder.
   SilverEncoder mEncoder;
 
+  // The Expand-Accumulate encoder.
+  EACode mEAEncoder;
+
   // The multi-point punctured PRF for generating
   // the sparse vectors.
   SilentMultiPprfReceiver mGen;
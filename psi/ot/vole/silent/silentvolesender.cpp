@@ -138,6 +138,10 @@ void SilverConfigure(u64 numOTs, u64 secParam, MultType mMultType,
                      u64 &mRequestedNumOTs, u64 &mNumPartitions, u64 &mSizePer,
                      u64 &mN2, u64 &mN, u64 &gap, SilverEncoder &mEncoder);
 
+void EAConfigure(u64 numOTs, u64 secParam, MultType mMultType,
+                 u64 &mRequestedNumOTs, u64 &mNumPartitions, u64 &mSizePer,
+                 u64 &mN2, u64 &mN, EACode &mEncoder);
+
 void SilentVoleSender::configure(u64 numOTs, SilentBaseType type,
                                  u64 secParam) {
   mBaseType = type;
@@ -149,9 +153,16 @@ void SilentVoleSender::configure(u64 numOTs, SilentBaseType type,
     SilverConfigure(numOTs, secParam, mMultType, mRequestedNumOTs,
                     mNumPartitions, mSizePer, mN2, mN, gap, mEncoder);
     break;
+  case MultType::ExAcc7:
+  case MultType::ExAcc11:
+  case MultType::ExAcc21:
+  case MultType::ExAcc40:
+    EAConfigure(numOTs, secParam, mMultType, mRequestedNumOTs, mNumPartitions,
+                mSizePer, mN2, mN, mEAEncoder);
+    break;
   default:
-    LOG(ERROR) << "Only support multtype slv5 and slv11.";
-    throw std::runtime_error("Only support multtype slv5 and slv11.");
+    LOG(ERROR) << "Unsupported multtype " << mMultType << ".";
+    throw std::runtime_error("Unsupported multtype.");
     break;
   }
 
@@ -346,12 +357,25 @@ void SilentVoleSender::silentSendInplace(block delta, u64 n, PRNG &prng,
     if (mTimer)
       mEncoder.setTimer(getTimer());
 
-    mEncoder.dualEncode<block>(mB);
+    mEncoder.dualEncode<block>(mB, mNumThreads);
     setTimePoint("SilentVoleSender.expand.Silver");
     break;
+  case MultType::ExAcc7:
+  case MultType::ExAcc11:
+  case MultType::ExAcc21:
+  case MultType::ExAcc40: {
+    if (mTimer)
+      mEAEncoder.setTimer(getTimer());
+
+    AlignedUnVector<block> B2(mRequestedNumOTs);
+    mEAEncoder.dualEncode<block>(mB, B2);
+    std::swap(mB, B2);
+    setTimePoint("SilentVoleSender.expand.ExAcc");
+    break;
+  }
   default:
-    LOG(ERROR) << "Only support multtype slv5 and slv11.";
-    throw std::runtime_error("Only support multtype slv5 and slv11.");
+    LOG(ERROR) << "Unsupported multtype " << mMultType << ".";
+    throw std::runtime_error("Unsupported multtype.");
     break;
   }
 
@@ -33,6 +33,7 @@
 #include "psi/ot/tools/silentpprf.h"
 #include "psi/ot/twochooseone/softspokenot/softspokenmalotext.h"
 #include "psi/ot/twochooseone/tcootdefines.h"
+#include "psi/ot/tools/eacode.h"
 #include "psi/ot/tools/ldpc/ldpcencoder.h"
 //#define NO_HASH
 
@@ -69,6 +70,7 @@ public:
 
   MultType mMultType = DefaultMultType;
   SilverEncoder mEncoder;
+  EACode mEAEncoder;
 
   // span<block> mB;
   // u64 mBackingSize = 0;
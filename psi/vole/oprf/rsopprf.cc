@@ -2,6 +2,8 @@
 
 #include <glog/logging.h>
 
+#include "psi/okvs/baxosstream.h"
+
 namespace primihub::crypto {
 void RsOpprfSender::oprfEval(span<const block> X, span<u8> out,
                              span<const u8> add, u64 m, u64 numThreads) {
@@ -83,7 +85,7 @@ void RsOpprfSender::send(u64 recverSize, span<const block> X,
   std::cerr << "hashingSeed" << hashingSeed << std::endl;
   // MC_AWAIT(chl->send(std::move(hashingSeed)));
 
-  type = m % sizeof(block) ? PaxosParam::Binary : PaxosParam::GF128;
+  type = m % sizeof(block) ? PaxosParam::Binary : mDenseType;
   mPaxos.init(n, 1 << 14, 3, 40, type, hashingSeed);
 
   if (mTimer) mOprfSender.setTimer(*mTimer);
@@ -91,61 +93,39 @@ void RsOpprfSender::send(u64 recverSize, span<const block> X,
   // MC_AWAIT(mOprfSender.send(recverSize, prng, chl, numThreads));
   mOprfSender.send(recverSize, prng, chl, numThreads);
 
-  diffPtr.reset(new u8[nm]);
-  diffU8 = span<u8>(diffPtr.get(), nm);
-
-  if (diffU8.size() < val.size()) throw RTE_LOC;
-  memset(diffU8.data(), 0, val.size());
-  // for (auto diff_item : diffU8){
-  // std::cout << diff_item << "diffU8\n";
-  // }
-  oprfEval(X, diffU8, val, m, numThreads);
-
-  // std::cerr<<"\nX"<<X.data()<<std::endl;
-
   mPaxosByteWidth = m;
   mP.resize(mPaxos.size() * m);
 
-  setTimePoint("RsOpprfSender::send eval");
-
-  if (m == 16) {
-    // special case for block.
-    auto diff = span<block>((block*)diffU8.data(), n);
-    auto P = span<block>((block*)mP.data(), mPaxos.size());
-
-    // double check the bounds.
-    if ((u8*)(diff.data() + diff.size()) > diffU8.data() + diffU8.size())
-      throw RTE_LOC;
-    if ((u8*)(mP.data() + mP.size()) > mP.data() + mP.size()) throw RTE_LOC;
-
-    mPaxos.solve<block>(X, diff, P, &prng, numThreads);
-    for (auto P_item : P) {
-      std::cout << P_item << "P_item\n";
+  {
+    // The diffs are computed and hashed into their bins a batch at a time,
+    // so only one batch of them is held. The bins are then solved into mP
+    // and each one is sent while the next ones are solved.
+    okvs::BaxosStream stream;
+    stream.init(mPaxos, m);
+
+    u64 batchSize = std::min<u64>(n, 1 << 18);
+    diffPtr.reset(new u8[batchSize * m]);
+    for (u64 begin = 0; begin < n; begin += batchSize) {
+      auto size = std::min<u64>(batchSize, n - begin);
+      diffU8 = span<u8>(diffPtr.get(), size * m);
+      oprfEval(X.subspan(begin, size), diffU8,
+               span<const u8>(val.data() + begin * m, size * m), m,
+               numThreads);
+      stream.push(X.subspan(begin, size),
+                  MatrixView<const u8>(diffU8.data(), size, m));
     }
-    for (auto diff_item : diff) {
-      std::cout << diff_item << "diff_item\n";
-    }
-  } else {
-    // throw RTE_LOC;
-    auto diff = MatrixView<u8>(diffPtr.get(), n, m);
-    auto P = MatrixView<u8>((u8*)mP.data(), mPaxos.size(), m);
+    diffPtr.reset();
 
-    // double check the bounds.
-    if (diff.data() + diff.size() > diffU8.data() + diffU8.size())
-      throw RTE_LOC;
-    if (mP.data() + mP.size() > mP.data() + mP.size()) throw RTE_LOC;
+    setTimePoint("RsOpprfSender::send eval");
 
-    mPaxos.solve<u8>(X, diff, P, &prng, numThreads);
+    stream.finalize(MatrixView<u8>(mP.data(), mPaxos.size(), m), &prng,
+                    numThreads, [&](u64, MatrixView<const u8> p) {
+                      chl->send(span<u8>((u8*)p.data(), p.size()));
+                    });
   }
 
-  diffPtr.reset();
-
   setTimePoint("RsOpprfSender::send paxos solve");
 
-  // MC_AWAIT(chl->send(coproto::copy(mP)));
-  // chl->send(coproto::copy(mP));
-  chl->send(&mP);
-
   setTimePoint("RsOpprfSender::send end");
 
   // MC_END();
@@ -164,9 +144,9 @@ void RsOpprfSender::eval(span<const block> val, MatrixView<u8> output,
     // spacial case for block
     auto oo = span<block>((block*)output.data(), output.rows());
     auto pp = span<block>((block*)P.data(), P.rows());
-    mPaxos.decode<block>(val, oo, pp);
+    mPaxos.decode<block>(val, oo, pp, numThreads);
   } else {
-    mPaxos.decode<u8>(val, output, P);
+    mPaxos.decode<u8>(val, output, P, numThreads);
   }
 
   setTimePoint("RsOpprfSender::eval paxos decode");
@@ -208,7 +188,7 @@ void RsOpprfReceiver::receive(u64 senderSize, span<const block> values,
 
   // MC_AWAIT(chl->recv(paxos.mSeed));
   chl->recv(paxos.mSeed);
-  type = m % sizeof(block) ? PaxosParam::Binary : PaxosParam::GF128;
+  type = m % sizeof(block) ? PaxosParam::Binary : mDenseType;
   paxos.init(senderSize, 1 << 14, 3, 40, type, paxos.mSeed);
 
   if (mTimer) mOprfReceiver.setTimer(*mTimer);
@@ -233,7 +213,13 @@ void RsOpprfReceiver::receive(u64 senderSize, span<const block> values,
   mOprfReceiver.receive(values, oprfOutput, prng, chl, numThreads);
 
   p.resize(paxos.size(), m, oc::AllocType::Uninitialized);
-  chl->recv(p);
+
+  // the sender sends p a bin at a time, as the bins are solved.
+  {
+    auto sizePer = paxos.size() / paxos.mNumBins;
+    for (u64 binIdx = 0; binIdx < paxos.mNumBins; ++binIdx)
+      chl->recv(MatrixView<u8>(p.data() + binIdx * sizePer * m, sizePer, m));
+  }
   // MC_AWAIT(chl->recv(p));
   setTimePoint("RsOpprfReceiver::receive recv");
 
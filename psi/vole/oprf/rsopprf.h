@@ -84,6 +84,15 @@ class RsOpprfSender : public oc::TimerAdapter {
   RsOprfSender mOprfSender;
   void setMultType(MultType type) { mOprfSender.setMultType(type); };
 
+  // The dense type of the OPPRF paxos and of the inner OPRF. GF128 is only
+  // used when the values are a multiple of a block, Binary always is. Both
+  // parties must use the same type.
+  PaxosParam::DenseType mDenseType = PaxosParam::GF128;
+  void setDenseType(PaxosParam::DenseType type) {
+    mDenseType = type;
+    mOprfSender.mDenseType = type;
+  }
+
   // struct PP
   //{
   //	u8* mData = nullptr;
@@ -173,6 +182,13 @@ class RsOpprfReceiver : public oc::TimerAdapter {
   RsOprfReceiver mOprfReceiver;
   void setMultType(MultType type) { mOprfReceiver.setMultType(type); };
 
+  // Must match the sender, see RsOpprfSender::mDenseType.
+  PaxosParam::DenseType mDenseType = PaxosParam::GF128;
+  void setDenseType(PaxosParam::DenseType type) {
+    mDenseType = type;
+    mOprfReceiver.mDenseType = type;
+  }
+
   void receive(u64 senderSize, span<const block> values, span<block> outputs,
                PRNG& prng, u64 numThreads,
                const std::shared_ptr<Channel>& chl) {
@@ -2,14 +2,18 @@
 
 #include <glog/logging.h>
 #include <time.h>
+#include <chrono>
+#include <future>
 #include <iostream>
+
+#include "psi/ot/tools/gf128.h"
 // std::clock_t start = clock();
 // std::clock_t end = clock();
 // std::cout << taskname << "cost " << (double)(end - start) / CLOCKS_PER_SEC << "sec." << std::endl;
 
 namespace primihub::crypto {
 void RsOprfSender::send(u64 n, PRNG &prng, const std::shared_ptr<Channel> &chl,
-                        u64 numThreads, bool reducedRounds) {
+                        Workers workers, bool reducedRounds) {
   // MC_BEGIN(Proto, this, n, &prng, &chl, numThreads, reducedRounds,
   //     ws = block{},
   //     hBuff = std::array<u8, 32> {},
@@ -30,7 +34,6 @@ void RsOprfSender::send(u64 n, PRNG &prng, const std::shared_ptr<Channel> &chl,
   std::unique_ptr<block[]> pPtr;
   span<block> pp;
   span<block> subPp;
-  span<block> remB;
   span<block> subB;
   // macoro::eager_task<void> fu;
   u64 recvIdx;
@@ -39,8 +42,7 @@ void RsOprfSender::send(u64 n, PRNG &prng, const std::shared_ptr<Channel> &chl,
   setTimePoint("RsOprfSender::send-begin");
   ws = prng.get();
 
-  mPaxos.init(n, mBinSize, 3, mSsp, crypto::okvs::PaxosParam::GF128,
-              oc::ZeroBlock);
+  mPaxos.init(n, mBinSize, 3, mSsp, mDenseType, oc::ZeroBlock);
 
   mD = prng.get();
 
@@ -54,8 +56,7 @@ void RsOprfSender::send(u64 n, PRNG &prng, const std::shared_ptr<Channel> &chl,
 
   if (mTimer) mVoleSender.setTimer(*mTimer);
 
-  numThreads = std::max<u64>(1, numThreads);
-  mVoleSender.mNumThreads = numThreads;
+  mVoleSender.mNumThreads = workers.size();
   // a + b  = c * d
   fork = chl->fork();
   // fork = chl;
@@ -94,69 +95,44 @@ void RsOprfSender::send(u64 n, PRNG &prng, const std::shared_ptr<Channel> &chl,
     chl->recv(pp);
 
     setTimePoint("RsOprfSender::send-recv");
-    {
-      auto main = mB.size() / 8 * 8;
-      auto b = mB.data();
-      auto p = pp.data();
-      for (u64 i = 0; i < main; i += 8) {
-        b[0] = b[0] ^ mD.gf128Mul(p[0]);
-        b[1] = b[1] ^ mD.gf128Mul(p[1]);
-        b[2] = b[2] ^ mD.gf128Mul(p[2]);
-        b[3] = b[3] ^ mD.gf128Mul(p[3]);
-        b[4] = b[4] ^ mD.gf128Mul(p[4]);
-        b[5] = b[5] ^ mD.gf128Mul(p[5]);
-        b[6] = b[6] ^ mD.gf128Mul(p[6]);
-        b[7] = b[7] ^ mD.gf128Mul(p[7]);
-
-        b += 8;
-        p += 8;
-      }
-
-      for (u64 i = main; i < mB.size(); ++i) {
-        mB[i] = mB[i] ^ mD.gf128Mul(pp[i]);
-      }
-    }
+    gf128MulConstXor(mD, pp, mB);
     setTimePoint("RsOprfSender::send-gf128Mul");
   } else {
-    remB = mB;
-
-    while (pp.size()) {
-      subPp = pp.subspan(0, std::min<u64>(pp.size(), 1 << 28));
-      pp = pp.subspan(subPp.size());
-
-      subB = remB.subspan(0, subPp.size());
-      remB = remB.subspan(subPp.size());
-
-      setTimePoint("RsOprfSender::pre*-" + std::to_string(recvIdx));
-      // MC_AWAIT(chl->recv(subPp));
-      chl->recv(subPp);
-      setTimePoint("RsOprfSender::recv-" + std::to_string(recvIdx));
-
-      {
-        auto main = subB.size() / 8 * 8;
-        auto b = subB.data();
-        auto p = subPp.data();
-        for (u64 i = 0; i < main; i += 8) {
-          b[0] = b[0] ^ mD.gf128Mul(p[0]);
-          b[1] = b[1] ^ mD.gf128Mul(p[1]);
-          b[2] = b[2] ^ mD.gf128Mul(p[2]);
-          b[3] = b[3] ^ mD.gf128Mul(p[3]);
-          b[4] = b[4] ^ mD.gf128Mul(p[4]);
-          b[5] = b[5] ^ mD.gf128Mul(p[5]);
-          b[6] = b[6] ^ mD.gf128Mul(p[6]);
-          b[7] = b[7] ^ mD.gf128Mul(p[7]);
-
-          b += 8;
-          p += 8;
-        }
-
-        for (u64 i = main; i < subB.size(); ++i, ++b, ++p) {
-          *b = *b ^ mD.gf128Mul(*p);
-        }
-      }
+    // p arrives in chunks of 1 << 28 blocks. The next chunk is received
+    // while the workers correct the current one, in slices of 1 << 16.
+    static constexpr const u64 chunkSize = 1 << 28;
+    static constexpr const u64 sliceSize = 1 << 16;
+    u64 numChunks = oc::divCeil(pp.size(), chunkSize);
+    auto chunk = [&](span<block> s, u64 k) {
+      return s.subspan(k * chunkSize,
+                       std::min<u64>(chunkSize, s.size() - k * chunkSize));
+    };
+
+    recvIdx = 0;
+    if (numChunks) chl->recv(chunk(pp, 0));
+    setTimePoint("RsOprfSender::recv-0");
+
+    for (; recvIdx < numChunks; ++recvIdx) {
+      std::future<void> nextRecv;
+      if (recvIdx + 1 < numChunks)
+        nextRecv = std::async(std::launch::async, [&, k = recvIdx + 1]() {
+          chl->recv(chunk(pp, k));
+        });
+
+      subPp = chunk(pp, recvIdx);
+      subB = chunk(mB, recvIdx);
+      workers.parallelFor(oc::divCeil(subPp.size(), sliceSize), [&](u64 i) {
+        auto begin = i * sliceSize;
+        auto size = std::min<u64>(sliceSize, subPp.size() - begin);
+        gf128MulConstXor(mD, subPp.subspan(begin, size),
+                         subB.subspan(begin, size));
+      });
       setTimePoint("RsOprfSender::gf128Mul-" + std::to_string(recvIdx));
 
-      ++recvIdx;
+      if (nextRecv.valid()) {
+        nextRecv.get();
+        setTimePoint("RsOprfSender::recv-" + std::to_string(recvIdx + 1));
+      }
     }
   }
 
@@ -169,84 +145,67 @@ block RsOprfSender::eval(block v) {
   return o;
 }
 void RsOprfSender::eval(span<const block> val, span<block> output,
-                        u64 numThreads) {
+                        Workers workers) {
   setTimePoint("RsOprfSender::eval-begin");
 
-  mPaxos.decode<block>(val, output, mB, numThreads);
-
+  // Decode all items in one call so that Baxos sorts them by bin and each
+  // bin of mB is brought into cache once. The outputs are hashed by the
+  // decode tasks a batch at a time, before the batch is scattered to output.
+  auto hashPost = [&](span<const u64> idxs, span<block> batch) {
+    std::array<block, 32> v;
+    for (u64 k = 0; k < idxs.size(); ++k) v[k] = val[idxs[k]];
+    hashBlock(span<const block>(v.data(), idxs.size()), batch);
+  };
+
+  auto t0 = std::chrono::steady_clock::now();
+  mPaxos.decode<block>(val, output, mB, workers, hashPost);
+  auto t1 = std::chrono::steady_clock::now();
+
+  mEvalStats.mDecodeNs =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+
+  auto &ds = mPaxos.mDecodeStats;
+  VLOG(5) << "RsOprfSender eval " << val.size() << " items, "
+          << workers.size() << " threads, decode and hash "
+          << mEvalStats.mDecodeNs / 1000000 << "ms (sort "
+          << ds.mSortNs / 1000000 << "ms, " << ds.itemsPerSecond() / 1e6
+          << "M items/s).";
   setTimePoint("RsOprfSender::eval-decode");
+}
 
-  auto main = val.size() / 8 * 8;
-  auto o = output.data();
-  auto v = val.data();
-  std::array<block, 8> h;
+void RsOprfSender::hashBlock(span<const block> val, span<block> output) {
+  // output ^= mD * H(v) is applied to batches of H(v) with the gf128
+  // kernel, then each output is hashed.
+  static constexpr const u64 batchSize = 256;
+  std::array<block, batchSize> hBuff;
 
-  // todo, parallelize this.
-  if (mMalicious) {
-    oc::MultiKeyAES<8> hasher;
-
-    // main = 0;
-    for (u64 i = 0; i < main; i += 8) {
-      oc::mAesFixedKey.hashBlocks<8>(v, h.data());
-      o[0] = o[0] ^ mD.gf128Mul(h[0]);
-      o[1] = o[1] ^ mD.gf128Mul(h[1]);
-      o[2] = o[2] ^ mD.gf128Mul(h[2]);
-      o[3] = o[3] ^ mD.gf128Mul(h[3]);
-      o[4] = o[4] ^ mD.gf128Mul(h[4]);
-      o[5] = o[5] ^ mD.gf128Mul(h[5]);
-      o[6] = o[6] ^ mD.gf128Mul(h[6]);
-      o[7] = o[7] ^ mD.gf128Mul(h[7]);
-
-      o[0] = o[0] ^ mW;
-      o[1] = o[1] ^ mW;
-      o[2] = o[2] ^ mW;
-      o[3] = o[3] ^ mW;
-      o[4] = o[4] ^ mW;
-      o[5] = o[5] ^ mW;
-      o[6] = o[6] ^ mW;
-      o[7] = o[7] ^ mW;
-
-      hasher.setKeys({o, 8});
-      hasher.hashNBlocks(v, o);
-
-      o += 8;
-      v += 8;
-    }
-    for (u64 i = main; i < val.size(); ++i) {
-      auto h = oc::mAesFixedKey.hashBlock(val[i]);
-      output[i] = output[i] ^ mD.gf128Mul(h);
+  for (u64 begin = 0; begin < val.size(); begin += batchSize) {
+    u64 size = std::min<u64>(batchSize, val.size() - begin);
+    auto v = val.subspan(begin, size);
+    auto o = output.subspan(begin, size);
 
-      output[i] = output[i] ^ mW;
-      output[i] = oc::AES(output[i]).hashBlock(val[i]);
-    }
-  } else {
-    for (u64 i = 0; i < main; i += 8) {
-      oc::mAesFixedKey.hashBlocks<8>(v, h.data());
-      // auto h = v;
-
-      o[0] = o[0] ^ mD.gf128Mul(h[0]);
-      o[1] = o[1] ^ mD.gf128Mul(h[1]);
-      o[2] = o[2] ^ mD.gf128Mul(h[2]);
-      o[3] = o[3] ^ mD.gf128Mul(h[3]);
-      o[4] = o[4] ^ mD.gf128Mul(h[4]);
-      o[5] = o[5] ^ mD.gf128Mul(h[5]);
-      o[6] = o[6] ^ mD.gf128Mul(h[6]);
-      o[7] = o[7] ^ mD.gf128Mul(h[7]);
-
-      oc::mAesFixedKey.hashBlocks<8>(o, o);
-
-      o += 8;
-      v += 8;
-    }
+    auto h = span<block>(hBuff.data(), size);
+    oc::mAesFixedKey.hashBlocks(v, h);
+    gf128MulConstXor(mD, h, o);
 
-    for (u64 i = main; i < val.size(); ++i) {
-      auto h = oc::mAesFixedKey.hashBlock(val[i]);
-      output[i] = output[i] ^ mD.gf128Mul(h);
-      output[i] = oc::mAesFixedKey.hashBlock(output[i]);
+    auto main = size / 8 * 8;
+    if (mMalicious) {
+      oc::MultiKeyAES<8> hasher;
+      for (u64 i = 0; i < main; i += 8) {
+        for (u64 j = 0; j < 8; ++j) o[i + j] = o[i + j] ^ mW;
+        hasher.setKeys({o.data() + i, 8});
+        hasher.hashNBlocks(v.data() + i, o.data() + i);
+      }
+      for (u64 i = main; i < size; ++i) {
+        o[i] = o[i] ^ mW;
+        o[i] = oc::AES(o[i]).hashBlock(v[i]);
+      }
+    } else {
+      for (u64 i = 0; i < main; i += 8)
+        oc::mAesFixedKey.hashBlocks<8>(o.data() + i, o.data() + i);
+      for (u64 i = main; i < size; ++i) o[i] = oc::mAesFixedKey.hashBlock(o[i]);
     }
   }
-
-  setTimePoint("RsOprfSender::eval-hash");
 }
 
 void RsOprfSender::genVole(PRNG &prng, const std::shared_ptr<Channel> &chl,
@@ -268,7 +227,7 @@ struct UninitVec : span<block> {
 
 void RsOprfReceiver::receive(span<const block> values, span<block> outputs,
                              PRNG &prng, const std::shared_ptr<Channel> &chl,
-                             u64 numThreads, bool reducedRounds) {
+                             Workers workers, bool reducedRounds) {
   // MC_BEGIN(Proto, this, values, outputs, &prng, &chl, numThreads,
   // reducedRounds,
   //     hashingSeed = block{},
@@ -309,8 +268,7 @@ void RsOprfReceiver::receive(span<const block> values, span<block> outputs,
 
   hashingSeed = prng.get(), wr = prng.get();
   paxos.mDebug = mDebug;
-  paxos.init(values.size(), mBinSize, 3, mSsp, crypto::okvs::PaxosParam::GF128,
-             hashingSeed);
+  paxos.init(values.size(), mBinSize, 3, mSsp, mDenseType, hashingSeed);
 
   // MC_AWAIT(chl->send(std::move(hashingSeed)));
   chl->send(std::move(hashingSeed));
@@ -345,7 +303,7 @@ void RsOprfReceiver::receive(span<const block> values, span<block> outputs,
 
   setTimePoint("RsOprfReceiver::receive-alloc");
 
-  paxos.solve<block>(values, h, p, nullptr, numThreads);
+  paxos.solve<block>(values, h, p, nullptr, workers);
   setTimePoint("RsOprfReceiver::receive-solve");
   // MC_AWAIT(fu);
 
@@ -434,7 +392,7 @@ void RsOprfReceiver::receive(span<const block> values, span<block> outputs,
     }
   }
 
-  paxos.decode<block>(values, outputs, a, numThreads);
+  paxos.decode<block>(values, outputs, a, workers);
 
   setTimePoint("RsOprfReceiver::receive-decode");
 
@@ -19,6 +19,12 @@ namespace primihub::crypto {
 
 class RsOprfSender : public oc::TimerAdapter {
  public:
+  // Wall time of the last eval. The outputs are hashed inside the decode,
+  // so mDecodeNs covers both. The throughput is in mPaxos.mDecodeStats.
+  struct EvalStats {
+    u64 mDecodeNs = 0;
+  };
+
   crypto::SilentVoleSender mVoleSender;
   span<block> mB;
   block mD;
@@ -28,19 +34,30 @@ class RsOprfSender : public oc::TimerAdapter {
   u64 mBinSize = 1 << 14;
   u64 mSsp = 40;
   bool mDebug = false;
+  EvalStats mEvalStats;
   using PaxosParam = crypto::okvs::PaxosParam;
 
+  // The dense columns of the paxos. Binary adds mSsp dense columns per bin
+  // but encodes and decodes with xors instead of gf128 multiplications.
+  // Both parties must use the same type.
+  PaxosParam::DenseType mDenseType = PaxosParam::GF128;
+
   void setMultType(MultType type) { mVoleSender.mMultType = type; };
 
   void send(u64 n, PRNG& prng, const std::shared_ptr<Channel>& chl,
-            u64 mNumThreads = 0, bool reducedRounds = false);
+            Workers workers = {}, bool reducedRounds = false);
 
   block eval(block v);
 
-  void eval(span<const block> val, span<block> output, u64 mNumThreads = 0);
+  void eval(span<const block> val, span<block> output, Workers workers = {});
 
   void genVole(PRNG& prng, const std::shared_ptr<Channel>& chl,
                bool reducedRounds);
+
+ private:
+  // Hash a batch of decoded outputs on the calling thread, val[i] is the
+  // input of output[i].
+  void hashBlock(span<const block> val, span<block> output);
 };
 
 class RsOprfReceiver : public oc::TimerAdapter {
@@ -51,10 +68,14 @@ class RsOprfReceiver : public oc::TimerAdapter {
   u64 mSsp = 40;
   bool mDebug = false;
 
+  // Must match the sender, see RsOprfSender::mDenseType.
+  crypto::okvs::PaxosParam::DenseType mDenseType =
+      crypto::okvs::PaxosParam::GF128;
+
   void setMultType(MultType type) { mVoleRecver.mMultType = type; };
 
   void receive(span<const block> values, span<block> outputs, PRNG& prng,
-               const std::shared_ptr<Channel>& chl, u64 mNumThreads = 0,
+               const std::shared_ptr<Channel>& chl, Workers workers = {},
                bool reducedRounds = false);
 
   void genVole(u64 n, PRNG& prng, const std::shared_ptr<Channel>& chl,
@@ -0,0 +1,173 @@
+#include "psi/vole/psi/hashtable.h"
+
+#include <immintrin.h>
+#include <string.h>
+
+#include <algorithm>
+#include <array>
+
+namespace primihub::crypto {
+namespace {
+inline u8 tagOf(u64 h) { return h & 0x7f; }
+
+inline u64 groupOf(u64 h, u64 groupMask) { return (h >> 7) & groupMask; }
+
+// Number of keys looked up together, their groups are prefetched first.
+constexpr u64 kFindBatch = 16;
+}  // namespace
+
+void PartitionedHashTable::Partition::alloc(u64 numKeys, u64 maskSize) {
+  // Keep load factor under 7/8.
+  u64 numGroups = 1;
+  while (numGroups * kGroupSize * 7 < numKeys * 8) numGroups <<= 1;
+
+  mGroupMask = numGroups - 1;
+  mCtrl.reset(new u8[numGroups * kGroupSize]);
+  mKeys.reset(new u8[numGroups * kGroupSize * maskSize]);
+  mValues.reset(new u64[numGroups * kGroupSize]);
+  memset(mCtrl.get(), kEmpty, numGroups * kGroupSize);
+}
+
+void PartitionedHashTable::init(u64 maskSize, u64 numPartitions) {
+  if (maskSize == 0 || maskSize > sizeof(okvs::block)) throw RTE_LOC;
+
+  mMaskSize = maskSize;
+  mPartitions.clear();
+  mPartitions.resize(std::max<u64>(1, numPartitions));
+}
+
+u64 PartitionedHashTable::hash(const u8* key) const {
+  u64 lo = 0;
+  u64 hi = 0;
+  memcpy(&lo, key, std::min<u64>(mMaskSize, 8));
+  if (mMaskSize > 8) memcpy(&hi, key + 8, mMaskSize - 8);
+
+  u64 h = (lo ^ (hi * 0xc2b2ae3d27d4eb4full)) * 0x9e3779b97f4a7c15ull;
+  return h ^ (h >> 29);
+}
+
+u64 PartitionedHashTable::partitionOf(u64 h) const {
+  return ((h >> 32) * mPartitions.size()) >> 32;
+}
+
+void PartitionedHashTable::insert(Partition& part, u64 h, const u8* key,
+                                  u64 value) {
+  auto group = groupOf(h, part.mGroupMask);
+  auto empty = _mm_set1_epi8(static_cast<char>(kEmpty));
+  while (true) {
+    u8* ctrl = part.mCtrl.get() + group * kGroupSize;
+    auto ctrls = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl));
+    u32 free = _mm_movemask_epi8(_mm_cmpeq_epi8(ctrls, empty));
+    if (free) {
+      u64 slot = group * kGroupSize + __builtin_ctz(free);
+      part.mCtrl[slot] = tagOf(h);
+      memcpy(part.mKeys.get() + slot * mMaskSize, key, mMaskSize);
+      part.mValues[slot] = value;
+      return;
+    }
+
+    group = (group + 1) & part.mGroupMask;
+  }
+}
+
+bool PartitionedHashTable::lookup(const Partition& part, u64 h, const u8* key,
+                                  u64& value) const {
+  auto group = groupOf(h, part.mGroupMask);
+  auto tag = _mm_set1_epi8(static_cast<char>(tagOf(h)));
+  auto empty = _mm_set1_epi8(static_cast<char>(kEmpty));
+  while (true) {
+    const u8* ctrl = part.mCtrl.get() + group * kGroupSize;
+    auto ctrls = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl));
+    u32 hits = _mm_movemask_epi8(_mm_cmpeq_epi8(ctrls, tag));
+    while (hits) {
+      u64 slot = group * kGroupSize + __builtin_ctz(hits);
+      if (!memcmp(part.mKeys.get() + slot * mMaskSize, key, mMaskSize)) {
+        value = part.mValues[slot];
+        return true;
+      }
+      hits &= hits - 1;
+    }
+
+    // Probing stops at the first group with a free slot.
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(ctrls, empty))) return false;
+
+    group = (group + 1) & part.mGroupMask;
+  }
+}
+
+void PartitionedHashTable::build(const u8* keys, u64 numKeys, u64 stride,
+                                 Workers workers) {
+  u64 numThreads = workers.size();
+  u64 numParts = mPartitions.size();
+
+  // Count keys of every partition in each thread's range, then scatter their
+  // indices so that each partition is contiguous.
+  std::vector<u64> offsets(numThreads * numParts, 0);
+  workers.run([&](u64 thrdIdx) {
+    u64* count = offsets.data() + thrdIdx * numParts;
+    u64 begin = numKeys * thrdIdx / numThreads;
+    u64 end = numKeys * (thrdIdx + 1) / numThreads;
+    for (u64 i = begin; i < end; ++i)
+      ++count[partitionOf(hash(keys + i * stride))];
+  });
+
+  std::vector<u64> partBegin(numParts + 1, 0);
+  u64 sum = 0;
+  for (u64 p = 0; p < numParts; ++p) {
+    partBegin[p] = sum;
+    for (u64 t = 0; t < numThreads; ++t) {
+      u64 count = offsets[t * numParts + p];
+      offsets[t * numParts + p] = sum;
+      sum += count;
+    }
+  }
+  partBegin[numParts] = sum;
+
+  std::unique_ptr<u64[]> order(new u64[numKeys]);
+  workers.run([&](u64 thrdIdx) {
+    u64* offset = offsets.data() + thrdIdx * numParts;
+    u64 begin = numKeys * thrdIdx / numThreads;
+    u64 end = numKeys * (thrdIdx + 1) / numThreads;
+    for (u64 i = begin; i < end; ++i)
+      order[offset[partitionOf(hash(keys + i * stride))]++] = i;
+  });
+
+  workers.run([&](u64 thrdIdx) {
+    for (u64 p = thrdIdx; p < numParts; p += numThreads) {
+      auto& part = mPartitions[p];
+      part.alloc(partBegin[p + 1] - partBegin[p], mMaskSize);
+      for (u64 j = partBegin[p]; j < partBegin[p + 1]; ++j) {
+        const u8* key = keys + order[j] * stride;
+        insert(part, hash(key), key, order[j]);
+      }
+    }
+  });
+}
+
+void PartitionedHashTable::find(const u8* keys, u64 numKeys, u64 stride,
+                                std::vector<u64>& matches) const {
+  std::array<u64, kFindBatch> h;
+  std::array<const Partition*, kFindBatch> parts;
+  for (u64 i = 0; i < numKeys; i += kFindBatch) {
+    u64 size = std::min<u64>(kFindBatch, numKeys - i);
+    for (u64 j = 0; j < size; ++j) {
+      h[j] = hash(keys + (i + j) * stride);
+      parts[j] = &mPartitions[partitionOf(h[j])];
+
+      auto group = groupOf(h[j], parts[j]->mGroupMask);
+      _mm_prefetch(reinterpret_cast<const char*>(parts[j]->mCtrl.get() +
+                                                 group * kGroupSize),
+                   _MM_HINT_T0);
+      _mm_prefetch(reinterpret_cast<const char*>(
+                       parts[j]->mKeys.get() + group * kGroupSize * mMaskSize),
+                   _MM_HINT_T0);
+    }
+
+    for (u64 j = 0; j < size; ++j) {
+      u64 value;
+      if (lookup(*parts[j], h[j], keys + (i + j) * stride, value))
+        matches.push_back(value);
+    }
+  }
+}
+}  // namespace primihub::crypto
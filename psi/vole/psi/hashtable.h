@@ -0,0 +1,58 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "psi/okvs/defines.h"
+#include "psi/ot/tools/threadpool.h"
+
+namespace primihub::crypto {
+using u8 = okvs::u8;
+using u32 = okvs::u32;
+using u64 = okvs::u64;
+
+// Open addressing hash table for the PSI receiver, mapping a hash to its
+// index in the receiver's set. Keys are split into partitions by their high
+// hash bits, each partition is a table of 16-slot groups with one control
+// byte per slot, probed with SSE2 compares of a 7-bit tag. Only the low
+// maskSize bytes of a key are stored and compared, the keys are expected to
+// be uniformly random like the OPRF outputs.
+class PartitionedHashTable {
+ public:
+  // Keys compare equal if their low maskSize bytes do.
+  void init(u64 maskSize, u64 numPartitions);
+
+  // Insert key i -> i for all numKeys keys, key i starts at keys + i * stride.
+  // Keys are partitioned in one parallel pass, then each task builds its own
+  // partitions.
+  void build(const u8* keys, u64 numKeys, u64 stride, Workers workers);
+
+  // Look up numKeys keys laid out like in build. Values of the found keys are
+  // appended to matches. Safe to call from many threads after build.
+  void find(const u8* keys, u64 numKeys, u64 stride,
+            std::vector<u64>& matches) const;
+
+  u64 numPartitions() const { return mPartitions.size(); }
+
+ private:
+  static constexpr u64 kGroupSize = 16;
+  static constexpr u8 kEmpty = 0x80;
+
+  struct Partition {
+    u64 mGroupMask = 0;
+    std::unique_ptr<u8[]> mCtrl;
+    std::unique_ptr<u8[]> mKeys;
+    std::unique_ptr<u64[]> mValues;
+
+    void alloc(u64 numKeys, u64 maskSize);
+  };
+
+  u64 hash(const u8* key) const;
+  u64 partitionOf(u64 h) const;
+  void insert(Partition& part, u64 h, const u8* key, u64 value);
+  bool lookup(const Partition& part, u64 h, const u8* key, u64& value) const;
+
+  u64 mMaskSize = 0;
+  std::vector<Partition> mPartitions;
+};
+}  // namespace primihub::crypto
@@ -1,6 +1,8 @@
 #include "psi/vole/psi/rspsi.h"
 
 #include <array>
+#include <condition_variable>
+#include <functional>
 #include <future>
 #include <time.h>
 #include <iostream>
@@ -21,6 +23,98 @@ struct Buffer : public span<T> {
   }
 };
 
+namespace {
+// Keep the low maskSize bytes of each hash, in place.
+span<u8> compressHashes(span<block> hashes, u64 maskSize) {
+  auto src = hashes.data();
+  auto dest = (u8*)hashes.data();
+  u64 i = 0;
+
+  for (; i < std::min<u64>(hashes.size(), 100); ++i) {
+    memmove(dest, src, maskSize);
+    dest += maskSize;
+    src += 1;
+  }
+  for (; i < hashes.size(); ++i) {
+    memcpy(dest, src, maskSize);
+    dest += maskSize;
+    src += 1;
+  }
+
+  return span<u8>((u8*)hashes.data(), dest);
+}
+
+// Receives the sender's hashes batch by batch into a ring of slots, so at
+// most numSlots batches are held in memory. A slot is reused once the reader
+// releases its batch.
+class HashStream {
+ public:
+  HashStream(u64 numElems, u64 batchSize, u64 maskSize, u64 numSlots = 4)
+      : mNumElems(numElems),
+        mBatchSize(batchSize),
+        mMaskSize(maskSize),
+        mReleased(numSlots, false) {
+    mData.reset(new u8[numSlots * batchSize * maskSize]);
+  }
+
+  u64 numBatches() const { return oc::divCeil(mNumElems, mBatchSize); }
+
+  // Run by the thread which owns the channel.
+  void recvAll(const std::shared_ptr<Channel>& chl) {
+    for (u64 idx = 0; idx < numBatches(); ++idx) {
+      u64 slot = idx % mReleased.size();
+      {
+        std::unique_lock<std::mutex> lock(mMtx);
+        mCond.wait(lock, [&]() {
+          return idx < mReleased.size() || mReleased[slot];
+        });
+        mReleased[slot] = false;
+      }
+
+      chl->recv(view(idx));
+
+      {
+        std::lock_guard<std::mutex> lock(mMtx);
+        mReceived = idx + 1;
+      }
+      mCond.notify_all();
+    }
+  }
+
+  // Block until batch idx arrives.
+  oc::MatrixView<u8> get(u64 idx) {
+    std::unique_lock<std::mutex> lock(mMtx);
+    mCond.wait(lock, [&]() { return mReceived > idx; });
+    return view(idx);
+  }
+
+  void release(u64 idx) {
+    {
+      std::lock_guard<std::mutex> lock(mMtx);
+      mReleased[idx % mReleased.size()] = true;
+    }
+    mCond.notify_all();
+  }
+
+ private:
+  oc::MatrixView<u8> view(u64 idx) {
+    u64 rows = std::min(mBatchSize, mNumElems - idx * mBatchSize);
+    u8* ptr = mData.get() + (idx % mReleased.size()) * mBatchSize * mMaskSize;
+    return oc::MatrixView<u8>(ptr, rows, mMaskSize);
+  }
+
+  u64 mNumElems;
+  u64 mBatchSize;
+  u64 mMaskSize;
+  std::unique_ptr<u8[]> mData;
+
+  std::mutex mMtx;
+  std::condition_variable mCond;
+  u64 mReceived = 0;
+  std::vector<bool> mReleased;
+};
+}  // namespace
+
 void details::RsPsiBase::init(u64 senderSize, u64 recverSize, u64 statSecParam,
                               block seed, bool malicious, u64 numThreads,
                               bool useReducedRounds) {
@@ -43,7 +137,31 @@ void details::RsPsiBase::init(u64 senderSize, u64 recverSize, u64 statSecParam,
 }
 
 void RsPsiSender::run(span<block> inputs, const std::shared_ptr<Channel>& chl) {
-  auto hashes = std::move(Buffer<u8>{});
+  run(inputs, chl, [&](span<block> hashes) {
+    span<u8> msg((u8*)hashes.data(), hashes.size() * sizeof(block));
+    if (mCompress) msg = compressHashes(hashes, mMaskSize);
+    chl->send(std::move(msg));
+  });
+}
+
+void RsPsiSender::run(span<block> inputs,
+                      const std::shared_ptr<network::CryptoChannel>& chl) {
+  // The low mMaskSize bytes of each hash go out straight from the evaluated
+  // blocks, through the socket's bounded staging buffer.
+  auto link = std::make_shared<network::LinkChannel>(chl);
+  auto key = chl->getTag();
+  run(inputs, std::make_shared<Channel>(link, key), [&](span<block> hashes) {
+    auto status = link->keyed().sendStrided(
+        key, hashes.data(), hashes.size(), sizeof(block), mMaskSize);
+    if (!status.IsOK()) {
+      LOG(ERROR) << "Send hashes failed, tag " << key << ".";
+      throw RTE_LOC;
+    }
+  });
+}
+
+void RsPsiSender::run(span<block> inputs, const std::shared_ptr<Channel>& chl,
+                      const std::function<void(span<block>)>& sendHashes) {
   std::clock_t start;
   std::clock_t end;
   setTimePoint("RsPsiSender::run-begin");
@@ -54,39 +172,47 @@ void RsPsiSender::run(span<block> inputs, const std::shared_ptr<Channel>& chl) {
   mSender.mSsp = mSsp;
   mSender.mDebug = mDebug;
   start = clock();
-  mSender.send(mRecverSize, mPrng, chl, mNumThreads, mUseReducedRounds);
+  mSender.send(mRecverSize, mPrng, chl, workers(), mUseReducedRounds);
   end = clock();
   setTimePoint("RsPsiSender:: run-oprf");
   std::cout  << " RsPsiSender:: run-oprf cost " << (double)(end - start) / CLOCKS_PER_SEC << "sec." << std::endl;
 
+  if (mBatchSize) {
+    // Evaluate batch k while batch k - 1 is being sent, sends stay in order.
+    u64 batchSize = std::min<u64>(mBatchSize, inputs.size());
+    std::array<Buffer<block>, 2> evals;
+    std::future<void> prevSend;
+
+    start = clock();
+    evals[0].resize(batchSize);
+    evals[1].resize(batchSize);
+    for (u64 begin = 0, k = 0; begin < inputs.size(); begin += batchSize, ++k) {
+      u64 size = std::min<u64>(batchSize, inputs.size() - begin);
+      span<block> out(evals[k & 1].data(), size);
+      mSender.eval(inputs.subspan(begin, size), out, workers());
+
+      if (prevSend.valid()) prevSend.get();
+      prevSend = std::async(std::launch::async,
+                            [&sendHashes, out]() { sendHashes(out); });
+    }
+
+    if (prevSend.valid()) prevSend.get();
+    end = clock();
+    setTimePoint("RsPsiSender::run-evalSendHash");
+    std::cout  << " RsPsiSender::run-evalSendHash cost " << (double)(end - start) / CLOCKS_PER_SEC << "sec." << std::endl;
+    return;
+  }
+
   start = clock();
-  hashes.resize(inputs.size() * sizeof(block));
-  mSender.eval(inputs, span<block>((block*)hashes.data(), inputs.size()),
-               mNumThreads);
+  Buffer<block> hashes;
+  hashes.resize(inputs.size());
+  mSender.eval(inputs, hashes, workers());
   end = clock();
   std::cout  << " RsPsiSender::run-eval cost " << (double)(end - start) / CLOCKS_PER_SEC << "sec." << std::endl;
 
   setTimePoint("RsPsiSender::run-eval");
   start = clock();
-  if (mCompress) {
-    auto src = (block*)hashes.data();
-    auto dest = (u8*)hashes.data();
-    u64 i = 0;
-
-    for (; i < std::min<u64>(mSenderSize, 100); ++i) {
-      memmove(dest, src, mMaskSize);
-      dest += mMaskSize;
-      src += 1;
-    }
-    for (; i < mSenderSize; ++i) {
-      memcpy(dest, src, mMaskSize);
-      dest += mMaskSize;
-      src += 1;
-    }
-    static_cast<span<u8>&>(hashes) = span<u8>((u8*)hashes.data(), dest);
-  }
-
-  chl->send(std::move(hashes));
+  sendHashes(hashes);
   end = clock();
   setTimePoint("RsPsiSender::run-sendHash");
   std::cout  << " RsPsiSender::run-sendHash cost " << (double)(end - start) / CLOCKS_PER_SEC << "sec." << std::endl;
@@ -94,51 +220,41 @@ void RsPsiSender::run(span<block> inputs, const std::shared_ptr<Channel>& chl) {
 }
 
 namespace {
-struct NoHash {
-  inline size_t operator()(const block& v) const { return v.get<size_t>(0); }
-};
+// Receiver hashes per table partition, sized so that a partition's groups
+// stay in L2 while it is built.
+constexpr u64 kPartitionSize = 1 << 13;
 }  // namespace
 
 void RsPsiReceiver::run(span<block> inputs,
                         const std::shared_ptr<Channel>& chl) {
   setTimePoint("RsPsiReceiver::run-enter");
-  static const u64 batchSize = 128;
   std::clock_t start;
   std::clock_t end;
-  struct MultiThread {
-    std::promise<void> prom;
-    std::shared_future<void> fu;
-    std::vector<std::thread> thrds;
-    std::function<void(u64)> routine;
-    std::atomic<u64> numDone;
-    std::promise<void> hashingDoneProm;
-    std::shared_future<void> hashingDoneFu;
-    std::mutex mMergeMtx;
-
-    u64 numThreads;
-    u64 binSize;
-    okvs::libdivide::libdivide_u32_t divider;
-  };
 
   std::unique_ptr<u8[]> data;
   span<block> myHashes;
   oc::MatrixView<u8> theirHashes;
-  google::dense_hash_map<block, u64, NoHash> map;
-  u64 i;
-  u64 main;
-  std::array<std::pair<block, u64>, 128> hh;
-  std::unique_ptr<MultiThread> mt;
-  block mask;
+  PartitionedHashTable table;
+  std::unique_ptr<HashStream> stream;
+  std::mutex mergeMtx;
+  auto workers = this->workers();
 
   setTimePoint("RsPsiReceiver::run-begin");
   mIntersection.clear();
 
-  data = std::unique_ptr<u8[]>(
-      new u8[mSenderSize * mMaskSize + mRecverSize * sizeof(block)]);
+  if (mBatchSize) {
+    // Their hashes live in a bounded window of batches.
+    data = std::unique_ptr<u8[]>(new u8[mRecverSize * sizeof(block)]);
+    myHashes = span<block>((block*)data.get(), mRecverSize);
+    stream.reset(new HashStream(mSenderSize, mBatchSize, mMaskSize));
+  } else {
+    data = std::unique_ptr<u8[]>(
+        new u8[mSenderSize * mMaskSize + mRecverSize * sizeof(block)]);
 
-  myHashes = span<block>((block*)data.get(), mRecverSize);
-  theirHashes = oc::MatrixView<u8>((u8*)((block*)data.get() + mRecverSize),
-                                   mSenderSize, mMaskSize);
+    myHashes = span<block>((block*)data.get(), mRecverSize);
+    theirHashes = oc::MatrixView<u8>((u8*)((block*)data.get() + mRecverSize),
+                                     mSenderSize, mMaskSize);
+  }
 
   setTimePoint("RsPsiReceiver::run-alloc");
 
@@ -150,152 +266,75 @@ void RsPsiReceiver::run(span<block> inputs,
 
   // todo, parallelize these two
   start = clock();
-  mRecver.receive(inputs, myHashes, mPrng, chl, mNumThreads, mUseReducedRounds);
+  mRecver.receive(inputs, myHashes, mPrng, chl, workers, mUseReducedRounds);
   end = clock();
   setTimePoint("RsPsiReceiver:: run-oprf");
   std::cout  << " RsPsiReceiver:: run-oprf cost " << (double)(end - start) / CLOCKS_PER_SEC << "sec." << std::endl;
-  mask = oc::ZeroBlock;
-  for (i = 0; i < mMaskSize; ++i) mask.set<u8>(i, ~0);
-
-  if (mNumThreads < 2) {
-    map.resize(myHashes.size());
-    setTimePoint("RsPsiReceiver::run-reserve");
-    map.set_empty_key(oc::ZeroBlock);
-    setTimePoint("RsPsiReceiver::run-set_empty_key");
 
-    main = mRecverSize / batchSize * batchSize;
-    start = clock();
-    if (!mCompress) {
-      for (i = 0; i < main; i += batchSize) {
-        for (u64 j = 0; j < batchSize; ++j) hh[j] = {myHashes[i + j], i + j};
-
-        map.insert(hh.begin(), hh.end());
-      }
-      for (; i < mRecverSize; ++i) map.insert({myHashes[i], i});
-    } else {
-      for (i = 0; i < main; i += batchSize) {
-        for (u64 j = 0; j < batchSize; ++j)
-          hh[j] = {myHashes[i + j] & mask, i + j};
+  // The table only compares the first mMaskSize bytes, which is what the
+  // sender sends when compressing.
+  table.init(mMaskSize, std::max<u64>(oc::divCeil(mRecverSize, kPartitionSize),
+                                      workers.size()));
 
-        map.insert(hh.begin(), hh.end());
-      }
-      for (; i < mRecverSize; ++i) map.insert({myHashes[i] & mask, i});
+  // Receiving blocks on the channel, so it runs on its own thread instead of
+  // the pool, overlapped with building the table.
+  start = clock();
+  auto recvFu = std::async(std::launch::async, [&]() {
+    if (mBatchSize)
+      stream->recvAll(chl);
+    else
+      chl->recv(theirHashes);
+  });
+
+  table.build((const u8*)myHashes.data(), myHashes.size(), sizeof(block),
+              workers);
+  setTimePoint("RsPsiReceiver::run-insert");
+
+  // Each task looks up its own slice of their hashes.
+  auto find = [&](const oc::MatrixView<u8>& hashes) {
+    if (workers.size() < 2) {
+      table.find(hashes.data(), hashes.rows(), mMaskSize, mIntersection);
+      return;
     }
 
-    setTimePoint("RsPsiReceiver::run-insert");
-
-    chl->recv(theirHashes);
-    end = clock();
-    setTimePoint("RsPsiReceiver::run-recv");
-    std::cout  << " RsPsiReceiver::run-recv cost " << (double)(end - start) / CLOCKS_PER_SEC << "sec." << std::endl;
-    {
-      block h = oc::ZeroBlock;
-      auto iter = theirHashes.data();
-      for (i = 0; i < mSenderSize; ++i) {
-        memcpy(&h, iter, mMaskSize);
-        iter += mMaskSize;
-
-        auto iter = map.find(h);
-        if (iter != map.end()) {
-          mIntersection.push_back(iter->second);
-        }
+    workers.run([&](u64 thrdIdx) {
+      auto begin = thrdIdx * hashes.rows() / workers.size();
+      auto end = (thrdIdx + 1) * hashes.rows() / workers.size();
+      std::vector<u64> intersection;
+      table.find(hashes.data() + begin * mMaskSize, end - begin, mMaskSize,
+                 intersection);
+
+      if (intersection.size()) {
+        std::lock_guard<std::mutex> lock(mergeMtx);
+        mIntersection.insert(mIntersection.end(), intersection.begin(),
+                             intersection.end());
       }
+    });
+  };
+
+  if (mBatchSize) {
+    // Look up batch k while the next batches are being received.
+    for (u64 k = 0; k < stream->numBatches(); ++k) {
+      find(stream->get(k));
+      stream->release(k);
     }
 
-    setTimePoint("RsPsiReceiver::run-find");
+    recvFu.get();
   } else {
-    mt.reset(new MultiThread);
-
-    mt->fu = mt->prom.get_future().share();
-
-    setTimePoint("RsPsiReceiver::run-reserve");
-
-    mt->numDone = 0;
-    mt->hashingDoneFu = mt->hashingDoneProm.get_future().share();
-
-    mt->numThreads = std::max<u64>(1, mNumThreads);
-    mt->binSize =
-        crypto::okvs::Baxos::getBinSize(mNumThreads, mRecverSize, mSsp);
-    mt->divider = okvs::libdivide::libdivide_u32_gen(mt->numThreads);
-
-    mt->routine = [&](u64 thrdIdx) {
-      if (!thrdIdx) setTimePoint("RsPsiReceiver::run-threadBegin");
-
-      auto& divider = mt->divider;
-      google::dense_hash_map<block, u64, NoHash> map(mt->binSize);
-      map.set_empty_key(oc::ZeroBlock);
-
-      if (!thrdIdx) setTimePoint("RsPsiReceiver::run-set_empty_key_par");
-
-      u64 i = 0;
-      std::array<std::pair<block, u64>, batchSize> hh;
-      for (; i < myHashes.size();) {
-        u64 j = 0;
-        while (j != batchSize && i < myHashes.size()) {
-          auto v = myHashes[i].get<u32>(0);
-          auto k = okvs::libdivide::libdivide_u32_do(v, &divider);
-          v -= k * mNumThreads;
-          if (v == thrdIdx) {
-            hh[j] = {myHashes[i] & mask, i};
-            ++j;
-          }
-          ++i;
-        }
-        map.insert(hh.begin(), hh.begin() + j);
-      }
-
-      if (++mt->numDone == mt->numThreads)
-        mt->hashingDoneProm.set_value();
-      else
-        mt->hashingDoneFu.get();
-
-      if (!thrdIdx) setTimePoint("RsPsiReceiver::run-insert_par");
-
-      mt->fu.get();
-      if (!thrdIdx) setTimePoint("RsPsiReceiver::run-recv_par");
-
-      auto begin = thrdIdx * myHashes.size() / mNumThreads;
-      u64 intersectionSize = 0;
-      u64* intersection = (u64*)&myHashes[begin];
-
-      {
-        block h = oc::ZeroBlock;
-        auto iter = theirHashes.data();
-        for (i = 0; i < mSenderSize; ++i) {
-          memcpy(&h, iter, mMaskSize);
-          iter += mMaskSize;
-
-          auto v = h.get<u32>(0);
-          auto k = okvs::libdivide::libdivide_u32_do(v, &divider);
-          v -= k * mNumThreads;
-          if (v == thrdIdx) {
-            auto iter = map.find(h);
-            if (iter != map.end()) {
-              intersection[intersectionSize] = iter->second;
-              ++intersectionSize;
-            }
-          }
-        }
-      }
-
-      if (!thrdIdx) setTimePoint("RsPsiReceiver::run-find_par");
-      if (intersectionSize) {
-        std::lock_guard<std::mutex> lock(mt->mMergeMtx);
-        mIntersection.insert(mIntersection.end(), intersection,
-                             intersection + intersectionSize);
-      }
-    };
+    recvFu.get();
+    setTimePoint("RsPsiReceiver::run-recv");
 
-    mt->thrds.resize(mt->numThreads);
-    for (i = 0; i < mt->thrds.size(); ++i)
-      mt->thrds[i] = std::thread(mt->routine, i);
-    chl->recv(theirHashes);
-    mt->prom.set_value();
+    find(theirHashes);
+  }
 
-    for (i = 0; i < mt->thrds.size(); ++i) mt->thrds[i].join();
+  end = clock();
+  setTimePoint("RsPsiReceiver::run-find");
+  std::cout  << " RsPsiReceiver::run-recvFind cost " << (double)(end - start) / CLOCKS_PER_SEC << "sec." << std::endl;
+}
 
-    setTimePoint("RsPsiReceiver::run-done");
-  }
+void RsPsiReceiver::run(span<block> inputs,
+                        const std::shared_ptr<network::CryptoChannel>& chl) {
+  run(inputs, network::makeLinkChannel(chl, chl->getTag()));
 }
 
-}  // namespace primihub::crypto
\ No newline at end of file
+}  // namespace primihub::crypto
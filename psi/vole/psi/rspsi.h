@@ -19,11 +19,14 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#include <functional>
+
 #include "cryptoTools/Common/Timer.h"
 #include "psi/okvs/defines.h"
 #include "psi/okvs/libdivide.h"
 #include "psi/vole/oprf/rsoprf.h"
-#include "sparsehash/dense_hash_map.h"
+#include "psi/vole/psi/hashtable.h"
+#include "tools/link_channel.h"
 
 namespace primihub::crypto {
 namespace details {
@@ -39,6 +42,19 @@ struct RsPsiBase {
   bool mUseReducedRounds = false;
   bool mDebug = false;
 
+  // If not zero, the sender evaluates and sends its hashes mBatchSize at a
+  // time and the receiver looks up each batch as it arrives, so that eval,
+  // network and lookup overlap. Both parties must use the same value.
+  u64 mBatchSize = 0;
+
+  // If set, the parallel phases may use every worker of this pool.
+  // Otherwise they use at most mNumThreads threads of the global pool.
+  ThreadPool* mPool = nullptr;
+
+  Workers workers() const {
+    return mPool ? Workers(*mPool) : Workers(mNumThreads);
+  }
+
   void init(u64 senderSize, u64 recverSize, u64 statSecParam, block seed,
             bool malicious, u64 numThreads, bool useReducedRounds = false);
 };
@@ -49,7 +65,28 @@ class RsPsiSender : public details::RsPsiBase, public oc::TimerAdapter {
   RsOprfSender mSender;
   void setMultType(MultType type) { mSender.setMultType(type); };
 
+  // Both parties must use the same type, see RsOprfSender::mDenseType.
+  void setDenseType(okvs::PaxosParam::DenseType type) {
+    mSender.mDenseType = type;
+  }
+
+  // The RS-OPRF key comes from the VOLE with each receiver, so the whole
+  // sender set is evaluated and sent again for every receiver. Nothing of
+  // the evaluation can be reused across receivers.
   void run(span<block> inputs, const std::shared_ptr<Channel>& chl);
+
+  // Run over a socket channel, such as the channel of a SessionServer
+  // session. The peer must run over a socket channel of the same tag.
+  // The hashes are sent with CryptoChannel::asyncSendStrided, so they are
+  // not compacted in place first.
+  void run(span<block> inputs,
+           const std::shared_ptr<network::CryptoChannel>& chl);
+
+ private:
+  // Run with sendHashes(hashes) sending the low mMaskSize bytes of each hash
+  // as one message.
+  void run(span<block> inputs, const std::shared_ptr<Channel>& chl,
+           const std::function<void(span<block>)>& sendHashes);
 };
 
 class RsPsiReceiver : public details::RsPsiBase, public oc::TimerAdapter {
@@ -57,8 +94,18 @@ class RsPsiReceiver : public details::RsPsiBase, public oc::TimerAdapter {
   RsOprfReceiver mRecver;
   void setMultType(MultType type) { mRecver.setMultType(type); };
 
+  // Both parties must use the same type, see RsOprfSender::mDenseType.
+  void setDenseType(okvs::PaxosParam::DenseType type) {
+    mRecver.mDenseType = type;
+  }
+
   std::vector<u64> mIntersection;
 
   void run(span<block> inputs, const std::shared_ptr<Channel>& chl);
+
+  // Run over a socket channel, such as the channel of a SessionServer
+  // session. The peer must run over a socket channel of the same tag.
+  void run(span<block> inputs,
+           const std::shared_ptr<network::CryptoChannel>& chl);
 };
 }  // namespace primihub::crypto
\ No newline at end of file
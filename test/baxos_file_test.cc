@@ -0,0 +1,78 @@
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "cryptoTools/Crypto/PRNG.h"
+#include "psi/okvs/baxosfile.h"
+
+using osuCrypto::block;
+using osuCrypto::PRNG;
+using osuCrypto::u64;
+using primihub::crypto::okvs::Baxos;
+using primihub::crypto::okvs::BaxosFile;
+using primihub::crypto::okvs::PaxosParam;
+
+namespace {
+std::string tempPath() {
+  return "/tmp/baxos_file_test_" + std::to_string(getpid());
+}
+}  // namespace
+
+TEST(BaxosFileTest, SaveOpenDecode) {
+  u64 n = 1 << 14;
+  PRNG prng(block(1, 2));
+  std::vector<block> items(n), values(n);
+  prng.get(items.data(), n);
+  prng.get(values.data(), n);
+
+  Baxos paxos;
+  paxos.init(n, 1 << 10, 3, 40, PaxosParam::GF128, block(3, 4));
+  std::vector<block> p(paxos.size());
+  paxos.solve<block>(items, values, p, &prng, 2);
+
+  auto path = tempPath();
+  BaxosFile::save<block>(path, paxos, p);
+
+  {
+    BaxosFile file;
+    file.open(path);
+    EXPECT_EQ(file.paxos().size(), paxos.size());
+    EXPECT_EQ(file.paxos().mSeed, paxos.mSeed);
+
+    std::vector<block> out(n);
+    file.decode<block>(items, osuCrypto::span<block>(out), 2);
+    for (u64 i = 0; i < n; ++i) ASSERT_EQ(out[i], values[i]) << i;
+
+    // the same file, viewed as two 8 byte columns.
+    osuCrypto::MatrixView<u64> out2((u64 *)out.data(), n, 2);
+    std::fill(out.begin(), out.end(), block(0, 0));
+    file.decode<u64>(items, out2);
+    for (u64 i = 0; i < n; ++i) ASSERT_EQ(out[i], values[i]) << i;
+
+    std::vector<u64> narrow(n);
+    EXPECT_ANY_THROW(
+        file.decode<u64>(items, osuCrypto::span<u64>(narrow)));
+  }
+
+  std::remove(path.c_str());
+}
+
+TEST(BaxosFileTest, RejectBadFile) {
+  auto path = tempPath();
+  {
+    std::ofstream out(path, std::ios::binary);
+    std::vector<char> junk(8192, 7);
+    out.write(junk.data(), junk.size());
+  }
+
+  BaxosFile file;
+  EXPECT_ANY_THROW(file.open(path));
+  EXPECT_FALSE(file.isOpen());
+  EXPECT_ANY_THROW(file.open(path + ".missing"));
+
+  std::remove(path.c_str());
+}
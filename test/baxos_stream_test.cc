@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "cryptoTools/Crypto/PRNG.h"
+#include "psi/okvs/baxosstream.h"
+
+using osuCrypto::block;
+using osuCrypto::MatrixView;
+using osuCrypto::PRNG;
+using osuCrypto::span;
+using osuCrypto::u64;
+using osuCrypto::u8;
+using primihub::crypto::okvs::Baxos;
+using primihub::crypto::okvs::BaxosStream;
+using primihub::crypto::okvs::PaxosParam;
+
+namespace {
+// Push n items of m bytes in uneven batches, emit the bins and check that
+// every item decodes to its value.
+void streamTest(u64 n, u64 m, PaxosParam::DenseType dt) {
+  PRNG prng(block(n, m));
+  std::vector<block> items(n);
+  std::vector<u8> values(n * m);
+  prng.get(items.data(), n);
+  prng.get(values.data(), values.size());
+
+  Baxos paxos;
+  paxos.init(n, 1 << 10, 3, 40, dt, block(5, 6));
+
+  BaxosStream stream;
+  stream.init(paxos, m);
+  for (u64 begin = 0; begin < n;) {
+    auto size = std::min<u64>(n - begin, 1000 + begin % 77);
+    stream.push(span<const block>(items.data() + begin, size),
+                MatrixView<const u8>(values.data() + begin * m, size, m));
+    begin += size;
+  }
+  EXPECT_EQ(stream.size(), n);
+
+  auto sizePer = paxos.size() / paxos.mNumBins;
+  std::vector<u8> p(paxos.size() * m);
+  u64 nextBin = 0;
+  stream.finalize(&prng, 3, [&](u64 binIdx, MatrixView<const u8> bin) {
+    EXPECT_EQ(binIdx, nextBin++);
+    EXPECT_EQ(bin.rows(), sizePer);
+    std::copy(bin.data(), bin.data() + bin.size(),
+              p.data() + binIdx * sizePer * m);
+  });
+  EXPECT_EQ(nextBin, paxos.mNumBins);
+
+  std::vector<u8> out(n * m);
+  paxos.decode<u8>(items, MatrixView<u8>(out.data(), n, m),
+                   MatrixView<const u8>(p.data(), paxos.size(), m), 2);
+  EXPECT_TRUE(out == values);
+}
+}  // namespace
+
+TEST(BaxosStreamTest, Block) { streamTest(1 << 13, 16, PaxosParam::GF128); }
+
+TEST(BaxosStreamTest, Bytes) { streamTest(10000, 5, PaxosParam::Binary); }
+
+TEST(BaxosStreamTest, Wide) { streamTest(5000, 48, PaxosParam::GF128); }
+
+TEST(BaxosStreamTest, Output) {
+  u64 n = 4000;
+  PRNG prng(block(7, 8));
+  std::vector<block> items(n), values(n);
+  prng.get(items.data(), n);
+  prng.get(values.data(), n);
+
+  Baxos paxos;
+  paxos.init(n, 1 << 9, 3, 40, PaxosParam::GF128, block(9, 10));
+
+  BaxosStream stream;
+  stream.init(paxos, sizeof(block));
+  stream.push<block>(items, values);
+  EXPECT_ANY_THROW(stream.push<block>(items, values));
+
+  std::vector<block> p(paxos.size());
+  stream.finalize(MatrixView<u8>((u8 *)p.data(), p.size(), sizeof(block)),
+                  nullptr, 1);
+
+  std::vector<block> out(n);
+  paxos.decode<block>(items, out, p);
+  for (u64 i = 0; i < n; ++i) ASSERT_EQ(out[i], values[i]) << i;
+}
@@ -0,0 +1,66 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "cryptoTools/Crypto/PRNG.h"
+#include "psi/ot/tools/gf128.h"
+
+using osuCrypto::block;
+using osuCrypto::PRNG;
+using osuCrypto::u64;
+namespace pc = primihub::crypto;
+
+namespace {
+// odd sizes exercise the tails of both kernels.
+const u64 kSizes[] = {0, 1, 3, 4, 5, 7, 8, 9, 15, 16, 17, 1001};
+
+void checkKernel(void (*kernel)(block, pc::span<const block>,
+                                pc::span<block>, bool)) {
+  PRNG prng(block(1, 2));
+  for (auto n : kSizes) {
+    auto d = prng.get<block>();
+    std::vector<block> in(n), out(n), acc(n), expMul(n), expXor(n);
+    prng.get(in.data(), n);
+    prng.get(acc.data(), n);
+    for (u64 i = 0; i < n; ++i) {
+      expMul[i] = d.gf128Mul(in[i]);
+      expXor[i] = acc[i] ^ expMul[i];
+    }
+
+    kernel(d, in, out, false);
+    EXPECT_EQ(out, expMul) << n;
+
+    kernel(d, in, acc, true);
+    EXPECT_EQ(acc, expXor) << n;
+
+    // in place.
+    kernel(d, in, in, false);
+    EXPECT_EQ(in, expMul) << n;
+  }
+}
+}  // namespace
+
+TEST(Gf128Test, MulConstPclmul) { checkKernel(&pc::gf128MulConstPclmul); }
+
+TEST(Gf128Test, MulConstVpclmul) {
+  if (!pc::gf128HasVpclmul()) GTEST_SKIP() << "no VPCLMULQDQ";
+  checkKernel(&pc::gf128MulConstVpclmul);
+}
+
+TEST(Gf128Test, MulConstDispatch) {
+  PRNG prng(block(3, 4));
+  u64 n = 1 << 12;
+  auto d = prng.get<block>();
+  std::vector<block> in(n), out(n), acc(n, block(5, 6));
+  prng.get(in.data(), n);
+
+  pc::gf128MulConst(d, in, out);
+  pc::gf128MulConstXor(d, in, acc);
+  for (u64 i = 0; i < n; ++i) {
+    EXPECT_EQ(out[i], d.gf128Mul(in[i]));
+    EXPECT_EQ(acc[i], block(5, 6) ^ out[i]);
+  }
+
+  std::vector<block> shortOut(n - 1);
+  EXPECT_ANY_THROW(pc::gf128MulConst(d, in, shortOut));
+}
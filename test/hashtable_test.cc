@@ -0,0 +1,112 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "psi/vole/psi/hashtable.h"
+
+using primihub::crypto::PartitionedHashTable;
+using primihub::crypto::Workers;
+using primihub::crypto::u64;
+using primihub::crypto::u8;
+
+namespace {
+// Keys are built from 16-byte rows like the OPRF outputs, only their low
+// maskSize bytes count, and looked up packed like the received hashes.
+constexpr u64 kStride = 16;
+
+std::string lowBytes(const u8 *key, u64 maskSize) {
+  return std::string(reinterpret_cast<const char *>(key), maskSize);
+}
+
+// Build numKeys distinct keys into numPartitions partitions, then look up
+// every key and numAbsent others, checking against std::unordered_map.
+void check(u64 maskSize, u64 numKeys, u64 numAbsent, u64 numPartitions,
+           u64 numThreads) {
+  std::mt19937_64 engine(maskSize * 1000003 + numKeys + numPartitions);
+  auto randomRow = [&](u8 *row) {
+    for (u64 j = 0; j < kStride; ++j) row[j] = engine();
+  };
+
+  std::unordered_map<std::string, u64> ref;
+  std::vector<u8> rows(numKeys * kStride);
+  for (u64 i = 0; i < numKeys; ++i) {
+    do {
+      randomRow(&rows[i * kStride]);
+    } while (!ref.emplace(lowBytes(&rows[i * kStride], maskSize), i).second);
+  }
+
+  // Present keys in a shuffled order, absent ones mixed in.
+  std::vector<u8> row(kStride);
+  std::vector<std::string> queries;
+  for (u64 i = 0; i < numKeys; ++i)
+    queries.push_back(lowBytes(&rows[i * kStride], maskSize));
+  for (u64 i = 0; i < numAbsent; ++i) {
+    do {
+      randomRow(row.data());
+    } while (ref.count(lowBytes(row.data(), maskSize)));
+    queries.push_back(lowBytes(row.data(), maskSize));
+  }
+  std::shuffle(queries.begin(), queries.end(), engine);
+
+  std::string packed;
+  std::vector<u64> exp;
+  for (auto &q : queries) {
+    packed += q;
+    auto iter = ref.find(q);
+    if (iter != ref.end()) exp.push_back(iter->second);
+  }
+
+  PartitionedHashTable table;
+  table.init(maskSize, numPartitions);
+  table.build(rows.data(), numKeys, kStride, Workers(numThreads));
+  EXPECT_EQ(table.numPartitions(), std::max<u64>(1, numPartitions));
+
+  std::vector<u64> matches;
+  table.find(reinterpret_cast<const u8 *>(packed.data()), queries.size(),
+             maskSize, matches);
+  EXPECT_EQ(matches, exp) << "maskSize " << maskSize << ", keys " << numKeys
+                          << ", partitions " << numPartitions << ", threads "
+                          << numThreads;
+}
+}  // namespace
+
+// Every value of a one-byte key, so absent keys differ from present ones
+// in one byte and most share their tag with some present key.
+TEST(PartitionedHashTableTest, MaskSize1) {
+  for (u64 threads : {1, 3}) {
+    check(1, 200, 56, 1, threads);
+    check(1, 200, 56, 8, threads);
+  }
+}
+
+// 896 keys in one partition fill its 64 groups to the 7/8 load limit, so
+// close to half of the groups are full and their keys probe into the next
+// group. The absent keys hit tags of present keys in about one of ten
+// lookups, which must fall through to the key compare.
+TEST(PartitionedHashTableTest, FullGroups) {
+  for (u64 maskSize : {5, 8, 9, 16}) check(maskSize, 896, 20000, 1, 1);
+}
+
+TEST(PartitionedHashTableTest, MaskSizes) {
+  for (u64 maskSize : {5, 8, 9, 16}) {
+    for (u64 threads : {1, 3}) {
+      check(maskSize, 100000, 100000, 1, threads);
+      check(maskSize, 100000, 100000, 16, threads);
+    }
+  }
+}
+
+// More partitions than keys leaves some of them empty.
+TEST(PartitionedHashTableTest, EmptyPartitions) {
+  for (u64 maskSize : {5, 16}) check(maskSize, 500, 500, 1024, 3);
+}
+
+TEST(PartitionedHashTableTest, BadMaskSize) {
+  PartitionedHashTable table;
+  EXPECT_ANY_THROW(table.init(0, 1));
+  EXPECT_ANY_THROW(table.init(17, 1));
+}
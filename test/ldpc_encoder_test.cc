@@ -0,0 +1,80 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "cryptoTools/Crypto/PRNG.h"
+#include "psi/ot/tools/ldpc/ldpcencoder.h"
+
+using osuCrypto::block;
+using osuCrypto::PRNG;
+using osuCrypto::u64;
+using osuCrypto::u8;
+namespace pc = primihub::crypto;
+
+namespace {
+// The parties may split the encoding over different numbers of workers, so
+// the split encoding must give exactly the serial one. The rows are large
+// enough to be split, but not a multiple of the band period or of the
+// chunks the right encoder cuts them into.
+const u64 kRows[] = {(1 << 15) + 1, 3 * (1 << 14) + 17, 100003};
+const u64 kWorkers[] = {1, 2, 3, 16};
+
+void checkDualEncode(pc::SilverCode code) {
+  PRNG prng(block(code.weight(), 1));
+  for (auto rows : kRows) {
+    pc::SilverEncoder enc;
+    enc.init(rows, code);
+
+    std::vector<block> c(enc.cols());
+    prng.get(c.data(), c.size());
+    auto exp = c;
+    enc.dualEncode<block>(exp);
+
+    for (auto w : kWorkers) {
+      auto got = c;
+      enc.dualEncode<block>(got, pc::Workers(w));
+      EXPECT_TRUE(got == exp) << "rows " << rows << ", workers " << w;
+    }
+  }
+}
+
+void checkDualEncode2(pc::SilverCode code) {
+  PRNG prng(block(code.weight(), 2));
+  for (auto rows : kRows) {
+    pc::SilverEncoder enc;
+    enc.init(rows, code);
+
+    std::vector<block> c0(enc.cols());
+    std::vector<u8> c1(enc.cols());
+    prng.get(c0.data(), c0.size());
+    prng.get(c1.data(), c1.size());
+    auto exp0 = c0;
+    auto exp1 = c1;
+    enc.dualEncode2<block, u8>(exp0, exp1);
+
+    for (auto w : kWorkers) {
+      auto got0 = c0;
+      auto got1 = c1;
+      enc.dualEncode2<block, u8>(got0, got1, pc::Workers(w));
+      EXPECT_TRUE(got0 == exp0) << "rows " << rows << ", workers " << w;
+      EXPECT_TRUE(got1 == exp1) << "rows " << rows << ", workers " << w;
+    }
+  }
+}
+}  // namespace
+
+TEST(LdpcEncoderTest, Silver5DualEncodeWorkers) {
+  checkDualEncode(pc::SilverCode::Weight5);
+}
+
+TEST(LdpcEncoderTest, Silver11DualEncodeWorkers) {
+  checkDualEncode(pc::SilverCode::Weight11);
+}
+
+TEST(LdpcEncoderTest, Silver5DualEncode2Workers) {
+  checkDualEncode2(pc::SilverCode::Weight5);
+}
+
+TEST(LdpcEncoderTest, Silver11DualEncode2Workers) {
+  checkDualEncode2(pc::SilverCode::Weight11);
+}
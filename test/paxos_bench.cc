@@ -0,0 +1,111 @@
+// Size, solve and decode throughput of Baxos with binary and GF128 dense
+// columns, so that the dense type of RsOprf and RsOpprf can be picked per
+// workload.
+//
+//   bazel run //test:bench_paxos -- --sizes=1048576,16777216 --threads=4
+//
+// Binary adds ssp dense columns to each bin, GF128 solves and decodes them
+// with gf128 multiplications. The encoding size is reported relative to the
+// number of items.
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "cryptoTools/Crypto/PRNG.h"
+#include "psi/okvs/paxos.h"
+
+DEFINE_string(sizes, "65536,1048576,16777216",
+              "Comma separated numbers of items.");
+DEFINE_uint64(bin_size, 1 << 14, "Items per Baxos bin.");
+DEFINE_uint64(ssp, 40, "Statistical security parameter.");
+DEFINE_uint64(threads, 1, "Threads used by solve and decode.");
+DEFINE_uint64(reps, 3, "Repetitions of each setting, the best is reported.");
+DEFINE_bool(randomized, true, "Solve with a PRNG, as RsOprf does.");
+
+using osuCrypto::block;
+using osuCrypto::PRNG;
+using primihub::crypto::okvs::Baxos;
+using primihub::crypto::okvs::PaxosParam;
+
+namespace {
+std::vector<std::string> split(const std::string &str) {
+  std::vector<std::string> items;
+  std::stringstream ss(str);
+  std::string item;
+  while (std::getline(ss, item, ','))
+    if (!item.empty()) items.push_back(item);
+  return items;
+}
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+}  // namespace
+
+int main(int argc, char **argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+
+  if (FLAGS_bin_size == 0 || FLAGS_reps == 0) {
+    LOG(ERROR) << "Bin size and reps should be positive.";
+    return 1;
+  }
+
+  std::cout << std::left << std::setw(8) << "dense" << std::setw(11)
+            << "items" << std::setw(8) << "dense" << std::setw(10)
+            << "size/n" << std::setw(14) << "solve(M/s)" << "decode(M/s)"
+            << std::endl;
+
+  for (const auto &item : split(FLAGS_sizes)) {
+    uint64_t n = std::stoull(item);
+    PRNG prng(block(n, 0));
+    std::vector<block> items(n), values(n), out(n);
+    prng.get(items.data(), n);
+    prng.get(values.data(), n);
+
+    for (auto dt : {PaxosParam::Binary, PaxosParam::GF128}) {
+      Baxos paxos;
+      paxos.init(n, FLAGS_bin_size, 3, FLAGS_ssp, dt, block(1, 1));
+      std::vector<block> p(paxos.size());
+
+      double solve = 0, decode = 0;
+      for (uint64_t r = 0; r < FLAGS_reps; ++r) {
+        auto start = std::chrono::steady_clock::now();
+        paxos.solve<block>(items, values, p,
+                           FLAGS_randomized ? &prng : nullptr, FLAGS_threads);
+        auto s = secondsSince(start);
+
+        start = std::chrono::steady_clock::now();
+        paxos.decode<block>(items, out, p, FLAGS_threads);
+        auto d = secondsSince(start);
+
+        if (out != values) {
+          LOG(ERROR) << "Decode mismatch for " << n << " items.";
+          return 1;
+        }
+
+        solve = r ? std::min(solve, s) : s;
+        decode = r ? std::min(decode, d) : d;
+      }
+
+      std::cout << std::left << std::fixed << std::setw(8)
+                << (dt == PaxosParam::Binary ? "binary" : "gf128")
+                << std::setw(11) << n << std::setw(8)
+                << paxos.mPaxosParam.mDenseSize << std::setprecision(3)
+                << std::setw(10) << double(paxos.size()) / n
+                << std::setprecision(2) << std::setw(14) << n / solve / 1e6
+                << n / decode / 1e6 << std::endl;
+    }
+  }
+
+  return 0;
+}
@@ -82,6 +82,92 @@ TEST(RsOprfTest, RsOprfEval) {
   if (count) throw RTE_LOC;
 }
 
+// Small bins so that eval takes the bin sorted, multi threaded decode, and
+// the single item eval takes the unsorted one.
+TEST(RsOprfTest, RsOprfSortedDecode) {
+  RsOprfSender sender;
+  RsOprfReceiver recver;
+  sender.mBinSize = 1 << 8;
+  recver.mBinSize = 1 << 8;
+
+  u64 n = 1 << 14;
+  PRNG prng0(block(0, 0));
+  PRNG prng1(block(0, 1));
+
+  std::vector<block> vals(n), recvOut(n);
+
+  prng0.get(vals.data(), n);
+
+  std::shared_ptr<MemoryChannel> channel_impl1 =
+      std::make_shared<MemoryChannel>(ChannelRole::CLIENT);
+  std::shared_ptr<Channel> channel1 =
+      std::make_shared<Channel>(channel_impl1, "RsOprfSortedDecode");
+
+  std::shared_ptr<MemoryChannel> channel_impl2 =
+      std::make_shared<MemoryChannel>(ChannelRole::SERVER);
+  std::shared_ptr<Channel> channel2 =
+      std::make_shared<Channel>(channel_impl2, "RsOprfSortedDecode");
+
+  auto p0_task =
+      std::async([&]() { sender.send(n, prng0, channel1, 4); });
+  auto p1_task =
+      std::async([&]() { recver.receive(vals, recvOut, prng1, channel2, 4); });
+
+  p0_task.get();
+  p1_task.get();
+
+  std::vector<block> vv(n);
+  sender.eval(vals, vv, 4);
+  EXPECT_EQ(sender.mPaxos.mDecodeStats.mItems, n);
+
+  for (u64 i = 0; i < n; ++i) {
+    ASSERT_EQ(recvOut[i], vv[i]) << i;
+    if (i % 97 == 0) ASSERT_EQ(sender.eval(vals[i]), vv[i]) << i;
+  }
+}
+
+TEST(RsOprfTest, RsOprfBinaryDense) {
+  RsOprfSender sender;
+  RsOprfReceiver recver;
+  sender.mDenseType = PaxosParam::Binary;
+  recver.mDenseType = PaxosParam::Binary;
+  sender.mBinSize = 1 << 10;
+  recver.mBinSize = 1 << 10;
+
+  u64 n = 4000;
+  PRNG prng0(block(0, 0));
+  PRNG prng1(block(0, 1));
+
+  std::vector<block> vals(n), recvOut(n);
+
+  prng0.get(vals.data(), n);
+
+  std::shared_ptr<MemoryChannel> channel_impl1 =
+      std::make_shared<MemoryChannel>(ChannelRole::CLIENT);
+  std::shared_ptr<Channel> channel1 =
+      std::make_shared<Channel>(channel_impl1, "RsOprfBinaryDense");
+
+  std::shared_ptr<MemoryChannel> channel_impl2 =
+      std::make_shared<MemoryChannel>(ChannelRole::SERVER);
+  std::shared_ptr<Channel> channel2 =
+      std::make_shared<Channel>(channel_impl2, "RsOprfBinaryDense");
+
+  auto p0_task = std::async([&]() { sender.send(n, prng0, channel1, 2); });
+  auto p1_task =
+      std::async([&]() { recver.receive(vals, recvOut, prng1, channel2, 2); });
+
+  p0_task.get();
+  p1_task.get();
+
+  std::vector<block> vv(n);
+  sender.eval(vals, vv, 2);
+
+  for (u64 i = 0; i < n; ++i) {
+    ASSERT_EQ(recvOut[i], vv[i]) << i;
+    if (i % 97 == 0) ASSERT_EQ(sender.eval(vals[i]), vv[i]) << i;
+  }
+}
+
 // void RsOprf_mal_test() {
 TEST(RsOprfTest, RsOprfMal) {
   using Channel = primihub::link::Channel;
@@ -4,6 +4,7 @@
 #include <gtest/gtest.h> 
 #include <time.h>
 #include <iostream>
+#include <thread>
 
 #include "psi/vole/psi/rspsi.h"
 // #include "volePSI/RsCpsi.h"
@@ -11,6 +12,7 @@
 #include "cryptoTools/Network/IOService.h"
 #include "cryptoTools/Network/Session.h"
 #include "network/mem_channel.h"
+#include "tools/socket.h"
 
 using primihub::link::Channel;
 using primihub::link::MemoryChannel;
@@ -21,12 +23,17 @@ namespace primihub::crypto {
 
 std::vector<u64> run(PRNG& prng, std::vector<block>& recvSet,
                      std::vector<block>& sendSet, bool mal,
-                     std::string taskname, u64 nt = 1, bool reduced = false) {
+                     std::string taskname, u64 nt = 1, bool reduced = false,
+                     u64 batchSize = 0, ThreadPool* pool = nullptr) {
   RsPsiReceiver recver;
   RsPsiSender sender;
 
   recver.init(sendSet.size(), recvSet.size(), 40, prng.get(), mal, nt, reduced);
   sender.init(sendSet.size(), recvSet.size(), 40, prng.get(), mal, nt, reduced);
+  recver.mBatchSize = batchSize;
+  sender.mBatchSize = batchSize;
+  recver.mPool = pool;
+  sender.mPool = pool;
 
   std::shared_ptr<MemoryChannel> channel_impl1 =
       std::make_shared<MemoryChannel>(ChannelRole::CLIENT);
@@ -154,6 +161,107 @@ TEST(RsPsiTest, MultiThrdTest) {
   if (act != exp) throw RTE_LOC;
 }
 
+TEST(RsPsiTest, StreamTest) {
+  std::string taskname = "StreamTest";
+  u64 n = 1000000;
+  std::vector<block> recvSet(n), sendSet(n);
+  PRNG prng(ZeroBlock);
+  prng.get(recvSet.data(), recvSet.size());
+  prng.get(sendSet.data(), sendSet.size());
+
+  std::set<u64> exp;
+  for (u64 i = 0; i < n; ++i) {
+    if (prng.getBit()) {
+      recvSet[i] = sendSet[(i + 312) % n];
+      exp.insert(i);
+    }
+  }
+
+  // Last batch is partial.
+  for (u64 nt : {1, 8}) {
+    auto inter = run(prng, recvSet, sendSet, false, taskname, nt, false, 30000);
+    std::set<u64> act(inter.begin(), inter.end());
+    if (act != exp) throw RTE_LOC;
+  }
+}
+
+TEST(RsPsiTest, ThreadPoolTest) {
+  std::string taskname = "ThreadPoolTest";
+  u64 n = 1000000;
+  std::vector<block> recvSet(n), sendSet(n);
+  PRNG prng(ZeroBlock);
+  prng.get(recvSet.data(), recvSet.size());
+  sendSet = recvSet;
+
+  std::set<u64> exp;
+  for (u64 i = 0; i < n; ++i) exp.insert(i);
+
+  // Both parties share a pool smaller than their combined task count.
+  ThreadPool pool(4);
+  for (u64 batchSize : {0, 30000}) {
+    auto inter = run(prng, recvSet, sendSet, false, taskname, 1, false,
+                     batchSize, &pool);
+    std::set<u64> act(inter.begin(), inter.end());
+    if (act != exp) throw RTE_LOC;
+  }
+}
+
+// Several receivers query one sender set over one port, each in its own
+// SessionServer session, while the batched ones stream their hashes.
+TEST(RsPsiTest, SessionServerTest) {
+  u64 ns = 200000, nr = 20000;
+  std::vector<block> sendSet(ns);
+  PRNG prng(ZeroBlock);
+  prng.get(sendSet.data(), sendSet.size());
+
+  network::SessionOptions options;
+  options.max_sessions = 2;
+  network::SessionServer server("127.0.0.1", 35070, options);
+  auto handler = [&](const std::string& tag,
+                     std::shared_ptr<network::CryptoChannel> chl) {
+    RsPsiSender sender;
+    sender.init(ns, nr, 40, block(ns, tag.size()), false, 2);
+    sender.mBatchSize = tag.back() == '1' ? 7000 : 0;
+    sender.run(sendSet, chl);
+    return Status::OK();
+  };
+  if (!server.start(handler).IsOK()) throw RTE_LOC;
+
+  auto client = [&](u64 idx) {
+    PRNG prng(block(idx, 1));
+    std::vector<block> recvSet(nr);
+    prng.get(recvSet.data(), recvSet.size());
+
+    std::set<u64> exp;
+    for (u64 i = 0; i < nr; ++i) {
+      if (prng.getBit()) {
+        recvSet[i] = sendSet[prng.get<u64>() % ns];
+        exp.insert(i);
+      }
+    }
+
+    std::string tag = "rspsi_session_" + std::to_string(idx);
+    auto chl =
+        std::make_shared<network::ClientChannel>("127.0.0.1", 35070, tag);
+    EXPECT_TRUE(chl->initChannel().IsOK());
+
+    RsPsiReceiver recver;
+    recver.init(ns, nr, 40, prng.get(), false, 2);
+    recver.mBatchSize = tag.back() == '1' ? 7000 : 0;
+    recver.run(recvSet, chl);
+
+    std::set<u64> act(recver.mIntersection.begin(),
+                      recver.mIntersection.end());
+    EXPECT_TRUE(act == exp) << tag;
+  };
+
+  std::vector<std::thread> clients;
+  for (u64 i = 0; i < 3; ++i) clients.emplace_back(client, i);
+  for (auto& thrd : clients) thrd.join();
+
+  server.stop();
+}
+
 TEST(RsPsiTest, MalTest) {
   std::string taskname = "MalTest";
   // u64 n = cmd.getOr("n", 13243);
@@ -224,6 +224,76 @@ TEST(silentot, silver_test) {
   }
 }
 
+TEST(silentot, exacc_test) {
+  using Channel = primihub::link::Channel;
+
+  std::shared_ptr<MemoryChannel> channel_impl1 =
+      std::make_shared<MemoryChannel>(ChannelRole::CLIENT);
+  std::shared_ptr<Channel> channel1 =
+      std::make_shared<Channel>(channel_impl1, "exacc_test");
+
+  std::shared_ptr<MemoryChannel> channel_impl2 =
+      std::make_shared<MemoryChannel>(ChannelRole::SERVER);
+  std::shared_ptr<Channel> channel2 =
+      std::make_shared<Channel>(channel_impl2, "exacc_test");
+
+  bool verbose = false;
+  u64 n = 1234;
+  u64 threads = 4;
+  u64 s = 2;
+
+  PRNG prng(toBlock(static_cast<uint64_t>(0)));
+  block delta = prng.get();
+
+  for (auto mult : {MultType::ExAcc7, MultType::ExAcc11, MultType::ExAcc21,
+                    MultType::ExAcc40}) {
+    SilentOtExtSender sender;
+    SilentOtExtReceiver recver;
+
+    sender.mMultType = mult;
+    recver.mMultType = mult;
+
+    std::vector<std::array<block, 2>> msg2(n);
+    std::vector<block> msg1(n);
+    BitVector choice(n);
+
+    fakeBase(n, s, threads, prng, recver, sender);
+    auto send_fn = [&sender, &msg2, &prng, channel1]() {
+      sender.silentSend(msg2, prng, channel1);
+    };
+
+    auto recv_fn = [&recver, &choice, &msg1, &prng, channel2]() {
+      recver.silentReceive(choice, msg1, prng, channel2);
+    };
+
+    auto send_fut = std::async(send_fn);
+    auto recv_fut = std::async(recv_fn);
+    send_fut.get();
+    recv_fut.get();
+
+    checkRandom(msg1, msg2, choice, n, verbose);
+
+    for (auto type : {ChoiceBitPacking::False, ChoiceBitPacking::True}) {
+      fakeBase(n, s, threads, prng, recver, sender);
+      auto send_fn2 = [&sender, &delta, n, &prng, channel1]() {
+        sender.silentSendInplace(delta, n, prng, channel1);
+      };
+
+      auto recv_fn2 = [&recver, n, &prng, channel2, type]() {
+        recver.silentReceiveInplace(n, prng, channel2, type);
+      };
+
+      auto send_fut2 = std::async(send_fn2);
+      auto recv_fut2 = std::async(recv_fn2);
+      send_fut2.get();
+      recv_fut2.get();
+
+      checkCorrelated(recver.mA, sender.mB, recver.mC, delta, n, verbose,
+                      type);
+    }
+  }
+}
+
 TEST(silentot, baseot_test) {
   using Channel = primihub::link::Channel;
   primihub::crypto::gSilverWarning = false;
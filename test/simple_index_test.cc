@@ -0,0 +1,70 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "cryptoTools/Common/CuckooIndex.h"
+#include "cryptoTools/Crypto/AES.h"
+#include "cryptoTools/Crypto/PRNG.h"
+#include "psi/okvs/simpleindex.h"
+
+using osuCrypto::block;
+using osuCrypto::PRNG;
+using osuCrypto::u64;
+using primihub::crypto::okvs::SimpleIndex;
+
+namespace {
+// Serial simple hashing with CuckooIndex::getHash, items in input order and
+// then hash function order within each bin.
+void checkIndex(const SimpleIndex &idx, const std::vector<block> &items,
+                block seed) {
+  oc::AES hasher(seed);
+  std::vector<u64> binSizes(idx.mNumBins);
+  for (u64 i = 0; i < items.size(); ++i) {
+    auto hash = hasher.ecbEncBlock(items[i]) ^ items[i];
+    std::vector<u64> bIdxs(idx.mNumHashFunctions);
+    for (u64 h = 0; h < idx.mNumHashFunctions; ++h) {
+      bIdxs[h] = oc::CuckooIndex<>::getHash(hash, (osuCrypto::u8)h, idx.mNumBins);
+      bool collision = false;
+      for (u64 hh = 0; hh < h; ++hh) collision |= bIdxs[hh] == bIdxs[h];
+
+      ASSERT_EQ(idx.mItemToBinMap(i, h), collision ? u64(-1) : bIdxs[h]);
+
+      auto &item = idx.mBins(bIdxs[h], binSizes[bIdxs[h]]++);
+      ASSERT_EQ(item.idx(), i);
+      ASSERT_EQ(item.hashIdx(), h);
+      ASSERT_EQ(item.isCollision(), collision);
+    }
+  }
+  ASSERT_EQ(idx.mBinSizes, binSizes);
+}
+}  // namespace
+
+TEST(SimpleIndexTest, InsertItems) {
+  PRNG prng(block(1, 2));
+  block seed(3, 4);
+
+  for (u64 n : {1000, 1 << 14}) {
+    std::vector<block> items(n);
+    prng.get(items.data(), n);
+
+    for (u64 numThreads : {1, 3, 8}) {
+      SimpleIndex idx;
+      idx.init(n / 4, n);
+      idx.insertItems(items, seed, numThreads);
+      checkIndex(idx, items, seed);
+    }
+  }
+}
+
+TEST(SimpleIndexTest, TwoHashFunctions) {
+  PRNG prng(block(5, 6));
+  block seed(7, 8);
+  u64 n = 5000;
+  std::vector<block> items(n);
+  prng.get(items.data(), n);
+
+  SimpleIndex idx;
+  idx.init(n / 8, n, 40, 2);
+  idx.insertItems(items, seed, 4);
+  checkIndex(idx, items, seed);
+}
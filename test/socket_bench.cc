@@ -0,0 +1,389 @@
+// Throughput and latency of ClientChannel/ServerChannel over TCP loopback and
+// unix domain sockets, with MemoryChannel as the baseline, so that a change
+// in PSI wall time can be attributed to the transport or the crypto.
+//
+//   bazel run //test:bench_socket -- --transports=tcp,unix,memory \
+//     --min_size=16 --max_size=1073741824 --forks=1,4 --io_backend=epoll
+//
+// For each setting, every forked channel pair first streams messages one way
+// to measure GB/s and msgs/s. Then it sends them in lockstep, one message at
+// a time, to measure the one way latency. Copies are the messages which the
+// socket staged in a heap buffer, because they arrived before the receiver
+// asked for them, and then copied out.
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "network/mem_channel.h"
+#include "tools/socket.h"
+
+DEFINE_string(transports, "tcp,unix,memory",
+              "Comma separated transports, of tcp, unix and memory.");
+DEFINE_uint64(min_size, 16, "Smallest message size in bytes.");
+DEFINE_uint64(max_size, 1 << 30, "Largest message size in bytes.");
+DEFINE_uint64(size_step, 4, "Each message size is this times the previous.");
+DEFINE_string(forks, "1,2,4,8",
+              "Comma separated numbers of forked channels used concurrently.");
+DEFINE_uint64(bytes_per_run, 1 << 28,
+              "Bytes each channel streams in the throughput phase.");
+DEFINE_uint64(min_msgs, 8, "Least messages each channel sends per phase.");
+DEFINE_uint64(max_msgs, 100000, "Most messages each channel sends per phase.");
+DEFINE_uint64(latency_msgs, 1000,
+              "Most messages each channel sends in the latency phase.");
+DEFINE_uint64(window, 256,
+              "Most messages in flight per channel in the throughput phase, "
+              "the socket holds at most 1024 unread messages per channel.");
+DEFINE_uint64(max_memory, 4ULL << 30,
+              "Skip settings whose message buffers need more bytes.");
+DEFINE_bool(registered, false, "Use registered recv for socket channels.");
+DEFINE_string(io_backend, "epoll",
+              "Io backend of socket channels, epoll or uring.");
+DEFINE_string(host, "127.0.0.1", "Address of tcp transport.");
+DEFINE_uint32(port, 35066, "Port of tcp transport.");
+DEFINE_string(unix_path, "/tmp/bench_socket.sock",
+              "Path of unix socket transport.");
+
+using primihub::crypto::network::ClientChannel;
+using primihub::crypto::network::CryptoChannel;
+using primihub::crypto::network::IoBackend;
+using primihub::crypto::network::RecvStats;
+using primihub::crypto::network::ServerChannel;
+using primihub::crypto::network::setIoBackend;
+using primihub::link::MemoryChannel;
+using ChannelRole = MemoryChannel::ChannelRole;
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+// One direction of a channel pair.
+class Endpoint {
+public:
+  virtual ~Endpoint() {}
+  virtual void send(uint8_t *ptr, size_t size) = 0;
+  virtual void recv(uint8_t *ptr, size_t size) = 0;
+  // Return false if the transport doesn't count copies.
+  virtual bool recvStats(RecvStats &stats) { return false; }
+};
+
+class SocketEndpoint : public Endpoint {
+public:
+  explicit SocketEndpoint(std::shared_ptr<CryptoChannel> chl) : chl_(chl) {}
+
+  void send(uint8_t *ptr, size_t size) {
+    if (!chl_->asyncSend(ptr, size).get().IsOK())
+      throw std::runtime_error("Send message failed.");
+  }
+
+  void recv(uint8_t *ptr, size_t size) {
+    if (!chl_->asyncRecv(ptr, size).get().IsOK())
+      throw std::runtime_error("Recv message failed.");
+  }
+
+  bool recvStats(RecvStats &stats) { return chl_->getRecvStats(stats).IsOK(); }
+
+private:
+  std::shared_ptr<CryptoChannel> chl_;
+};
+
+class MemoryEndpoint : public Endpoint {
+public:
+  explicit MemoryEndpoint(std::shared_ptr<primihub::link::Channel> chl)
+      : chl_(chl) {}
+
+  void send(uint8_t *ptr, size_t size) {
+    chl_->send(osuCrypto::span<uint8_t>(ptr, size));
+  }
+
+  void recv(uint8_t *ptr, size_t size) {
+    chl_->recv(osuCrypto::span<uint8_t>(ptr, size));
+  }
+
+private:
+  std::shared_ptr<primihub::link::Channel> chl_;
+};
+
+// Sender and receiver ends of forks channel pairs, plus the channels they
+// were forked from, which must outlive them.
+struct ChannelPairs {
+  std::vector<std::shared_ptr<void>> roots;
+  std::vector<std::unique_ptr<Endpoint>> senders;
+  std::vector<std::unique_ptr<Endpoint>> recvers;
+};
+
+ChannelPairs createSocketPairs(const std::string &host, uint16_t port,
+                               const std::string &tag, uint64_t forks) {
+  ChannelPairs pairs;
+  auto server = std::make_shared<ServerChannel>(host, port, tag);
+  if (!server->initChannel().IsOK())
+    throw std::runtime_error("Init server channel failed.");
+
+  auto client = std::make_shared<ClientChannel>(host, port, tag);
+  if (!client->initChannel().IsOK())
+    throw std::runtime_error("Init client channel failed.");
+
+  if (FLAGS_registered) {
+    server->setRegisteredRecv(true);
+    client->setRegisteredRecv(true);
+  }
+
+  for (uint64_t i = 0; i < forks; i++) {
+    auto server_fork = server->fork();
+    auto client_fork = client->fork();
+    if (server_fork == nullptr || client_fork == nullptr)
+      throw std::runtime_error("Fork channel failed.");
+
+    pairs.senders.emplace_back(new SocketEndpoint(client_fork));
+    pairs.recvers.emplace_back(new SocketEndpoint(server_fork));
+  }
+
+  pairs.roots.push_back(server);
+  pairs.roots.push_back(client);
+  return pairs;
+}
+
+ChannelPairs createMemoryPairs(const std::string &tag, uint64_t forks) {
+  ChannelPairs pairs;
+  auto client = std::make_shared<primihub::link::Channel>(
+      std::make_shared<MemoryChannel>(ChannelRole::CLIENT), tag);
+  auto server = std::make_shared<primihub::link::Channel>(
+      std::make_shared<MemoryChannel>(ChannelRole::SERVER), tag);
+
+  for (uint64_t i = 0; i < forks; i++) {
+    pairs.senders.emplace_back(new MemoryEndpoint(client->fork()));
+    pairs.recvers.emplace_back(new MemoryEndpoint(server->fork()));
+  }
+
+  pairs.roots.push_back(server);
+  pairs.roots.push_back(client);
+  return pairs;
+}
+
+struct Result {
+  double gbps{0};
+  double msgs_per_sec{0};
+  double p50_us{0};
+  double p99_us{0};
+  bool has_stats{false};
+  uint64_t copy_msgs{0};
+  uint64_t direct_msgs{0};
+};
+
+// Run fn(j) for every channel pair j on its own thread.
+template <typename Fn> void runPairs(uint64_t forks, Fn &&fn) {
+  std::vector<std::thread> thrds;
+  for (uint64_t j = 0; j < forks; j++)
+    thrds.emplace_back(fn, j);
+  for (auto &thrd : thrds)
+    thrd.join();
+}
+
+Result runSetting(ChannelPairs &pairs, uint64_t size) {
+  uint64_t forks = pairs.senders.size();
+  uint64_t num_msgs = std::min(
+      std::max(FLAGS_bytes_per_run / size, FLAGS_min_msgs), FLAGS_max_msgs);
+  uint64_t lat_msgs = std::max<uint64_t>(
+      1, std::min(FLAGS_latency_msgs, num_msgs));
+
+  std::vector<std::vector<uint8_t>> send_bufs(forks);
+  std::vector<std::vector<uint8_t>> recv_bufs(forks);
+  for (uint64_t j = 0; j < forks; j++) {
+    send_bufs[j].resize(size, static_cast<uint8_t>(j));
+    recv_bufs[j].resize(size);
+  }
+
+  Result result;
+  std::vector<RecvStats> before(forks);
+  result.has_stats = true;
+  for (uint64_t j = 0; j < forks; j++)
+    result.has_stats &= pairs.recvers[j]->recvStats(before[j]);
+
+  // Throughput, the sender streams up to window messages ahead of the
+  // receiver.
+  std::vector<std::atomic<uint64_t>> received(forks);
+  for (auto &count : received)
+    count.store(0);
+
+  auto start = Clock::now();
+  runPairs(forks * 2, [&](uint64_t idx) {
+    uint64_t j = idx / 2;
+    for (uint64_t i = 0; i < num_msgs; i++) {
+      if (idx % 2) {
+        while (i - received[j].load() >= FLAGS_window)
+          std::this_thread::yield();
+        pairs.senders[j]->send(send_bufs[j].data(), size);
+      } else {
+        pairs.recvers[j]->recv(recv_bufs[j].data(), size);
+        received[j].store(i + 1);
+      }
+    }
+  });
+  double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+  result.gbps = forks * num_msgs * size / seconds / 1e9;
+  result.msgs_per_sec = forks * num_msgs / seconds;
+
+  if (result.has_stats) {
+    for (uint64_t j = 0; j < forks; j++) {
+      RecvStats after;
+      pairs.recvers[j]->recvStats(after);
+      result.copy_msgs += after.copy_msgs - before[j].copy_msgs;
+      result.direct_msgs += after.direct_msgs - before[j].direct_msgs;
+    }
+  }
+
+  // Latency, the next message is sent after the previous one is received.
+  std::vector<double> latencies(forks * lat_msgs);
+  runPairs(forks, [&](uint64_t j) {
+    std::mutex mu;
+    std::condition_variable cond;
+    uint64_t received = 0;
+    std::vector<Clock::time_point> sent_at(lat_msgs);
+
+    std::thread recver([&]() {
+      for (uint64_t i = 0; i < lat_msgs; i++) {
+        pairs.recvers[j]->recv(recv_bufs[j].data(), size);
+        latencies[j * lat_msgs + i] =
+            std::chrono::duration<double, std::micro>(Clock::now() -
+                                                      sent_at[i])
+                .count();
+
+        std::lock_guard<std::mutex> lock(mu);
+        received = i + 1;
+        cond.notify_one();
+      }
+    });
+
+    for (uint64_t i = 0; i < lat_msgs; i++) {
+      sent_at[i] = Clock::now();
+      pairs.senders[j]->send(send_bufs[j].data(), size);
+
+      std::unique_lock<std::mutex> lock(mu);
+      cond.wait(lock, [&]() { return received > i; });
+    }
+
+    recver.join();
+  });
+
+  std::sort(latencies.begin(), latencies.end());
+  result.p50_us = latencies[latencies.size() / 2];
+  result.p99_us = latencies[std::min(latencies.size() - 1,
+                                     latencies.size() * 99 / 100)];
+  return result;
+}
+
+std::vector<std::string> split(const std::string &list) {
+  std::vector<std::string> items;
+  std::stringstream ss(list);
+  std::string item;
+  while (std::getline(ss, item, ','))
+    if (item.size())
+      items.push_back(item);
+
+  return items;
+}
+
+std::string formatSize(uint64_t size) {
+  const char *units[] = {"B", "KB", "MB", "GB"};
+  int unit = 0;
+  while (unit < 3 && size >= 1024 && size % 1024 == 0) {
+    size /= 1024;
+    unit++;
+  }
+
+  return std::to_string(size) + units[unit];
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+
+  // A message is framed with a 32 bits length.
+  if (FLAGS_min_size == 0 || FLAGS_max_size > UINT32_MAX ||
+      FLAGS_size_step < 2 || FLAGS_window == 0) {
+    LOG(ERROR) << "Message sizes should be in [1, 2^32), size step at least 2 "
+                  "and window positive.";
+    return 1;
+  }
+
+  if (FLAGS_io_backend == "uring") {
+    if (!setIoBackend(IoBackend::kUring).IsOK()) {
+      LOG(ERROR) << "io_uring is unavailable.";
+      return 1;
+    }
+  } else if (FLAGS_io_backend != "epoll") {
+    LOG(ERROR) << "Unknown io backend " << FLAGS_io_backend << ".";
+    return 1;
+  }
+
+  std::vector<uint64_t> all_forks;
+  for (const auto &item : split(FLAGS_forks))
+    all_forks.push_back(std::max<uint64_t>(1, std::stoull(item)));
+
+  std::cout << std::left << std::setw(10) << "transport" << std::setw(7)
+            << "forks" << std::setw(8) << "size" << std::setw(10) << "GB/s"
+            << std::setw(12) << "msgs/s" << std::setw(12) << "p50(us)"
+            << std::setw(12) << "p99(us)"
+            << "copied/direct" << std::endl;
+
+  uint64_t setting = 0;
+  for (const auto &transport : split(FLAGS_transports)) {
+    if (transport != "tcp" && transport != "unix" && transport != "memory") {
+      LOG(ERROR) << "Unknown transport " << transport << ".";
+      return 1;
+    }
+
+    for (uint64_t forks : all_forks) {
+      std::string tag = "bench_" + std::to_string(setting++);
+      ChannelPairs pairs;
+      if (transport == "tcp")
+        pairs = createSocketPairs(FLAGS_host, FLAGS_port, tag, forks);
+      else if (transport == "unix")
+        pairs = createSocketPairs("unix:" + FLAGS_unix_path, 0, tag, forks);
+      else
+        pairs = createMemoryPairs(tag, forks);
+
+      for (uint64_t size = FLAGS_min_size; size <= FLAGS_max_size;
+           size *= FLAGS_size_step) {
+        if (2 * forks * size > FLAGS_max_memory) {
+          VLOG(3) << "Skip " << transport << " with " << forks
+                  << " forks and message size " << size
+                  << ", exceed max memory.";
+          continue;
+        }
+
+        auto result = runSetting(pairs, size);
+
+        std::stringstream copies;
+        if (result.has_stats)
+          copies << result.copy_msgs << "/" << result.direct_msgs;
+        else
+          copies << "-";
+
+        std::cout << std::left << std::fixed << std::setprecision(3)
+                  << std::setw(10) << transport << std::setw(7) << forks
+                  << std::setw(8) << formatSize(size) << std::setw(10)
+                  << result.gbps << std::setprecision(0) << std::setw(12)
+                  << result.msgs_per_sec << std::setprecision(1)
+                  << std::setw(12) << result.p50_us << std::setw(12)
+                  << result.p99_us << copies.str() << std::endl;
+      }
+    }
+  }
+
+  return 0;
+}
@@ -1,4 +1,5 @@
 #include "tools/socket.h"
+#include "tools/keyed_channel.h"
 
 #include <glog/logging.h>
 #include <gtest/gtest.h>
@@ -6,7 +7,12 @@
 using primihub::crypto::Status;
 using primihub::crypto::network::ClientChannel;
 using primihub::crypto::network::CryptoChannel;
+using primihub::crypto::network::IoBackend;
+using primihub::crypto::network::KeyedChannel;
 using primihub::crypto::network::ServerChannel;
+using primihub::crypto::network::SessionOptions;
+using primihub::crypto::network::SessionServer;
+using primihub::crypto::network::setIoBackend;
 
 static std::string gen_random(uint32_t len) {
   static const char alphanum[] =
@@ -184,3 +190,426 @@ TEST(channel_test, recv_resize_test) {
   EXPECT_EQ(recv_fut2.get().IsOK(), true);
   EXPECT_EQ(recv_msg, send_msg);
 }
+
+TEST(channel_test, registered_recv_test) {
+  std::string host("127.0.0.1");
+  std::string tag("test_tag");
+
+  std::shared_ptr<ServerChannel> server_channel =
+      std::make_shared<ServerChannel>(host, 35056, tag);
+  auto status = server_channel->initChannel();
+  EXPECT_EQ(status.IsOK(), true);
+
+  std::shared_ptr<ClientChannel> client_channel =
+      std::make_shared<ClientChannel>(host, 35056, tag);
+  status = client_channel->initChannel();
+  EXPECT_EQ(status.IsOK(), true);
+
+  EXPECT_EQ(server_channel->setRegisteredRecv(true).IsOK(), true);
+  EXPECT_EQ(client_channel->setRegisteredRecv(true).IsOK(), true);
+
+  // Messages arrive before the receiver provides buffer, so they are
+  // deferred and then read into the buffer directly.
+  std::vector<std::string> send_msgs;
+  for (uint32_t i = 0; i < 4; i++)
+    send_msgs.push_back(gen_random(102400));
+
+  for (auto &msg : send_msgs)
+    EXPECT_EQ(client_channel->asyncSend(msg.data(), msg.size()).get().IsOK(),
+              true);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  for (uint32_t i = 0; i < 3; i++) {
+    std::string recv_msg;
+    recv_msg.resize(102400);
+    auto fut = server_channel->asyncRecv(recv_msg.data(), recv_msg.size());
+    EXPECT_EQ(fut.get().IsOK(), true);
+    EXPECT_EQ(recv_msg, send_msgs[i]);
+  }
+
+  std::string recv_msg;
+  EXPECT_EQ(server_channel->recvResize(recv_msg).IsOK(), true);
+  EXPECT_EQ(recv_msg, send_msgs[3]);
+
+  // Same for the reverse direction.
+  std::string send_msg = gen_random(102400);
+  EXPECT_EQ(
+      server_channel->asyncSend(send_msg.data(), send_msg.size()).get().IsOK(),
+      true);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  recv_msg.clear();
+  recv_msg.resize(102400);
+  auto fut = client_channel->asyncRecv(recv_msg.data(), recv_msg.size());
+  EXPECT_EQ(fut.get().IsOK(), true);
+  EXPECT_EQ(recv_msg, send_msg);
+
+  primihub::crypto::network::RecvStats server_stats;
+  EXPECT_EQ(server_channel->getRecvStats(server_stats).IsOK(), true);
+  EXPECT_EQ(server_stats.direct_msgs, 4);
+  EXPECT_EQ(server_stats.direct_bytes, 4 * 102400);
+  EXPECT_EQ(server_stats.copy_msgs, 0);
+  EXPECT_EQ(server_stats.copy_bytes, 0);
+
+  primihub::crypto::network::RecvStats client_stats;
+  EXPECT_EQ(client_channel->getRecvStats(client_stats).IsOK(), true);
+  EXPECT_EQ(client_stats.direct_msgs, 1);
+  EXPECT_EQ(client_stats.copy_msgs, 0);
+}
+
+TEST(channel_test, io_backend_test) {
+  std::string host("127.0.0.1");
+  std::string tag("test_tag");
+
+  for (auto backend : {IoBackend::kEpoll, IoBackend::kUring}) {
+    auto status = setIoBackend(backend);
+    if (!status.IsOK()) {
+      LOG(WARNING) << "Skip unavailable io backend.";
+      continue;
+    }
+
+    std::shared_ptr<ServerChannel> server_channel =
+        std::make_shared<ServerChannel>(host, 35056, tag);
+    status = server_channel->initChannel();
+    EXPECT_EQ(status.IsOK(), true);
+
+    std::shared_ptr<ClientChannel> client_channel =
+        std::make_shared<ClientChannel>(host, 35056, tag);
+    status = client_channel->initChannel();
+    EXPECT_EQ(status.IsOK(), true);
+
+    for (uint32_t size : {16, 1024, 1 << 20}) {
+      std::string send_msg = gen_random(size);
+      std::string recv_msg;
+      recv_msg.resize(size);
+
+      auto recv_fut = server_channel->asyncRecv(recv_msg.data(), size);
+      auto send_fut = client_channel->asyncSend(send_msg.data(), size);
+      EXPECT_EQ(send_fut.get().IsOK(), true);
+      EXPECT_EQ(recv_fut.get().IsOK(), true);
+      EXPECT_EQ(recv_msg, send_msg);
+
+      send_msg = gen_random(size);
+      recv_msg.clear();
+      send_fut = server_channel->asyncSend(send_msg.data(), size);
+      EXPECT_EQ(client_channel->recvResize(recv_msg).IsOK(), true);
+      EXPECT_EQ(send_fut.get().IsOK(), true);
+      EXPECT_EQ(recv_msg, send_msg);
+    }
+  }
+}
+
+TEST(channel_test, send_vector_test) {
+  std::string host("127.0.0.1");
+  std::string tag("test_tag");
+
+  std::shared_ptr<ServerChannel> server_channel =
+      std::make_shared<ServerChannel>(host, 35056, tag);
+  auto status = server_channel->initChannel();
+  EXPECT_EQ(status.IsOK(), true);
+
+  std::shared_ptr<ClientChannel> client_channel =
+      std::make_shared<ClientChannel>(host, 35056, tag);
+  status = client_channel->initChannel();
+  EXPECT_EQ(status.IsOK(), true);
+
+  // More regions than IOV_MAX.
+  std::vector<std::string> parts;
+  std::vector<struct iovec> iov;
+  std::string expect_msg;
+  for (uint32_t i = 0; i < 3000; i++)
+    parts.push_back(gen_random(1 + i % 37));
+
+  for (auto &part : parts) {
+    struct iovec region;
+    region.iov_base = part.data();
+    region.iov_len = part.size();
+    iov.push_back(region);
+    expect_msg += part;
+  }
+
+  std::string recv_msg;
+  auto send_fut = client_channel->asyncSendv(
+      span<const struct iovec>(iov.data(), iov.size()));
+  EXPECT_EQ(server_channel->recvResize(recv_msg).IsOK(), true);
+  EXPECT_EQ(send_fut.get().IsOK(), true);
+  EXPECT_EQ(recv_msg, expect_msg);
+
+  // Send the low 5 bytes of every 16 bytes.
+  std::string rows = gen_random(16 * 1000);
+  expect_msg.clear();
+  for (uint32_t i = 0; i < 1000; i++)
+    expect_msg += rows.substr(i * 16, 5);
+
+  recv_msg.clear();
+  send_fut = server_channel->asyncSendStrided(rows.data(), 1000, 16, 5);
+  EXPECT_EQ(client_channel->recvResize(recv_msg).IsOK(), true);
+  EXPECT_EQ(send_fut.get().IsOK(), true);
+  EXPECT_EQ(recv_msg, expect_msg);
+
+  // Larger than the staging buffer, so it goes out in several chunks.
+  const uint32_t num_rows = 300007;
+  rows = gen_random(16 * num_rows);
+  expect_msg.clear();
+  for (uint32_t i = 0; i < num_rows; i++)
+    expect_msg += rows.substr(i * 16, 7);
+
+  recv_msg.clear();
+  send_fut = client_channel->asyncSendStrided(rows.data(), num_rows, 16, 7);
+  EXPECT_EQ(server_channel->recvResize(recv_msg).IsOK(), true);
+  EXPECT_EQ(send_fut.get().IsOK(), true);
+  EXPECT_EQ(recv_msg, expect_msg);
+
+  send_fut = client_channel->asyncSendStrided(rows.data(), 10, 4, 5);
+  EXPECT_EQ(send_fut.get().IsOK(), false);
+}
+
+TEST(channel_test, session_server_test) {
+  std::string host("127.0.0.1");
+  const uint32_t num_msgs = 8;
+  const uint32_t msg_size = 1024;
+
+  SessionOptions options;
+  options.max_sessions = 2;
+  options.memory_limit = 4 * msg_size;
+
+  std::atomic<uint32_t> running{0};
+  std::atomic<uint32_t> max_running{0};
+
+  // Each session echoes what its client sent on the session channel and on a
+  // forked channel.
+  auto handler = [&](const std::string &tag,
+                     std::shared_ptr<CryptoChannel> channel) -> Status {
+    uint32_t now = ++running;
+    uint32_t prev = max_running.load();
+    while (prev < now && !max_running.compare_exchange_weak(prev, now))
+      ;
+
+    // Let the client send everything first, so the staged messages reach the
+    // memory limit and the rest are deferred.
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    auto forked = channel->fork();
+    std::string echo;
+    for (uint32_t i = 0; i < num_msgs; i++) {
+      std::string msg;
+      msg.resize(msg_size);
+      auto status = channel->asyncRecv(msg.data(), msg.size()).get();
+      if (!status.IsOK())
+        return status;
+      echo += msg;
+    }
+
+    std::string msg;
+    auto status = forked->recvResize(msg);
+    if (!status.IsOK())
+      return status;
+    echo += msg;
+
+    // Without the limit every message would have been staged and copied.
+    primihub::crypto::network::RecvStats stats;
+    EXPECT_EQ(channel->getRecvStats(stats).IsOK(), true);
+    EXPECT_EQ(stats.copy_msgs + stats.direct_msgs, num_msgs);
+    EXPECT_GT(stats.direct_msgs, 0);
+
+    status = channel->asyncSend(echo.data(), echo.size()).get();
+    --running;
+    return status;
+  };
+
+  SessionServer server(host, 35056, options);
+  EXPECT_EQ(server.start(handler).IsOK(), true);
+
+  auto client = [&](uint32_t idx) {
+    std::string tag = "session_" + std::to_string(idx);
+    std::shared_ptr<ClientChannel> channel =
+        std::make_shared<ClientChannel>(host, 35056, tag);
+    EXPECT_EQ(channel->initChannel().IsOK(), true);
+    auto forked = channel->fork();
+
+    std::string expect_msg;
+    for (uint32_t i = 0; i < num_msgs; i++) {
+      std::string msg = gen_random(msg_size);
+      EXPECT_EQ(channel->asyncSend(msg.data(), msg.size()).get().IsOK(), true);
+      expect_msg += msg;
+    }
+
+    std::string msg = gen_random(100);
+    EXPECT_EQ(forked->asyncSend(msg.data(), msg.size()).get().IsOK(), true);
+    expect_msg += msg;
+
+    std::string recv_msg;
+    EXPECT_EQ(channel->recvResize(recv_msg).IsOK(), true);
+    EXPECT_EQ(recv_msg, expect_msg);
+  };
+
+  std::vector<std::thread> clients;
+  for (uint32_t i = 0; i < 5; i++)
+    clients.emplace_back(client, i);
+  for (auto &thrd : clients)
+    thrd.join();
+
+  EXPECT_LE(max_running.load(), options.max_sessions);
+  server.stop();
+}
+
+TEST(channel_test, keyed_channel_test) {
+  std::string host("127.0.0.1");
+  std::string tag("test_tag");
+  const uint32_t num_msgs = 50;
+
+  std::shared_ptr<ServerChannel> server_channel =
+      std::make_shared<ServerChannel>(host, 35056, tag);
+  EXPECT_EQ(server_channel->initChannel().IsOK(), true);
+
+  std::shared_ptr<ClientChannel> client_channel =
+      std::make_shared<ClientChannel>(host, 35056, tag);
+  EXPECT_EQ(client_channel->initChannel().IsOK(), true);
+
+  KeyedChannel server(server_channel);
+  KeyedChannel client(client_channel);
+
+  // Each key is sent and received by its own thread, so messages of
+  // different keys interleave on the channel and every receiver in turn
+  // reads for the others.
+  std::vector<std::string> keys = {"a", "bb", "a_fork_1"};
+  std::vector<std::vector<std::string>> msgs(keys.size());
+  for (uint32_t k = 0; k < keys.size(); k++)
+    for (uint32_t i = 0; i < num_msgs; i++)
+      msgs[k].push_back(gen_random(i * 97 % 3000));
+
+  std::vector<std::thread> thrds;
+  for (uint32_t k = 0; k < keys.size(); k++) {
+    thrds.emplace_back([&, k]() {
+      for (const auto &msg : msgs[k])
+        EXPECT_EQ(client.send(keys[k], msg.data(), msg.size()).IsOK(), true);
+    });
+    thrds.emplace_back([&, k]() {
+      for (const auto &msg : msgs[k]) {
+        std::string recv_msg;
+        EXPECT_EQ(server.recv(keys[k], recv_msg).IsOK(), true);
+        EXPECT_EQ(recv_msg, msg);
+      }
+    });
+  }
+  for (auto &thrd : thrds)
+    thrd.join();
+
+  // Low 5 bytes of each 16 byte row, then a message of another key must
+  // not be mixed into it.
+  std::string rows = gen_random(1000 * 16);
+  std::string expect_msg;
+  for (uint32_t i = 0; i < 1000; i++)
+    expect_msg += rows.substr(i * 16, 5);
+
+  EXPECT_EQ(server.sendStrided("rows", rows.data(), 1000, 16, 5).IsOK(),
+            true);
+  EXPECT_EQ(server.send("a", rows.data(), 7).IsOK(), true);
+
+  std::string recv_msg;
+  recv_msg.resize(7);
+  EXPECT_EQ(client.recv("a", recv_msg.data(), 7).IsOK(), true);
+  EXPECT_EQ(recv_msg, rows.substr(0, 7));
+  EXPECT_EQ(client.recv("rows", recv_msg).IsOK(), true);
+  EXPECT_EQ(recv_msg, expect_msg);
+
+  // A message of the wrong size is rejected.
+  EXPECT_EQ(server.send("a", rows.data(), 8).IsOK(), true);
+  EXPECT_EQ(client.recv("a", recv_msg.data(), 7).IsOK(), false);
+  EXPECT_EQ(server.sendStrided("rows", rows.data(), 10, 4, 5).IsOK(), false);
+}
+
+TEST(channel_test, keyed_session_test) {
+  std::string host("127.0.0.1");
+  const uint32_t num_msgs = 20;
+
+  // Each session answers every ping with a pong on another key.
+  auto handler = [&](const std::string &tag,
+                     std::shared_ptr<CryptoChannel> channel) -> Status {
+    KeyedChannel keyed(channel);
+    for (uint32_t i = 0; i < num_msgs; i++) {
+      std::string msg;
+      auto status = keyed.recv("ping", msg);
+      if (!status.IsOK())
+        return status;
+
+      msg = tag + msg;
+      status = keyed.send("pong", msg.data(), msg.size());
+      if (!status.IsOK())
+        return status;
+    }
+
+    return Status::OK();
+  };
+
+  SessionServer server(host, 35056);
+  EXPECT_EQ(server.start(handler).IsOK(), true);
+
+  auto client = [&](uint32_t idx) {
+    std::string tag = "keyed_session_" + std::to_string(idx);
+    std::shared_ptr<ClientChannel> channel =
+        std::make_shared<ClientChannel>(host, 35056, tag);
+    EXPECT_EQ(channel->initChannel().IsOK(), true);
+
+    KeyedChannel keyed(channel);
+    for (uint32_t i = 0; i < num_msgs; i++) {
+      std::string msg = gen_random(1 + i * 31);
+      EXPECT_EQ(keyed.send("ping", msg.data(), msg.size()).IsOK(), true);
+
+      std::string recv_msg;
+      EXPECT_EQ(keyed.recv("pong", recv_msg).IsOK(), true);
+      EXPECT_EQ(recv_msg, tag + msg);
+    }
+  };
+
+  std::vector<std::thread> clients;
+  for (uint32_t i = 0; i < 4; i++)
+    clients.emplace_back(client, i);
+  for (auto &thrd : clients)
+    thrd.join();
+
+  server.stop();
+}
+
+TEST(channel_test, unix_socket_test) {
+  std::string host("unix:/tmp/socket_test.sock");
+  std::string tag("test_tag");
+
+  std::shared_ptr<ServerChannel> server_channel =
+      std::make_shared<ServerChannel>(host, 0, tag);
+  auto status = server_channel->initChannel();
+  EXPECT_EQ(status.IsOK(), true);
+
+  std::shared_ptr<ClientChannel> client_channel =
+      std::make_shared<ClientChannel>(host, 0, tag);
+  status = client_channel->initChannel();
+  EXPECT_EQ(status.IsOK(), true);
+
+  // The channel itself, then a forked one.
+  std::vector<std::pair<std::shared_ptr<CryptoChannel>,
+                        std::shared_ptr<CryptoChannel>>>
+      pairs;
+  pairs.emplace_back(server_channel, client_channel);
+  pairs.emplace_back(server_channel->fork(), client_channel->fork());
+
+  for (auto &pair : pairs) {
+    std::string send_msg = gen_random(1 << 20);
+    std::string recv_msg;
+    recv_msg.resize(send_msg.size());
+
+    auto recv_fut = pair.first->asyncRecv(recv_msg.data(), recv_msg.size());
+    auto send_fut = pair.second->asyncSend(send_msg.data(), send_msg.size());
+    EXPECT_EQ(send_fut.get().IsOK(), true);
+    EXPECT_EQ(recv_fut.get().IsOK(), true);
+    EXPECT_EQ(recv_msg, send_msg);
+
+    send_msg = gen_random(1024);
+    recv_msg.clear();
+    send_fut = pair.first->asyncSend(send_msg.data(), send_msg.size());
+    EXPECT_EQ(pair.second->recvResize(recv_msg).IsOK(), true);
+    EXPECT_EQ(send_fut.get().IsOK(), true);
+    EXPECT_EQ(recv_msg, send_msg);
+  }
+}
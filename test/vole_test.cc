@@ -301,6 +301,66 @@ TEST(vole, silver_test) {
   timer.setTimePoint("done");
 }
 
+TEST(vole, exacc_test) {
+  using Channel = primihub::link::Channel;
+
+  std::shared_ptr<MemoryChannel> channel_impl1 =
+      std::make_shared<MemoryChannel>(ChannelRole::CLIENT);
+  std::shared_ptr<Channel> channel1 =
+      std::make_shared<Channel>(channel_impl1, "exacc_test");
+
+  std::shared_ptr<MemoryChannel> channel_impl2 =
+      std::make_shared<MemoryChannel>(ChannelRole::SERVER);
+  std::shared_ptr<Channel> channel2 =
+      std::make_shared<Channel>(channel_impl2, "exacc_test");
+
+  Timer timer;
+  timer.setTimePoint("start");
+  u64 n = 102043;
+  u64 nt = std::thread::hardware_concurrency();
+  block seed = block(0, 0);
+  PRNG prng(seed);
+
+  block x = prng.get();
+
+  for (auto type : {MultType::ExAcc7, MultType::ExAcc11, MultType::ExAcc21,
+                    MultType::ExAcc40}) {
+    std::vector<block> c(n), z0(n), z1(n);
+
+    SilentVoleReceiver recv;
+    SilentVoleSender send;
+
+    recv.mMultType = type;
+    send.mMultType = type;
+
+    recv.setTimer(timer);
+    send.setTimer(timer);
+
+    fakeBase(n, nt, prng, x, recv, send);
+
+    auto recv_fn = [&recv, &c, &z0, &prng, channel1]() {
+      recv.silentReceive(c, z0, prng, channel1);
+    };
+
+    auto send_fn = [&send, x, &z1, &prng, channel2]() {
+      send.silentSend(x, z1, prng, channel2);
+    };
+
+    auto recv_fut = std::async(recv_fn);
+    auto send_fut = std::async(send_fn);
+
+    send_fut.get();
+    recv_fut.get();
+
+    for (u64 i = 0; i < n; ++i) {
+      if (c[i].gf128Mul(x) != (z0[i] ^ z1[i])) {
+        throw RTE_LOC;
+      }
+    }
+    timer.setTimePoint("done");
+  }
+}
+
 TEST(vole, baseot_test) {
   using Channel = primihub::link::Channel;
 
@@ -20,4 +20,57 @@ Status CryptoChannel::recvResize(std::vector<block> &container) {
   return Status::OK();
 }
 
+std::future<Status> CryptoChannel::asyncSendv(span<const struct iovec> iov) {
+  auto send_fn = [this, iov]() -> Status {
+    size_t send_size = 0;
+    for (const auto &region : iov)
+      send_size += region.iov_len;
+
+    std::string tmp;
+    tmp.reserve(send_size);
+    for (const auto &region : iov)
+      tmp.append(reinterpret_cast<const char *>(region.iov_base),
+                 region.iov_len);
+
+    return asyncSend(tmp.data(), tmp.size()).get();
+  };
+
+  return std::async(std::launch::async, send_fn);
+}
+
+std::future<Status> CryptoChannel::asyncSendStrided(const void *ptr,
+                                                    size_t count,
+                                                    size_t stride,
+                                                    size_t width) {
+  if (width > stride) {
+    LOG(ERROR) << "Width " << width << " of element is larger than stride "
+               << stride << ".";
+    std::promise<Status> prom;
+    prom.set_value(Status::InvalidError());
+    return prom.get_future();
+  }
+
+  // Elements are contiguous.
+  if (width == stride)
+    return asyncSend(const_cast<void *>(ptr), count * width);
+
+  auto buf = std::make_shared<std::string>(count * width, '\0');
+  gatherStrided(buf->data(), ptr, 0, count, stride, width);
+
+  // The buffer lives until the send is done, without another thread.
+  auto send_fn = [buf, fut = asyncSend(buf->data(), buf->size())]() mutable {
+    return fut.get();
+  };
+
+  return std::async(std::launch::deferred, std::move(send_fn));
+}
+
+void gatherStrided(void *dest, const void *ptr, size_t begin, size_t count,
+                   size_t stride, size_t width) {
+  char *out = reinterpret_cast<char *>(dest);
+  const char *in = reinterpret_cast<const char *>(ptr) + begin * stride;
+  for (size_t i = 0; i < count; i++, out += width, in += stride)
+    memcpy(out, in, width);
+}
+
 }; // namespace primihub::crypto::network
@@ -3,6 +3,7 @@
 
 #include <future>
 #include <glog/logging.h>
+#include <sys/uio.h>
 
 #include <cryptoTools/Common/Aligned.h>
 #include <cryptoTools/Common/Matrix.h>
@@ -30,6 +31,20 @@ using is_container =
                      std::is_pod<Container>::value == false>::type,
                  void>;
 
+// Counters of received messages, split by whether the payload was read
+// straight into the caller's buffer or went through a heap buffer and memcpy.
+struct RecvStats {
+  uint64_t direct_msgs{0};
+  uint64_t direct_bytes{0};
+  uint64_t copy_msgs{0};
+  uint64_t copy_bytes{0};
+};
+
+// Copy elements [begin, begin + count) of a strided view, see
+// CryptoChannel::asyncSendStrided, to dest back to back.
+void gatherStrided(void *dest, const void *ptr, size_t begin, size_t count,
+                   size_t stride, size_t width);
+
 class CryptoChannel {
 public:
   virtual ~CryptoChannel() {}
@@ -40,6 +55,28 @@ public:
   virtual Status recvResize(std::string &container) = 0;
   virtual std::shared_ptr<CryptoChannel> fork(void) = 0;
 
+  // Send all regions in iov as one message, the receiver gets their
+  // concatenation. Regions must be valid until the future is ready. The
+  // default gathers them into a temporary buffer.
+  virtual std::future<Status> asyncSendv(span<const struct iovec> iov);
+
+  // Send count elements of width bytes each, starting stride bytes apart,
+  // such as the low mask bytes of every block in a span<block>, as one
+  // message. Elements must be valid until the future is ready. The default
+  // gathers them into one buffer in the calling thread.
+  virtual std::future<Status> asyncSendStrided(const void *ptr, size_t count,
+                                               size_t stride, size_t width);
+
+  // In registered mode a message that arrives before asyncRecv provides its
+  // buffer is not staged in a heap buffer, the socket stops reading until the
+  // buffer is provided and the payload is read into it directly.
+  virtual Status setRegisteredRecv(bool enable) {
+    return Status::NotImplementError();
+  }
+  virtual Status getRecvStats(RecvStats &stats) {
+    return Status::NotImplementError();
+  }
+
   template <typename Container>
   typename std::enable_if<is_container<Container>::value,
                           typename std::future<Status>>::type
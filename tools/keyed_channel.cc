@@ -0,0 +1,129 @@
+#include "tools/keyed_channel.h"
+
+#include <string.h>
+
+namespace primihub::crypto::network {
+namespace {
+// A message starts with the size of its key, a split flag and the key. The
+// payload follows in the same frame, or in the next frame if split is set.
+constexpr size_t kHeaderFixed = sizeof(uint32_t) + sizeof(uint8_t);
+
+std::string makeHeader(const std::string &key, bool split) {
+  std::string header(kHeaderFixed + key.size(), '\0');
+  uint32_t key_size = key.size();
+  memcpy(&header[0], &key_size, sizeof(key_size));
+  header[sizeof(key_size)] = split ? 1 : 0;
+  memcpy(&header[kHeaderFixed], key.data(), key.size());
+  return header;
+}
+} // namespace
+
+KeyedChannel::KeyedChannel(std::shared_ptr<CryptoChannel> channel) {
+  channel_ = std::move(channel);
+}
+
+Status KeyedChannel::sendHeader(const std::string &key, bool split) {
+  std::string header = makeHeader(key, split);
+  return channel_->asyncSend(header.data(), header.size()).get();
+}
+
+Status KeyedChannel::send(const std::string &key, const void *ptr,
+                          size_t size) {
+  std::string header = makeHeader(key, false);
+  struct iovec iov[2];
+  iov[0].iov_base = header.data();
+  iov[0].iov_len = header.size();
+  iov[1].iov_base = const_cast<void *>(ptr);
+  iov[1].iov_len = size;
+
+  std::lock_guard<std::mutex> lock(send_mu_);
+  return channel_->asyncSendv(span<const struct iovec>(iov, 2)).get();
+}
+
+Status KeyedChannel::sendStrided(const std::string &key, const void *ptr,
+                                 size_t count, size_t stride, size_t width) {
+  if (width > stride) {
+    LOG(ERROR) << "Element width " << width << " exceeds stride " << stride
+               << ".";
+    return Status::InvalidError();
+  }
+
+  std::lock_guard<std::mutex> lock(send_mu_);
+  auto status = sendHeader(key, true);
+  if (!status.IsOK())
+    return status;
+
+  return channel_->asyncSendStrided(ptr, count, stride, width).get();
+}
+
+void KeyedChannel::readMessage(std::unique_lock<std::mutex> &lock) {
+  reading_ = true;
+  lock.unlock();
+
+  std::string key;
+  std::string payload;
+  bool ok = channel_->recvResize(payload).IsOK();
+  if (ok && payload.size() >= kHeaderFixed) {
+    uint32_t key_size = 0;
+    memcpy(&key_size, payload.data(), sizeof(key_size));
+    bool split = payload[sizeof(key_size)] != 0;
+    ok = payload.size() - kHeaderFixed >= key_size;
+    if (ok) {
+      key = payload.substr(kHeaderFixed, key_size);
+      payload.erase(0, kHeaderFixed + key_size);
+      // The sender holds its lock until the payload frame follows.
+      if (split)
+        ok = payload.empty() && channel_->recvResize(payload).IsOK();
+    }
+  } else {
+    ok = false;
+  }
+
+  lock.lock();
+  reading_ = false;
+  if (ok) {
+    pending_[key].emplace_back(std::move(payload));
+  } else {
+    LOG(ERROR) << "Recv keyed message failed, tag " << channel_->getTag()
+               << ".";
+    failed_ = true;
+  }
+
+  recv_cond_.notify_all();
+}
+
+Status KeyedChannel::recv(const std::string &key, std::string &container) {
+  std::unique_lock<std::mutex> lock(recv_mu_);
+  auto &queue = pending_[key];
+  while (queue.empty()) {
+    if (failed_)
+      return Status::NetworkError();
+
+    if (reading_)
+      recv_cond_.wait(lock);
+    else
+      readMessage(lock);
+  }
+
+  container = std::move(queue.front());
+  queue.pop_front();
+  return Status::OK();
+}
+
+Status KeyedChannel::recv(const std::string &key, void *ptr, size_t size) {
+  std::string container;
+  auto status = recv(key, container);
+  if (!status.IsOK())
+    return status;
+
+  if (container.size() != size) {
+    LOG(ERROR) << "Message of key " << key << " has " << container.size()
+               << " bytes, expect " << size << ".";
+    return Status::MismatchError();
+  }
+
+  memcpy(ptr, container.data(), size);
+  return Status::OK();
+}
+
+} // namespace primihub::crypto::network
@@ -0,0 +1,60 @@
+#ifndef __TOOLS_KEYED_CHANNEL_H_
+#define __TOOLS_KEYED_CHANNEL_H_
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "tools/channel.h"
+
+namespace primihub::crypto::network {
+// Carries the messages of many keys over one CryptoChannel, such as the
+// channel of a SessionServer session. Each message is framed with its key
+// and a receiver gets the messages of its key in the order they were sent.
+// There is no recv thread: a receiver whose key has nothing pending reads
+// the channel for every key, while the other receivers wait for it.
+//
+// Received payloads are always staged in a heap buffer, so registered recv
+// of the channel doesn't apply.
+class KeyedChannel {
+public:
+  explicit KeyedChannel(std::shared_ptr<CryptoChannel> channel);
+
+  Status send(const std::string &key, const void *ptr, size_t size);
+
+  // Send count elements of width bytes each, starting stride bytes apart,
+  // through CryptoChannel::asyncSendStrided, so they are not compacted into
+  // a buffer first.
+  Status sendStrided(const std::string &key, const void *ptr, size_t count,
+                     size_t stride, size_t width);
+
+  // Recv the next message of key, which must be size bytes.
+  Status recv(const std::string &key, void *ptr, size_t size);
+  Status recv(const std::string &key, std::string &container);
+
+  std::shared_ptr<CryptoChannel> channel(void) { return channel_; }
+
+private:
+  Status sendHeader(const std::string &key, bool split);
+  // Read one message of any key from the channel, called with lock held by
+  // the only reader.
+  void readMessage(std::unique_lock<std::mutex> &lock);
+
+  std::shared_ptr<CryptoChannel> channel_;
+
+  // A message and its header must not interleave with another send.
+  std::mutex send_mu_;
+
+  std::mutex recv_mu_;
+  std::condition_variable recv_cond_;
+  std::map<std::string, std::deque<std::string>> pending_;
+  bool reading_{false};
+  bool failed_{false};
+};
+
+} // namespace primihub::crypto::network
+
+#endif
@@ -0,0 +1,36 @@
+#include "tools/link_channel.h"
+
+namespace primihub::crypto::network {
+namespace {
+primihub::link::Status toLinkStatus(const Status &status) {
+  return status.IsOK() ? primihub::link::Status::OK()
+                       : primihub::link::Status::NetworkError();
+}
+} // namespace
+
+LinkChannel::LinkChannel(std::shared_ptr<CryptoChannel> channel)
+    : keyed_(std::move(channel)) {}
+
+primihub::link::Status LinkChannel::send(const std::string &key,
+                                         std::string_view data) {
+  return toLinkStatus(keyed_.send(key, data.data(), data.size()));
+}
+
+primihub::link::Status LinkChannel::recv(const std::string &key, char *ptr,
+                                         size_t size) {
+  return toLinkStatus(keyed_.recv(key, ptr, size));
+}
+
+primihub::link::Status LinkChannel::recv(const std::string &key,
+                                         std::string *data) {
+  return toLinkStatus(keyed_.recv(key, *data));
+}
+
+std::shared_ptr<primihub::link::Channel>
+makeLinkChannel(std::shared_ptr<CryptoChannel> channel,
+                const std::string &key) {
+  return std::make_shared<primihub::link::Channel>(
+      std::make_shared<LinkChannel>(std::move(channel)), key);
+}
+
+} // namespace primihub::crypto::network
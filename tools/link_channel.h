@@ -0,0 +1,40 @@
+#ifndef __TOOLS_LINK_CHANNEL_H_
+#define __TOOLS_LINK_CHANNEL_H_
+
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "network/channel_interface.h"
+#include "tools/keyed_channel.h"
+
+namespace primihub::crypto::network {
+// A link channel over a CryptoChannel, so the protocols which take a
+// primihub::link::Channel, such as RsPsiSender and RsPsiReceiver, can run on
+// a socket channel, for example the one SessionServer hands to a session.
+// The messages of every link key, forked ones included, share the socket
+// channel through a KeyedChannel.
+class LinkChannel : public primihub::link::ChannelBase {
+public:
+  explicit LinkChannel(std::shared_ptr<CryptoChannel> channel);
+
+  primihub::link::Status send(const std::string &key,
+                              std::string_view data) override;
+  primihub::link::Status recv(const std::string &key, char *ptr,
+                              size_t size) override;
+  primihub::link::Status recv(const std::string &key,
+                              std::string *data) override;
+
+  KeyedChannel &keyed(void) { return keyed_; }
+
+private:
+  KeyedChannel keyed_;
+};
+
+// A link::Channel with key over channel. Both parties must use the same key.
+std::shared_ptr<primihub::link::Channel>
+makeLinkChannel(std::shared_ptr<CryptoChannel> channel, const std::string &key);
+
+} // namespace primihub::crypto::network
+
+#endif
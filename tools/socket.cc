@@ -1,21 +1,29 @@
 #include <atomic>
 #include <chrono>
 #include <condition_variable>
+#include <deque>
+#include <functional>
+#include <limits>
 #include <map>
 #include <mutex>
 #include <queue>
+#include <set>
 #include <thread>
 #include <tuple>
 
 #include <arpa/inet.h>
 #include <assert.h>
 #include <glog/logging.h>
+#include <limits.h>
 #include <sys/epoll.h>
 #include <sys/select.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
 #include <unistd.h>
 
 #include "socket.h"
+#include "uring.h"
 
 namespace primihub::crypto::network {
 namespace {
@@ -67,30 +75,226 @@ ssize_t writen(int fd, const void *vptr, size_t n) {
   return (n);
 }
 
+// Like writen but gather from iov, which is modified to skip sent bytes.
+ssize_t writevn(int fd, struct iovec *iov, int iovcnt) {
+  size_t total = 0;
+  for (int i = 0; i < iovcnt; i++)
+    total += iov[i].iov_len;
+
+  int index = 0;
+  while (index < iovcnt) {
+    if (iov[index].iov_len == 0) {
+      index++;
+      continue;
+    }
+
+    ssize_t nwritten = writev(fd, iov + index, std::min(iovcnt - index, IOV_MAX));
+    if (nwritten <= 0) {
+      if (nwritten < 0 && errno == EINTR) {
+        continue; // Call writev() again.
+      } else {
+        LOG(ERROR) << "Run writev failed, " << strerror(errno) << ".";
+        return (-1);
+      }
+    }
+
+    while (nwritten > 0) {
+      if (static_cast<size_t>(nwritten) >= iov[index].iov_len) {
+        nwritten -= iov[index].iov_len;
+        index++;
+      } else {
+        iov[index].iov_base =
+            reinterpret_cast<char *>(iov[index].iov_base) + nwritten;
+        iov[index].iov_len -= nwritten;
+        nwritten = 0;
+      }
+    }
+  }
+
+  return total;
+}
+
+// Host "unix:<path>" is a unix domain socket at path, port is unused.
+// Otherwise host is an IPv4 address.
+const std::string unix_prefix = "unix:";
+
+Status fillSockAddr(const std::string &host, const uint16_t port,
+                    struct sockaddr_storage &addr, socklen_t &addr_len) {
+  bzero(&addr, sizeof(addr));
+  if (host.compare(0, unix_prefix.size(), unix_prefix) == 0) {
+    std::string path = host.substr(unix_prefix.size());
+    auto *unix_addr = reinterpret_cast<struct sockaddr_un *>(&addr);
+    if (path.empty() || path.size() >= sizeof(unix_addr->sun_path)) {
+      LOG(ERROR) << "Invalid unix socket path " << path << ".";
+      return Status::InvalidError();
+    }
+
+    unix_addr->sun_family = AF_UNIX;
+    memcpy(unix_addr->sun_path, path.c_str(), path.size());
+    addr_len = sizeof(struct sockaddr_un);
+    return Status::OK();
+  }
+
+  auto *inet_addr_ptr = reinterpret_cast<struct sockaddr_in *>(&addr);
+  inet_addr_ptr->sin_family = AF_INET;
+  inet_addr_ptr->sin_addr.s_addr = inet_addr(host.c_str());
+  inet_addr_ptr->sin_port = htons(port);
+  addr_len = sizeof(struct sockaddr_in);
+  return Status::OK();
+}
+
+// io_uring is opt-in through setIoBackend, it has not been shown to beat
+// writev on the send path.
+std::atomic<IoBackend> io_backend{IoBackend::kEpoll};
+
+IoBackend currentIoBackend(void) { return io_backend.load(); }
+
+UringPool uringPool;
+
+// Send all bytes in iov with the current backend, like writevn.
+ssize_t sendIov(int fd, struct iovec *iov, int iovcnt) {
+  if (currentIoBackend() == IoBackend::kUring) {
+    // Never wait for a ring another send holds, it may be blocked on a slow
+    // peer for as long as that peer likes.
+    std::unique_lock<std::mutex> lock;
+    IoUring *ring = uringPool.acquire(lock);
+    if (ring != nullptr)
+      return ring->sendAll(fd, iov, iovcnt);
+  }
+
+  return writevn(fd, iov, iovcnt);
+}
+
+// Send length and content of a message, which is gathered from iov. The
+// length and content go out in one sendmsg or writev.
+Status sendFramev(int fd, const struct iovec *iov, int iovcnt) {
+  size_t send_size = 0;
+  for (int i = 0; i < iovcnt; i++)
+    send_size += iov[i].iov_len;
+
+  if (send_size > std::numeric_limits<uint32_t>::max()) {
+    LOG(ERROR) << "Message size " << send_size << " exceeds limit.";
+    return Status::InvalidError();
+  }
+
+  uint32_t u32_size = send_size;
+  std::vector<struct iovec> frame(iovcnt + 1);
+  frame[0].iov_base = &u32_size;
+  frame[0].iov_len = sizeof(uint32_t);
+  std::copy(iov, iov + iovcnt, frame.begin() + 1);
+
+  ssize_t send_bytes = sendIov(fd, frame.data(), frame.size());
+  if (send_bytes != static_cast<ssize_t>(send_size + sizeof(uint32_t)))
+    return Status::NetworkError();
+
+  return Status::OK();
+}
+
+// Bytes of a strided message gathered and sent at a time.
+constexpr size_t kStridedChunk = 1UL << 20;
+
+// Send length and content of a message of count elements of width bytes,
+// stride bytes apart from ptr. Elements are gathered into a staging buffer
+// of kStridedChunk bytes and sent a chunk at a time, the length goes out
+// with the first chunk. width is at most stride.
+Status sendFrameStrided(int fd, const void *ptr, size_t count, size_t stride,
+                        size_t width) {
+  size_t send_size = count * width;
+  if (send_size > std::numeric_limits<uint32_t>::max()) {
+    LOG(ERROR) << "Message size " << send_size << " exceeds limit.";
+    return Status::InvalidError();
+  }
+
+  uint32_t u32_size = send_size;
+  size_t chunk = width ? std::max<size_t>(1, kStridedChunk / width) : count;
+  std::vector<char> staging(std::min(count, chunk) * width);
+
+  size_t begin = 0;
+  do {
+    size_t num = std::min(chunk, count - begin);
+    gatherStrided(staging.data(), ptr, begin, num, stride, width);
+
+    struct iovec iov[2];
+    int iovcnt = 0;
+    if (begin == 0) {
+      iov[iovcnt].iov_base = &u32_size;
+      iov[iovcnt++].iov_len = sizeof(uint32_t);
+    }
+    iov[iovcnt].iov_base = staging.data();
+    iov[iovcnt++].iov_len = num * width;
+
+    size_t expect = num * width + (begin == 0 ? sizeof(uint32_t) : 0);
+    if (sendIov(fd, iov, iovcnt) != static_cast<ssize_t>(expect))
+      return Status::NetworkError();
+
+    begin += num;
+  } while (begin < count);
+
+  return Status::OK();
+}
+
+Status sendFrame(int fd, void *ptr, size_t send_size) {
+  struct iovec iov;
+  iov.iov_base = ptr;
+  iov.iov_len = send_size;
+  return sendFramev(fd, &iov, 1);
+}
+
+// Recv thread owns its ring, it's nullptr when use epoll backend.
+std::unique_ptr<IoUring> createRecvRing(void) {
+  if (currentIoBackend() != IoBackend::kUring)
+    return nullptr;
+
+  auto ring = std::make_unique<IoUring>();
+  if (!ring->init(8).IsOK()) {
+    LOG(WARNING) << "Init io_uring for recv failed, fallback to epoll.";
+    return nullptr;
+  }
+
+  return ring;
+}
+
+ssize_t recvn(IoUring *ring, int fd, void *ptr, size_t n) {
+  if (ring != nullptr)
+    return ring->recvAll(fd, ptr, n);
+
+  return readn(fd, ptr, n);
+}
+
 class NetworkBuffer {
 public:
   NetworkBuffer() {
     buf_ = nullptr;
     aux_buf_ = nullptr;
     buf_size_ = 0;
+    pending_fd_ = -1;
+    pending_size_ = 0;
     filled_.store(false);
+    pending_.store(false);
   }
 
   NetworkBuffer(NetworkBuffer &&other) {
     this->aux_buf_ = other.aux_buf_;
     this->buf_ = other.buf_;
     this->buf_size_ = other.buf_size_;
+    this->pending_fd_ = other.pending_fd_;
+    this->pending_size_ = other.pending_size_;
+    this->drain_fn_ = std::move(other.drain_fn_);
     this->filled_.store(other.filled_.load());
+    this->pending_.store(other.pending_.load());
 
     other.aux_buf_ = nullptr;
     other.buf_ = nullptr;
     other.buf_size_ = 0;
+    other.pending_fd_ = -1;
+    other.pending_size_ = 0;
     other.filled_.store(false);
+    other.pending_.store(false);
   }
 
   ~NetworkBuffer() {}
 
-  // Below three method is called in message recv thread.
+  // Below four method is called in message recv thread.
   Status getBufferPtr(size_t recv_size, void **ptr) {
     std::lock_guard<std::mutex> lock(buf_mu_);
     *ptr = buf_;
@@ -103,8 +307,13 @@ public:
     cond_.notify_all();
   }
 
-  Status initBuffer(size_t recv_size) {
+  // If allocated isn't nullptr, it's set to whether the message goes to a heap
+  // buffer because nobody provided one yet.
+  Status initBuffer(size_t recv_size, bool *allocated = nullptr) {
     std::lock_guard<std::mutex> lock(buf_mu_);
+    if (allocated != nullptr)
+      *allocated = (nullptr == buf_);
+
     if (nullptr == buf_) {
       buf_ = new char[recv_size];
       buf_size_ = recv_size;
@@ -122,29 +331,83 @@ public:
     return Status::OK();
   }
 
-  // Below two methods are called in algorithm thread.
+  // Used instead of initBuffer in registered mode. If the algorithm thread
+  // has provided a buffer then *ptr points to it, otherwise *ptr is nullptr
+  // and reading the payload from fd is left to the algorithm thread. In that
+  // case disarm_fn is called before the message is published, and the recv
+  // thread must not read fd again until drain_fn is called.
+  Status initBufferOrDefer(size_t recv_size, int fd,
+                           const std::function<void(void)> &disarm_fn,
+                           std::function<void(bool)> drain_fn, void **ptr) {
+    {
+      std::lock_guard<std::mutex> lock(buf_mu_);
+      if (nullptr != buf_) {
+        if (recv_size != buf_size_) {
+          LOG(ERROR) << "Size mismatch between message and message buffer, "
+                        "message size "
+                     << recv_size << ", buffer size " << buf_size_ << ".";
+          return Status::MismatchError();
+        }
+
+        *ptr = buf_;
+        return Status::OK();
+      }
+
+      disarm_fn();
+      pending_fd_ = fd;
+      pending_size_ = recv_size;
+      drain_fn_ = std::move(drain_fn);
+      *ptr = nullptr;
+      pending_.store(true);
+      VLOG(5) << "Nobody provide buffer now, defer read to consumer.";
+    }
+
+    std::unique_lock<std::mutex> lock(cond_mu_);
+    cond_.notify_all();
+    return Status::OK();
+  }
+
+  // Below three methods are called in algorithm thread.
   Status provideBuffer(void *ptr, size_t size) {
-    std::lock_guard<std::mutex> lock(buf_mu_);
-    if (nullptr == buf_) {
-      buf_ = reinterpret_cast<char *>(ptr);
-      buf_size_ = size;
-      VLOG(5) << "The buffer will be used for socket operation.";
-    } else {
-      aux_buf_ = reinterpret_cast<char *>(ptr);
-      if (buf_size_ != size) {
-        LOG(ERROR) << "Length of recv message is " << buf_size_
+    {
+      std::lock_guard<std::mutex> lock(buf_mu_);
+      if (!pending_.load()) {
+        if (nullptr == buf_) {
+          buf_ = reinterpret_cast<char *>(ptr);
+          buf_size_ = size;
+          VLOG(5) << "The buffer will be used for socket operation.";
+        } else {
+          aux_buf_ = reinterpret_cast<char *>(ptr);
+          if (buf_size_ != size) {
+            LOG(ERROR) << "Length of recv message is " << buf_size_
+                       << ", but the size of recv buffer is " << size
+                       << ", size mismatch.";
+            return Status::MismatchError();
+          }
+
+          VLOG(5) << "Create a auxiliary buffer, copy content to it after recv.";
+        }
+
+        return Status::OK();
+      }
+
+      if (pending_size_ != size) {
+        LOG(ERROR) << "Length of recv message is " << pending_size_
                    << ", but the size of recv buffer is " << size
                    << ", size mismatch.";
+        finishPending(false);
         return Status::MismatchError();
       }
 
-      VLOG(5) << "Create a auxiliary buffer, copy content to it after recv.";
+      buf_ = reinterpret_cast<char *>(ptr);
+      buf_size_ = size;
     }
 
-    return Status::OK();
+    return drainPending();
   }
 
-  Status consumeBuffer(void **msg_ptr, size_t &msg_size, uint32_t timeout) {
+  Status consumeBuffer(void **msg_ptr, size_t &msg_size, uint32_t timeout,
+                       bool &copied) {
     std::unique_lock<std::mutex> lock(cond_mu_);
 
     cond_.wait_for(lock, std::chrono::seconds(timeout),
@@ -155,11 +418,13 @@ public:
       if (nullptr == aux_buf_) {
         *msg_ptr = buf_;
         msg_size = buf_size_;
+        copied = false;
         reset(false);
       } else {
         memcpy(aux_buf_, buf_, buf_size_);
         *msg_ptr = aux_buf_;
         msg_size = buf_size_;
+        copied = true;
         reset(true);
       }
 
@@ -167,13 +432,85 @@ public:
     }
   }
 
+  // Size of the message is unknown to the caller, so the container is resized
+  // to it. A deferred message is read into the container directly.
+  Status consumeBuffer(std::string &container, uint32_t timeout, bool &copied) {
+    {
+      std::unique_lock<std::mutex> lock(cond_mu_);
+      cond_.wait_for(lock, std::chrono::seconds(timeout), [this]() {
+        return filled_.load() || pending_.load();
+      });
+    }
+
+    if (pending_.load()) {
+      {
+        std::lock_guard<std::mutex> lock(buf_mu_);
+        container.resize(pending_size_);
+        buf_ = reinterpret_cast<char *>(container.data());
+        buf_size_ = pending_size_;
+      }
+
+      copied = false;
+      auto status = drainPending();
+      if (status.IsOK()) {
+        std::unique_lock<std::mutex> lock(cond_mu_);
+        reset(false);
+      }
+
+      return status;
+    }
+
+    std::unique_lock<std::mutex> lock(cond_mu_);
+    if (filled_.load() == false)
+      return Status::TimeoutError();
+
+    container.resize(buf_size_);
+    memcpy(reinterpret_cast<uint8_t *>(container.data()),
+           reinterpret_cast<uint8_t *>(buf_), buf_size_);
+    copied = true;
+    reset(true);
+    return Status::OK();
+  }
+
 private:
+  // Read the deferred payload into buf_, then hand the socket back to the
+  // recv thread.
+  Status drainPending(void) {
+    ssize_t read_bytes = readn(pending_fd_, buf_, buf_size_);
+    bool ok = (read_bytes == static_cast<ssize_t>(buf_size_));
+    if (!ok)
+      LOG(ERROR) << "Read deferred message failed, message size " << buf_size_
+                 << ", read " << read_bytes << " bytes.";
+
+    {
+      std::lock_guard<std::mutex> lock(buf_mu_);
+      finishPending(ok);
+    }
+
+    if (!ok)
+      return Status::NetworkError();
+
+    putBufferPtr(buf_);
+    return Status::OK();
+  }
+
+  // Must hold buf_mu_.
+  void finishPending(bool ok) {
+    auto drain_fn = std::move(drain_fn_);
+    drain_fn_ = nullptr;
+    pending_fd_ = -1;
+    pending_size_ = 0;
+    pending_.store(false);
+    drain_fn(ok);
+  }
+
   void reset(bool heap_alloc) {
     if (heap_alloc)
-      delete buf_;
+      delete[] buf_;
     buf_ = nullptr;
     aux_buf_ = nullptr;
     buf_size_ = 0;
+    filled_.store(false);
   }
 
   char *buf_;
@@ -181,6 +518,11 @@ private:
   size_t buf_size_;
   std::mutex buf_mu_;
 
+  int pending_fd_;
+  size_t pending_size_;
+  std::function<void(bool)> drain_fn_;
+  std::atomic<bool> pending_;
+
   std::atomic<bool> filled_;
 
   std::mutex cond_mu_;
@@ -316,6 +658,7 @@ public:
 
     auto &buffers = iter->second;
     buffers.putBuffer(index);
+    return Status::OK();
   }
 
   Status destroyRecvBuffer(const std::string &key) {
@@ -339,6 +682,13 @@ private:
   std::map<std::string, MultipleNetworkBuffer> tag_buff_map_;
 };
 
+// Channels forked from a session's channel have tags derived from its tag,
+// see deriveNewTag, so they all map to the session's tag.
+std::string sessionOfTag(const std::string &tag) {
+  auto pos = tag.find("_fork_");
+  return pos == std::string::npos ? tag : tag.substr(0, pos);
+}
+
 class ServerSocket : public NamedSocket {
 public:
   ServerSocket(const std::string &host, const uint16_t port,
@@ -357,9 +707,9 @@ public:
     {
       std::lock_guard<std::mutex> lock(fd_tag_mu_);
       for (auto &item : fd_tag_map_) {
-        std::lock_guard<std::mutex> lock(item.second.mu_);
-        close(item.second.clientfd_);
-        all_tags.emplace_back(item.second.tag_);
+        std::lock_guard<std::mutex> lock(item.second->mu_);
+        close(item.second->clientfd_);
+        all_tags.emplace_back(item.second->tag_);
       }
     }
 
@@ -383,6 +733,42 @@ public:
     return manager_.putBuffer(tag, buff_index);
   }
 
+  Status setRegisteredRecv(const std::string &tag, bool enable) {
+    std::lock_guard<std::mutex> lock(stats_mu_);
+    if (enable)
+      registered_tags_.insert(tag);
+    else
+      registered_tags_.erase(tag);
+
+    VLOG(3) << "Registered recv mode is " << (enable ? "on" : "off")
+            << ", tag " << tag << ".";
+    return Status::OK();
+  }
+
+  Status setSessionCallback(std::function<void(const std::string &)> fn) {
+    std::lock_guard<std::mutex> lock(session_mu_);
+    session_fn_ = std::move(fn);
+    return Status::OK();
+  }
+
+  Status setSessionMemoryLimit(size_t limit) {
+    std::lock_guard<std::mutex> lock(session_mu_);
+    session_mem_limit_ = limit;
+    VLOG(3) << "Memory limit of each session is " << limit << " bytes.";
+    return Status::OK();
+  }
+
+  Status getRecvStats(const std::string &tag, RecvStats &stats) {
+    std::lock_guard<std::mutex> lock(stats_mu_);
+    auto iter = recv_stats_.find(tag);
+    if (iter == recv_stats_.end())
+      stats = RecvStats();
+    else
+      stats = iter->second;
+
+    return Status::OK();
+  }
+
   Status getMessageWithTag(const uint16_t index, std::string &container,
                            const std::string &tag, uint16_t timeout) {
     if (!valid_flag_.load()) {
@@ -399,23 +785,19 @@ public:
     }
 
     // Default timeout is 5 minutes.
-    void *ret_ptr = nullptr;
-    size_t ret_size = 0;
-    status = recv_buff->consumeBuffer(&ret_ptr, ret_size, timeout);
+    bool copied = false;
+    status = recv_buff->consumeBuffer(container, timeout, copied);
     if (!status.IsOK()) {
       LOG(WARNING) << "Get message with tag " << tag << " and index " << index
-                   << " failed, timeout.";
+                   << " failed.";
       manager_.putBuffer(tag, index);
-      return Status::TimeoutError();
+      return status;
     }
 
-    container.resize(ret_size);
-    memcpy(reinterpret_cast<uint8_t *>(container.data()),
-           reinterpret_cast<uint8_t *>(ret_ptr), ret_size);
-
+    updateRecvStats(tag, container.size(), copied);
+    if (copied)
+      uncharge(tag, container.size());
     manager_.putBuffer(tag, index);
-    ret_ptr = nullptr;
-    ret_size = 0;
 
     VLOG(5) << "Free buffer, index " << index << ", tag " << tag << ".";
     VLOG(5) << "Get message with tag " << tag << " finish, message size "
@@ -448,7 +830,8 @@ public:
     // Default timeout is 5 minutes.
     void *ret_ptr = nullptr;
     size_t ret_size = 0;
-    status = recv_buff->consumeBuffer(&ret_ptr, ret_size, timeout);
+    bool copied = false;
+    status = recv_buff->consumeBuffer(&ret_ptr, ret_size, timeout, copied);
     if (!status.IsOK()) {
       LOG(WARNING) << "Get message with tag " << tag << " and index " << index
                    << " failed, timeout.";
@@ -459,6 +842,9 @@ public:
     assert(ret_ptr == ptr);
     assert(ret_size == recv_size);
 
+    updateRecvStats(tag, ret_size, copied);
+    if (copied)
+      uncharge(tag, ret_size);
     manager_.putBuffer(tag, index);
 
     VLOG(5) << "Free buffer, index " << index << ", tag " << tag << ".";
@@ -474,34 +860,103 @@ public:
       return Status::InvalidError();
     }
 
-    std::map<std::string, InnerClientSocket>::iterator iter;
+    // Hold the socket, epoll thread may remove it from the map meanwhile.
+    std::shared_ptr<InnerClientSocket> client_socket;
     {
       std::lock_guard<std::mutex> lock(fd_tag_mu_);
-      iter = fd_tag_map_.find(tag);
+      auto iter = fd_tag_map_.find(tag);
       if (iter == fd_tag_map_.end()) {
         LOG(ERROR) << "Can't find client socket with tag " << tag << ".";
         return Status::NotFoundError();
       }
+
+      client_socket = iter->second;
     }
 
-    auto &client_socket = iter->second;
-    std::lock_guard<std::mutex> lock(client_socket.mu_);
+    std::lock_guard<std::mutex> lock(client_socket->mu_);
 
-    uint32_t u32_size = send_size;
-    ssize_t send_bytes =
-        writen(client_socket.clientfd_, &u32_size, sizeof(uint32_t));
-    if (send_bytes != sizeof(uint32_t)) {
-      LOG(ERROR) << "Send message size failed, tag " << tag << ".";
-      close(client_socket.clientfd_);
+    auto status = sendFrame(client_socket->clientfd_, ptr, send_size);
+    if (!status.IsOK()) {
+      LOG(ERROR) << "Send message failed, message size " << send_size
+                 << ", tag " << tag << ".";
+      // Let epoll thread find this bad socket.
+      close(client_socket->clientfd_);
       return Status::NetworkError();
     }
 
-    send_bytes = writen(client_socket.clientfd_, ptr, send_size);
-    if (send_bytes != static_cast<ssize_t>(send_size)) {
-      LOG(ERROR) << "Send message failed, message size " << send_size
-                 << ", tag " << tag << ".";
+    return Status::OK();
+  }
+
+  Status sendMessagevWithTag(const struct iovec *iov, int iovcnt,
+                             const std::string &tag) {
+    if (!valid_flag_.load()) {
+      LOG(ERROR) << "Invalid server socket, forbid any send operation.";
+      return Status::InvalidError();
+    }
+
+    // Hold the socket, epoll thread may remove it from the map meanwhile.
+    std::shared_ptr<InnerClientSocket> client_socket;
+    {
+      std::lock_guard<std::mutex> lock(fd_tag_mu_);
+      auto iter = fd_tag_map_.find(tag);
+      if (iter == fd_tag_map_.end()) {
+        LOG(ERROR) << "Can't find client socket with tag " << tag << ".";
+        return Status::NotFoundError();
+      }
+
+      client_socket = iter->second;
+    }
+
+    std::lock_guard<std::mutex> lock(client_socket->mu_);
+
+    auto status = sendFramev(client_socket->clientfd_, iov, iovcnt);
+    if (!status.IsOK()) {
+      LOG(ERROR) << "Send message failed, " << iovcnt << " regions, tag "
+                 << tag << ".";
       // Let epoll thread find this bad socket.
-      close(client_socket.clientfd_);
+      close(client_socket->clientfd_);
+      return Status::NetworkError();
+    }
+
+    return Status::OK();
+  }
+
+  Status sendMessageStridedWithTag(const void *ptr, size_t count,
+                                   size_t stride, size_t width,
+                                   const std::string &tag) {
+    if (!valid_flag_.load()) {
+      LOG(ERROR) << "Invalid server socket, forbid any send operation.";
+      return Status::InvalidError();
+    }
+
+    if (width > stride) {
+      LOG(ERROR) << "Width " << width << " of element is larger than stride "
+                 << stride << ".";
+      return Status::InvalidError();
+    }
+
+    // Hold the socket, epoll thread may remove it from the map meanwhile.
+    std::shared_ptr<InnerClientSocket> client_socket;
+    {
+      std::lock_guard<std::mutex> lock(fd_tag_mu_);
+      auto iter = fd_tag_map_.find(tag);
+      if (iter == fd_tag_map_.end()) {
+        LOG(ERROR) << "Can't find client socket with tag " << tag << ".";
+        return Status::NotFoundError();
+      }
+
+      client_socket = iter->second;
+    }
+
+    std::lock_guard<std::mutex> lock(client_socket->mu_);
+
+    auto status =
+        sendFrameStrided(client_socket->clientfd_, ptr, count, stride, width);
+    if (!status.IsOK()) {
+      LOG(ERROR) << "Send message failed, " << count << " elements, tag "
+                 << tag << ".";
+      // Let epoll thread find this bad socket.
+      close(client_socket->clientfd_);
       return Status::NetworkError();
     }
 
@@ -529,16 +984,6 @@ public:
 
 private:
   struct InnerClientSocket {
-    InnerClientSocket() {}
-    InnerClientSocket &operator=(const InnerClientSocket &other) {
-      if (this == &other)
-        return *this;
-
-      this->clientfd_ = other.clientfd_;
-      this->tag_ = other.tag_;
-      return *this;
-    }
-
     int clientfd_{0};
     std::mutex mu_;
     std::string tag_{""};
@@ -567,6 +1012,7 @@ private:
     std::array<struct epoll_event, max_events> all_events;
     struct epoll_event *event_ptr = all_events.data();
     bool errors = false;
+    auto ring = createRecvRing();
     while (valid_flag_.load() == true) {
       int n = epoll_wait(efd, event_ptr, max_events, 100);
       if (n < 0) {
@@ -586,7 +1032,8 @@ private:
             !(event_ptr[i].events & EPOLLIN)) {
           InnerClientSocket *sock_ptr =
               reinterpret_cast<InnerClientSocket *>(event_ptr[i].data.ptr);
-          const std::string &tag = sock_ptr->tag_;
+          // A copy, closeSocketThenClean frees the socket.
+          const std::string tag = sock_ptr->tag_;
           int client_fd = sock_ptr->clientfd_;
           closeSocketThenClean(client_fd, efd, tag);
 
@@ -631,6 +1078,7 @@ private:
             }
 
             bool dup_tag = false;
+            InnerClientSocket *sock_ptr = nullptr;
             {
               std::lock_guard<std::mutex> lock(fd_tag_mu_);
               auto iter = fd_tag_map_.find(tag);
@@ -641,10 +1089,11 @@ private:
                 close(client_fd);
                 dup_tag = true;
               } else {
-                InnerClientSocket sock;
-                sock.tag_ = tag;
-                sock.clientfd_ = client_fd;
+                auto sock = std::make_shared<InnerClientSocket>();
+                sock->tag_ = tag;
+                sock->clientfd_ = client_fd;
                 fd_tag_map_[tag] = sock;
+                sock_ptr = sock.get();
               }
             }
 
@@ -652,8 +1101,7 @@ private:
               continue;
 
             struct epoll_event new_event;
-            auto iter = fd_tag_map_.find(tag);
-            new_event.data.ptr = &(iter->second);
+            new_event.data.ptr = sock_ptr;
             new_event.events = EPOLLIN | EPOLLERR | EPOLLHUP;
 
             ret = epoll_ctl(efd, EPOLL_CTL_ADD, client_fd, &new_event);
@@ -666,15 +1114,19 @@ private:
             }
 
             VLOG(3) << "Accept new tcp connection, tag " << tag << ".";
+
+            if (sessionOfTag(tag) == tag)
+              notifySession(tag);
           }
         } else {
           InnerClientSocket *sock_ptr =
               reinterpret_cast<InnerClientSocket *>(event_ptr[i].data.ptr);
           int client_fd = sock_ptr->clientfd_;
-          std::string &tag = sock_ptr->tag_;
+          const std::string tag = sock_ptr->tag_;
 
           uint32_t msg_size = 0;
-          ssize_t recv_size = readn(client_fd, &msg_size, sizeof(uint32_t));
+          ssize_t recv_size =
+              recvn(ring.get(), client_fd, &msg_size, sizeof(uint32_t));
           if (recv_size != sizeof(uint32_t)) {
             if (recv_size == 0) {
               closeSocketThenClean(client_fd, efd, tag);
@@ -701,17 +1153,71 @@ private:
 
           manager_.getBufferWithIndex(tag, index, &recv_buff);
 
-          void *ptr = nullptr;
-          status = recv_buff->initBuffer(msg_size);
-          if (!status.IsOK()) {
-            LOG(ERROR) << "Run initBuffer failed, message tag " << tag << ".";
-            closeSocketThenClean(client_fd, efd, tag);
-            continue;
+          // A message nobody asked for yet is staged in a heap buffer, unless
+          // that takes the session over its memory limit. Then it's deferred
+          // like in registered mode and waits in the socket.
+          bool defer = isRegisteredRecv(tag);
+          bool charged = false;
+          if (!defer) {
+            charged = charge(tag, msg_size);
+            defer = !charged;
+            if (defer)
+              VLOG(5) << "Session of tag " << tag
+                      << " reaches memory limit, defer " << msg_size
+                      << " bytes message.";
           }
 
-          recv_buff->getBufferPtr(msg_size, &ptr);
+          void *ptr = nullptr;
+          if (defer) {
+            // Remove the socket from epoll while the payload waits for its
+            // buffer, the algorithm thread adds it back after read it.
+            auto disarm_fn = [efd, client_fd]() {
+              struct epoll_event event;
+              bzero(&event, sizeof(event));
+              epoll_ctl(efd, EPOLL_CTL_DEL, client_fd, &event);
+            };
+
+            auto drain_fn = [efd, client_fd, sock_ptr](bool ok) {
+              // Let epoll thread find this bad socket.
+              if (!ok)
+                shutdown(client_fd, SHUT_RDWR);
+
+              struct epoll_event event;
+              event.data.ptr = sock_ptr;
+              event.events = EPOLLIN | EPOLLERR | EPOLLHUP;
+              epoll_ctl(efd, EPOLL_CTL_ADD, client_fd, &event);
+            };
+
+            status = recv_buff->initBufferOrDefer(msg_size, client_fd,
+                                                  disarm_fn, drain_fn, &ptr);
+            if (!status.IsOK()) {
+              LOG(ERROR) << "Run initBufferOrDefer failed, message tag " << tag
+                         << ".";
+              closeSocketThenClean(client_fd, efd, tag);
+              continue;
+            }
+
+            if (ptr == nullptr) {
+              VLOG(5) << "Defer " << msg_size << " bytes message, tag " << tag
+                      << ".";
+              continue;
+            }
+          } else {
+            bool allocated = false;
+            status = recv_buff->initBuffer(msg_size, &allocated);
+            if (charged && (!status.IsOK() || !allocated))
+              uncharge(tag, msg_size);
+
+            if (!status.IsOK()) {
+              LOG(ERROR) << "Run initBuffer failed, message tag " << tag << ".";
+              closeSocketThenClean(client_fd, efd, tag);
+              continue;
+            }
+
+            recv_buff->getBufferPtr(msg_size, &ptr);
+          }
 
-          recv_size = readn(client_fd, ptr, msg_size);
+          recv_size = recvn(ring.get(), client_fd, ptr, msg_size);
           if (recv_size != static_cast<ssize_t>(msg_size)) {
             if (recv_size == 0) {
               closeSocketThenClean(client_fd, efd, tag);
@@ -741,6 +1247,8 @@ private:
     // Close server socket.
     close(server_fd_);
     close(efd);
+    if (host_.compare(0, unix_prefix.size(), unix_prefix) == 0)
+      unlink(host_.substr(unix_prefix.size()).c_str());
 
     if (errors)
       LOG(ERROR) << "Stop server recv loop due to error.";
@@ -760,17 +1268,33 @@ private:
 
     manager_.destroyRecvBuffer(tag);
 
+    std::shared_ptr<InnerClientSocket> sock;
     {
       std::lock_guard<std::mutex> lock(fd_tag_mu_);
       auto iter = fd_tag_map_.find(tag);
+      sock = iter->second;
       fd_tag_map_.erase(iter);
     }
 
+    // Wait for a send in progress on it.
+    std::lock_guard<std::mutex> lock(sock->mu_);
     close(sock_fd);
   }
 
   Status initServerSocket(void) {
-    server_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_storage bind_addr;
+    socklen_t addr_len = 0;
+    auto status = fillSockAddr(host_, port_, bind_addr, addr_len);
+    if (!status.IsOK()) {
+      valid_flag_.store(false);
+      return status;
+    }
+
+    // Remove the file left by a previous server.
+    if (bind_addr.ss_family == AF_UNIX)
+      unlink(reinterpret_cast<struct sockaddr_un *>(&bind_addr)->sun_path);
+
+    server_fd_ = socket(bind_addr.ss_family, SOCK_STREAM, 0);
     if (server_fd_ < 0) {
       LOG(ERROR) << "Create server socket failed, " << strerror(errno) << ".";
       valid_flag_.store(false);
@@ -786,12 +1310,7 @@ private:
       return Status::SyscallError();
     }
 
-    struct sockaddr_in bind_addr;
-    bind_addr.sin_family = AF_INET;
-    bind_addr.sin_addr.s_addr = inet_addr(host_.c_str());
-    bind_addr.sin_port = htons(port_);
-
-    ret = bind(server_fd_, (struct sockaddr *)&bind_addr, sizeof(bind_addr));
+    ret = bind(server_fd_, (struct sockaddr *)&bind_addr, addr_len);
     if (ret == -1) {
       LOG(ERROR) << "Bind socket to " << host_ << ":" << port_ << " failed, "
                  << strerror(errno) << ".";
@@ -814,6 +1333,57 @@ private:
     recv_loop_.join();
   }
 
+  bool isRegisteredRecv(const std::string &tag) {
+    std::lock_guard<std::mutex> lock(stats_mu_);
+    return registered_tags_.count(tag) != 0;
+  }
+
+  // Called under session_mu_, so once setSessionCallback returns the old
+  // callback is never called again.
+  void notifySession(const std::string &tag) {
+    std::lock_guard<std::mutex> lock(session_mu_);
+    if (session_fn_)
+      session_fn_(tag);
+  }
+
+  // Account size bytes of heap buffer to the session of tag, return false if
+  // that exceeds the limit.
+  bool charge(const std::string &tag, size_t size) {
+    std::lock_guard<std::mutex> lock(session_mu_);
+    if (session_mem_limit_ == 0)
+      return true;
+
+    auto &used = session_mem_[sessionOfTag(tag)];
+    if (used + size > session_mem_limit_)
+      return false;
+
+    used += size;
+    return true;
+  }
+
+  void uncharge(const std::string &tag, size_t size) {
+    std::lock_guard<std::mutex> lock(session_mu_);
+    auto iter = session_mem_.find(sessionOfTag(tag));
+    if (iter == session_mem_.end())
+      return;
+
+    iter->second -= std::min(iter->second, size);
+    if (iter->second == 0)
+      session_mem_.erase(iter);
+  }
+
+  void updateRecvStats(const std::string &tag, size_t size, bool copied) {
+    std::lock_guard<std::mutex> lock(stats_mu_);
+    auto &stats = recv_stats_[tag];
+    if (copied) {
+      stats.copy_msgs++;
+      stats.copy_bytes += size;
+    } else {
+      stats.direct_msgs++;
+      stats.direct_bytes += size;
+    }
+  }
+
   int server_fd_{0};
 
   std::thread recv_loop_;
@@ -821,9 +1391,18 @@ private:
   std::atomic<bool> loop_started_flag_;
 
   std::mutex fd_tag_mu_;
-  std::map<std::string, InnerClientSocket> fd_tag_map_;
+  std::map<std::string, std::shared_ptr<InnerClientSocket>> fd_tag_map_;
 
   RecvBufferManager manager_;
+
+  std::mutex stats_mu_;
+  std::set<std::string> registered_tags_;
+  std::map<std::string, RecvStats> recv_stats_;
+
+  std::mutex session_mu_;
+  std::function<void(const std::string &)> session_fn_;
+  size_t session_mem_limit_{0};
+  std::map<std::string, size_t> session_mem_;
 };
 
 class ServerSocketManager {
@@ -949,6 +1528,21 @@ public:
     return Status::OK();
   }
 
+  Status setRegisteredRecv(__attribute__((unused)) const std::string &tag,
+                           bool enable) {
+    registered_.store(enable);
+    VLOG(3) << "Registered recv mode is " << (enable ? "on" : "off")
+            << ", tag " << tag_ << ".";
+    return Status::OK();
+  }
+
+  Status getRecvStats(__attribute__((unused)) const std::string &tag,
+                      RecvStats &stats) {
+    std::lock_guard<std::mutex> lock(stats_mu_);
+    stats = recv_stats_;
+    return Status::OK();
+  }
+
   Status sendMessageWithTag(void *ptr, size_t send_size) {
     if (!valid_flag_.load()) {
       LOG(ERROR) << "Invalid client socket, forbid send operation.";
@@ -957,21 +1551,55 @@ public:
 
     VLOG(5) << "Send message with fd " << fd_ << ".";
 
-    uint32_t u32_size = send_size;
-    ssize_t send_bytes = writen(fd_, &u32_size, sizeof(u32_size));
-    if (send_bytes != sizeof(u32_size)) {
+    auto status = sendFrame(fd_, ptr, send_size);
+    if (!status.IsOK()) {
       close(fd_);
       valid_flag_.store(false);
-      LOG(ERROR) << "Send message size failed, tag " << tag_ << ".";
+      LOG(ERROR) << "Send message failed, message size " << send_size
+                 << ", tag " << tag_ << ".";
       return Status::NetworkError();
     }
 
-    send_bytes = writen(fd_, ptr, send_size);
-    if (send_bytes != static_cast<ssize_t>(send_size)) {
+    return Status::OK();
+  }
+
+  Status sendMessagevWithTag(const struct iovec *iov, int iovcnt) {
+    if (!valid_flag_.load()) {
+      LOG(ERROR) << "Invalid client socket, forbid send operation.";
+      return Status::InvalidError();
+    }
+
+    auto status = sendFramev(fd_, iov, iovcnt);
+    if (!status.IsOK()) {
       close(fd_);
       valid_flag_.store(false);
-      LOG(ERROR) << "Send message failed, message size " << send_size
-                 << ", tag " << tag_ << ".";
+      LOG(ERROR) << "Send message failed, " << iovcnt << " regions, tag "
+                 << tag_ << ".";
+      return Status::NetworkError();
+    }
+
+    return Status::OK();
+  }
+
+  Status sendMessageStridedWithTag(const void *ptr, size_t count,
+                                   size_t stride, size_t width) {
+    if (!valid_flag_.load()) {
+      LOG(ERROR) << "Invalid client socket, forbid send operation.";
+      return Status::InvalidError();
+    }
+
+    if (width > stride) {
+      LOG(ERROR) << "Width " << width << " of element is larger than stride "
+                 << stride << ".";
+      return Status::InvalidError();
+    }
+
+    auto status = sendFrameStrided(fd_, ptr, count, stride, width);
+    if (!status.IsOK()) {
+      close(fd_);
+      valid_flag_.store(false);
+      LOG(ERROR) << "Send message failed, " << count << " elements, tag "
+                 << tag_ << ".";
       return Status::NetworkError();
     }
 
@@ -994,24 +1622,18 @@ public:
     }
 
     // Default timeout is 5 minutes.
-    void *ret_ptr = nullptr;
-    size_t ret_size = 0;
-    status = buf->consumeBuffer(&ret_ptr, ret_size, timeout);
+    bool copied = false;
+    status = buf->consumeBuffer(container, timeout, copied);
     if (!status.IsOK()) {
       LOG(ERROR) << "Get message with tag " << tag_ << " and index " << index
-                 << " failed, timeout.";
+                 << " failed.";
 
       recv_buf_.putBuffer(index);
-      return Status::TimeoutError();
+      return status;
     }
 
-    container.resize(ret_size);
-    memcpy(reinterpret_cast<uint8_t *>(container.data()),
-           reinterpret_cast<uint8_t *>(ret_ptr), ret_size);
-
+    updateRecvStats(container.size(), copied);
     recv_buf_.putBuffer(index);
-    ret_ptr = nullptr;
-    ret_size = 0;
 
     VLOG(5) << "Free buffer, index " << index << ", tag " << tag_ << ".";
     VLOG(5) << "Get message with tag " << tag_ << " finish, message size "
@@ -1035,12 +1657,18 @@ public:
       return Status::InvalidError();
     }
 
-    buf->provideBuffer(ptr, recv_size);
+    status = buf->provideBuffer(ptr, recv_size);
+    if (!status.IsOK()) {
+      LOG(ERROR) << "Provide buffer for read failed, message tag " << tag_
+                 << ".";
+      return status;
+    }
 
     // Default timeout is 5 minutes.
     void *ret_ptr = nullptr;
     size_t ret_size = 0;
-    status = buf->consumeBuffer(&ret_ptr, ret_size, timeout);
+    bool copied = false;
+    status = buf->consumeBuffer(&ret_ptr, ret_size, timeout, copied);
     if (!status.IsOK()) {
       LOG(ERROR) << "Get message with tag " << tag_ << " and index " << index
                  << " failed, timeout.";
@@ -1052,6 +1680,7 @@ public:
     assert(ret_ptr == ptr);
     assert(ret_size == recv_size);
 
+    updateRecvStats(ret_size, copied);
     recv_buf_.putBuffer(index);
 
     VLOG(5) << "Free buffer, index " << index << ", tag " << tag_ << ".";
@@ -1062,20 +1691,19 @@ public:
   }
 
   Status initSocket(void) {
-    fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_storage server_addr;
+    socklen_t addr_len = 0;
+    auto status = fillSockAddr(host_, port_, server_addr, addr_len);
+    if (!status.IsOK())
+      return status;
+
+    fd_ = socket(server_addr.ss_family, SOCK_STREAM, 0);
     if (fd_ == -1) {
       LOG(ERROR) << "Run socket failed, " << strerror(errno) << ".";
       return Status::SyscallError();
     }
 
-    struct sockaddr_in server_addr;
-    bzero(&server_addr, sizeof(server_addr));
-    server_addr.sin_family = AF_INET;
-    server_addr.sin_addr.s_addr = inet_addr(host_.c_str());
-    server_addr.sin_port = htons(port_);
-
-    int ret =
-        connect(fd_, (struct sockaddr *)&server_addr, sizeof(struct sockaddr));
+    int ret = connect(fd_, (struct sockaddr *)&server_addr, addr_len);
     if (ret == -1) {
       LOG(ERROR) << "Connect to " << host_ << ":" << port_ << " failed, "
                  << strerror(errno) << ".";
@@ -1113,6 +1741,7 @@ public:
 private:
   void recvLoop(void) {
     bool errors = false;
+    auto ring = createRecvRing();
     struct timeval tv;
     tv.tv_sec = 0;
     tv.tv_usec = 100;
@@ -1144,7 +1773,7 @@ private:
       }
 
       uint32_t msg_size = 0;
-      ssize_t read_bytes = readn(fd_, &msg_size, sizeof(uint32_t));
+      ssize_t read_bytes = recvn(ring.get(), fd_, &msg_size, sizeof(uint32_t));
       if (read_bytes != sizeof(uint32_t)) {
         if (read_bytes == 0) {
           close(fd_);
@@ -1173,10 +1802,41 @@ private:
               << ", index " << index << ", tag " << tag_ << ".";
 
       void *ptr = nullptr;
-      buffer->initBuffer(msg_size);
-      buffer->getBufferPtr(msg_size, &ptr);
+      if (registered_.load()) {
+        auto disarm_fn = [this]() { deferred_.store(true); };
+        auto drain_fn = [this](bool ok) {
+          std::lock_guard<std::mutex> lock(defer_mu_);
+          if (!ok)
+            valid_flag_.store(false);
+          deferred_.store(false);
+          defer_cond_.notify_all();
+        };
+
+        status = buffer->initBufferOrDefer(msg_size, fd_, disarm_fn, drain_fn,
+                                           &ptr);
+        if (!status.IsOK()) {
+          close(fd_);
+          errors = true;
+          LOG(ERROR) << "Run initBufferOrDefer failed, tag " << tag_ << ".";
+          break;
+        }
 
-      read_bytes = readn(fd_, ptr, msg_size);
+        if (ptr == nullptr) {
+          // Don't touch the socket until the algorithm thread read the
+          // payload into its buffer.
+          VLOG(5) << "Defer " << msg_size << " bytes message, tag " << tag_
+                  << ".";
+          std::unique_lock<std::mutex> lock(defer_mu_);
+          while (deferred_.load() && valid_flag_.load())
+            defer_cond_.wait_for(lock, std::chrono::milliseconds(100));
+          continue;
+        }
+      } else {
+        buffer->initBuffer(msg_size);
+        buffer->getBufferPtr(msg_size, &ptr);
+      }
+
+      read_bytes = recvn(ring.get(), fd_, ptr, msg_size);
       if (read_bytes != msg_size) {
         if (read_bytes == 0) {
           close(fd_);
@@ -1201,12 +1861,31 @@ private:
       VLOG(3) << "Client recv loop exist due to peer close.";
   }
 
+  void updateRecvStats(size_t size, bool copied) {
+    std::lock_guard<std::mutex> lock(stats_mu_);
+    if (copied) {
+      recv_stats_.copy_msgs++;
+      recv_stats_.copy_bytes += size;
+    } else {
+      recv_stats_.direct_msgs++;
+      recv_stats_.direct_bytes += size;
+    }
+  }
+
   int fd_{0};
 
   std::thread recv_loop_;
   std::atomic<bool> valid_flag_{false};
 
   MultipleNetworkBuffer recv_buf_;
+
+  std::atomic<bool> registered_{false};
+  std::atomic<bool> deferred_{false};
+  std::mutex defer_mu_;
+  std::condition_variable defer_cond_;
+
+  std::mutex stats_mu_;
+  RecvStats recv_stats_;
 };
 
 class ClientSocketManager {
@@ -1239,6 +1918,18 @@ private:
 ClientSocketManager clientManager;
 } // namespace
 
+Status setIoBackend(IoBackend backend) {
+  if (backend == IoBackend::kUring && !IoUring::supported()) {
+    LOG(WARNING) << "io_uring is unavailable, keep epoll backend.";
+    return Status::UnavailableError();
+  }
+
+  io_backend.store(backend);
+  return Status::OK();
+}
+
+IoBackend getIoBackend(void) { return currentIoBackend(); }
+
 NamedSocket::NamedSocket(const std::string &host, const uint16_t port,
                          const std::string &tag) {
   host_ = host;
@@ -1263,6 +1954,26 @@ Status NamedSocket::sendMessageWithTag(void *ptr, size_t size,
   return Status::NotImplementError();
 }
 
+Status NamedSocket::sendMessagevWithTag(const struct iovec *iov, int iovcnt) {
+  return Status::NotImplementError();
+}
+
+Status NamedSocket::sendMessagevWithTag(const struct iovec *iov, int iovcnt,
+                                        const std::string &tag) {
+  return Status::NotImplementError();
+}
+
+Status NamedSocket::sendMessageStridedWithTag(const void *ptr, size_t count,
+                                              size_t stride, size_t width) {
+  return Status::NotImplementError();
+}
+
+Status NamedSocket::sendMessageStridedWithTag(const void *ptr, size_t count,
+                                              size_t stride, size_t width,
+                                              const std::string &tag) {
+  return Status::NotImplementError();
+}
+
 Status NamedSocket::getMessageWithTag(const uint16_t buff_index, void *ptr,
                                       size_t size, const std::string &tag,
                                       uint16_t timeout) {
@@ -1302,12 +2013,30 @@ Status NamedSocket::freeBuffer(const std::string &tag,
   return Status::NotImplementError();
 }
 
+Status NamedSocket::setRegisteredRecv(const std::string &tag, bool enable) {
+  return Status::NotImplementError();
+}
+
+Status NamedSocket::getRecvStats(const std::string &tag, RecvStats &stats) {
+  return Status::NotImplementError();
+}
+
+Status NamedSocket::setSessionCallback(
+    std::function<void(const std::string &)> fn) {
+  return Status::NotImplementError();
+}
+
+Status NamedSocket::setSessionMemoryLimit(size_t limit) {
+  return Status::NotImplementError();
+}
+
 ServerChannel::ServerChannel(const std::string &host, const uint16_t port,
                              const std::string &tag) {
   host_ = host;
   port_ = port;
   tag_ = tag;
   num_fork_ = 0;
+  registered_recv_ = false;
 }
 
 std::string ServerChannel::getTag(void) { return tag_; }
@@ -1366,6 +2095,37 @@ std::future<Status> ServerChannel::asyncSend(void *ptr, size_t send_size) {
   return std::async(send_fn);
 }
 
+Status ServerChannel::setRegisteredRecv(bool enable) {
+  auto status = sock_->setRegisteredRecv(tag_, enable);
+  if (status.IsOK())
+    registered_recv_ = enable;
+
+  return status;
+}
+
+Status ServerChannel::getRecvStats(RecvStats &stats) {
+  return sock_->getRecvStats(tag_, stats);
+}
+
+std::future<Status> ServerChannel::asyncSendv(span<const struct iovec> iov) {
+  auto send_fn = [this, iov]() -> Status {
+    return sock_->sendMessagevWithTag(iov.data(), iov.size(), tag_);
+  };
+
+  return std::async(send_fn);
+}
+
+std::future<Status> ServerChannel::asyncSendStrided(const void *ptr,
+                                                    size_t count,
+                                                    size_t stride,
+                                                    size_t width) {
+  auto send_fn = [this, ptr, count, stride, width]() -> Status {
+    return sock_->sendMessageStridedWithTag(ptr, count, stride, width, tag_);
+  };
+
+  return std::async(send_fn);
+}
+
 std::string ServerChannel::deriveNewTag(void) {
   num_fork_++;
   std::string new_tag = tag_ + "_fork_" + std::to_string(num_fork_);
@@ -1383,6 +2143,9 @@ std::shared_ptr<CryptoChannel> ServerChannel::fork(void) {
   if (!status.IsOK())
     return nullptr;
 
+  if (registered_recv_)
+    new_channel->setRegisteredRecv(true);
+
   forked_channel_.emplace_back(new_channel);
   // return std::dynamic_pointer_cast<CryptoChannel>(new_channel);
   std::shared_ptr<CryptoChannel> ret =
@@ -1396,6 +2159,7 @@ ClientChannel::ClientChannel(const std::string &host, const uint16_t port,
   host_ = host;
   port_ = port;
   num_fork_ = 0;
+  registered_recv_ = false;
 }
 
 Status ClientChannel::initChannel(void) {
@@ -1418,6 +2182,18 @@ ClientChannel::~ClientChannel() {
   clientManager.destroyClientSocket(tag_);
 }
 
+Status ClientChannel::setRegisteredRecv(bool enable) {
+  auto status = sock_->setRegisteredRecv(tag_, enable);
+  if (status.IsOK())
+    registered_recv_ = enable;
+
+  return status;
+}
+
+Status ClientChannel::getRecvStats(RecvStats &stats) {
+  return sock_->getRecvStats(tag_, stats);
+}
+
 std::string ClientChannel::deriveNewTag(void) {
   num_fork_++;
   std::string new_tag = tag_ + "_fork_" + std::to_string(num_fork_);
@@ -1433,6 +2209,9 @@ std::shared_ptr<CryptoChannel> ClientChannel::fork(void) {
   if (!status.IsOK())
     return nullptr;
 
+  if (registered_recv_)
+    new_channel->setRegisteredRecv(true);
+
   forked_channel_.emplace_back(new_channel);
 
   std::shared_ptr<CryptoChannel> ret =
@@ -1451,6 +2230,29 @@ std::future<Status> ClientChannel::asyncSend(void *ptr, size_t send_size) {
   return std::async(send_fn);
 }
 
+std::future<Status> ClientChannel::asyncSendv(span<const struct iovec> iov) {
+  VLOG(5) << "Send message, " << iov.size() << " regions, tag " << tag_ << ".";
+
+  auto send_fn = [this, iov]() -> Status {
+    return sock_->sendMessagevWithTag(iov.data(), iov.size());
+  };
+
+  return std::async(send_fn);
+}
+
+std::future<Status> ClientChannel::asyncSendStrided(const void *ptr,
+                                                    size_t count,
+                                                    size_t stride,
+                                                    size_t width) {
+  VLOG(5) << "Send message, " << count << " elements, tag " << tag_ << ".";
+
+  auto send_fn = [this, ptr, count, stride, width]() -> Status {
+    return sock_->sendMessageStridedWithTag(ptr, count, stride, width);
+  };
+
+  return std::async(send_fn);
+}
+
 Status ClientChannel::recvResize(std::string &container) {
   uint16_t index = 0;
   sock_->allocBufferForRead(tag_, index);
@@ -1485,4 +2287,133 @@ std::future<Status> ClientChannel::asyncRecv(void *ptr, size_t recv_size) {
   return std::async(recv_fn);
 }
 
+SessionServer::SessionServer(const std::string &host, const uint16_t port,
+                             const SessionOptions &options) {
+  host_ = host;
+  port_ = port;
+  options_ = options;
+}
+
+SessionServer::~SessionServer() { stop(); }
+
+Status SessionServer::start(Handler handler) {
+  if (sock_ != nullptr) {
+    LOG(ERROR) << "Session server on " << host_ << ":" << port_
+               << " is already started.";
+    return Status::InvalidError();
+  }
+
+  if (options_.max_sessions == 0) {
+    LOG(ERROR) << "Max sessions of session server should be positive.";
+    return Status::InvalidError();
+  }
+
+  handler_ = std::move(handler);
+  sock_ = serverManager.getOrCreateServerSocket(host_, port_);
+
+  auto status = sock_->setSessionMemoryLimit(options_.memory_limit);
+  if (status.IsOK())
+    status = sock_->setSessionCallback(
+        [this](const std::string &tag) { addSession(tag); });
+  if (status.IsOK())
+    status = sock_->startServerLoop();
+
+  if (!status.IsOK()) {
+    LOG(ERROR) << "Start session server on " << host_ << ":" << port_
+               << " failed.";
+    sock_->setSessionCallback(nullptr);
+    sock_ = nullptr;
+    serverManager.destroyServerSocket(host_, port_);
+    return status;
+  }
+
+  stop_ = false;
+  for (uint32_t i = 0; i < options_.max_sessions; i++)
+    runners_.emplace_back(&SessionServer::runLoop, this);
+
+  VLOG(3) << "Session server listens on " << host_ << ":" << port_
+          << ", max sessions " << options_.max_sessions << ".";
+  return Status::OK();
+}
+
+void SessionServer::stop(void) {
+  if (sock_ == nullptr)
+    return;
+
+  // No more sessions, the running ones finish first.
+  sock_->setSessionCallback(nullptr);
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    stop_ = true;
+    if (pending_.size())
+      LOG(WARNING) << "Drop " << pending_.size()
+                   << " pending sessions due to stop.";
+    pending_.clear();
+  }
+  cond_.notify_all();
+
+  for (auto &runner : runners_)
+    runner.join();
+  runners_.clear();
+
+  sock_ = nullptr;
+  serverManager.destroyServerSocket(host_, port_);
+  VLOG(3) << "Session server on " << host_ << ":" << port_ << " stops.";
+}
+
+size_t SessionServer::activeSessions(void) {
+  std::lock_guard<std::mutex> lock(mu_);
+  return active_;
+}
+
+size_t SessionServer::pendingSessions(void) {
+  std::lock_guard<std::mutex> lock(mu_);
+  return pending_.size();
+}
+
+void SessionServer::addSession(const std::string &tag) {
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (stop_)
+      return;
+
+    pending_.push_back(tag);
+  }
+
+  cond_.notify_one();
+  VLOG(3) << "New session, tag " << tag << ".";
+}
+
+void SessionServer::runLoop(void) {
+  while (true) {
+    std::string tag;
+    {
+      std::unique_lock<std::mutex> lock(mu_);
+      cond_.wait(lock, [this]() { return stop_ || pending_.size(); });
+      if (stop_)
+        return;
+
+      tag = pending_.front();
+      pending_.pop_front();
+      active_++;
+    }
+
+    auto channel = std::make_shared<ServerChannel>(host_, port_, tag);
+    auto status = channel->initChannel();
+    if (status.IsOK())
+      status = handler_(tag, channel);
+
+    if (!status.IsOK())
+      LOG(ERROR) << "Session with tag " << tag << " failed.";
+    else
+      VLOG(3) << "Session with tag " << tag << " finish.";
+
+    channel = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      active_--;
+    }
+  }
+}
+
 } // namespace primihub::crypto::network
@@ -1,8 +1,14 @@
 #ifndef __TOOLS_SOCKET_H_
 #define __TOOLS_SOCKET_H_
 
+#include <condition_variable>
+#include <deque>
+#include <functional>
 #include <iostream>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "tools/channel.h"
 #include "tools/status.h"
@@ -10,6 +16,15 @@
 using primihub::crypto::Status;
 
 namespace primihub::crypto::network {
+// Backend used to move message content. Message arrival is always watched by
+// epoll or select, kUring sends a message in one io_uring submission and
+// reads it through a ring owned by the recv thread. kEpoll is the default,
+// kUring is opt-in and only set if the kernel supports io_uring.
+enum class IoBackend { kEpoll, kUring };
+
+Status setIoBackend(IoBackend backend);
+IoBackend getIoBackend(void);
+
 class NamedSocket {
 public:
   NamedSocket(const std::string &host, const uint16_t port,
@@ -20,6 +35,14 @@ public:
   virtual Status sendMessageWithTag(void *ptr, size_t size);
   virtual Status sendMessageWithTag(void *ptr, size_t size,
                                     const std::string &tag);
+  virtual Status sendMessagevWithTag(const struct iovec *iov, int iovcnt);
+  virtual Status sendMessagevWithTag(const struct iovec *iov, int iovcnt,
+                                     const std::string &tag);
+  virtual Status sendMessageStridedWithTag(const void *ptr, size_t count,
+                                           size_t stride, size_t width);
+  virtual Status sendMessageStridedWithTag(const void *ptr, size_t count,
+                                           size_t stride, size_t width,
+                                           const std::string &tag);
   virtual Status getMessageWithTag(const uint16_t buff_index, void *ptr,
                                    size_t size, const std::string &tag,
                                    uint16_t timeout = 300);
@@ -38,6 +61,11 @@ public:
   virtual Status allocBufferForRead(const std::string &tag,
                                     uint16_t &buff_index);
   virtual Status freeBuffer(const std::string &tag, const uint16_t buff_index);
+  virtual Status setRegisteredRecv(const std::string &tag, bool enable);
+  virtual Status getRecvStats(const std::string &tag, RecvStats &stats);
+  virtual Status setSessionCallback(
+      std::function<void(const std::string &)> fn);
+  virtual Status setSessionMemoryLimit(size_t limit);
 
 protected:
   std::string tag_;
@@ -45,6 +73,8 @@ protected:
   uint16_t port_;
 };
 
+// Channels connect to host:port over TCP, or over a unix domain socket if
+// host is "unix:<path>", then port is unused.
 class ClientChannel : public CryptoChannel {
 public:
   ClientChannel(const std::string &host, const uint16_t port,
@@ -52,10 +82,15 @@ public:
   ~ClientChannel();
   Status initChannel(void);
   std::future<Status> asyncSend(void *ptr, size_t send_size);
+  std::future<Status> asyncSendv(span<const struct iovec> iov);
+  std::future<Status> asyncSendStrided(const void *ptr, size_t count,
+                                       size_t stride, size_t width);
   std::future<Status> asyncRecv(void *ptr, size_t recv_size);
   Status recvResize(std::string &container);
   std::shared_ptr<CryptoChannel> fork(void);
   std::string getTag(void);
+  Status setRegisteredRecv(bool enable);
+  Status getRecvStats(RecvStats &stats);
 
 private:
   std::string deriveNewTag(void);
@@ -67,6 +102,7 @@ private:
   std::string host_;
   uint16_t port_;
   uint16_t num_fork_;
+  bool registered_recv_;
 };
 
 class ServerChannel : public CryptoChannel {
@@ -76,10 +112,15 @@ public:
   ~ServerChannel();
   Status initChannel(void);
   std::future<Status> asyncSend(void *ptr, size_t send_size);
+  std::future<Status> asyncSendv(span<const struct iovec> iov);
+  std::future<Status> asyncSendStrided(const void *ptr, size_t count,
+                                       size_t stride, size_t width);
   std::future<Status> asyncRecv(void *ptr, size_t recv_size);
   Status recvResize(std::string &container);
   std::shared_ptr<CryptoChannel> fork(void);
   std::string getTag(void);
+  Status setRegisteredRecv(bool enable);
+  Status getRecvStats(RecvStats &stats);
 
 private:
   std::string deriveNewTag(void);
@@ -91,6 +132,60 @@ private:
   std::string host_;
   uint16_t port_;
   uint16_t num_fork_;
+  bool registered_recv_;
+};
+
+struct SessionOptions {
+  // Sessions handled at the same time, later ones wait for a free slot.
+  uint32_t max_sessions{16};
+  // Bytes a session may hold in heap buffers for messages it hasn't asked for
+  // yet. Further messages wait in the socket until they are asked for, so a
+  // slow session pushes back on its peer instead of growing memory. 0 means
+  // no limit.
+  size_t memory_limit{0};
+};
+
+// Serves many concurrent sessions over one listening port. A client opens a
+// session by connecting a ClientChannel with a tag that no live session
+// uses, and channels forked from it connect with tags derived from it, so
+// the server routes them all to the same session by tag.
+//
+// Each session runs handler with a ServerChannel of its tag on one of
+// max_sessions session threads. Handlers should run their parallel phases on
+// the shared psi ThreadPool, which is the default of RsPsiSender and
+// RsPsiReceiver, rather than start threads per session. Protocols which take
+// a link channel run over the session channel through LinkChannel, see
+// tools/link_channel.h, or RsPsiSender::run with a CryptoChannel.
+class SessionServer {
+public:
+  using Handler = std::function<Status(const std::string &tag,
+                                       std::shared_ptr<CryptoChannel> channel)>;
+
+  SessionServer(const std::string &host, const uint16_t port,
+                const SessionOptions &options = SessionOptions());
+  ~SessionServer();
+  Status start(Handler handler);
+  // Stop accepting sessions, drop pending ones and wait for running ones.
+  void stop(void);
+  size_t activeSessions(void);
+  size_t pendingSessions(void);
+
+private:
+  void addSession(const std::string &tag);
+  void runLoop(void);
+
+  std::string host_;
+  uint16_t port_;
+  SessionOptions options_;
+  Handler handler_;
+  std::shared_ptr<NamedSocket> sock_;
+
+  std::vector<std::thread> runners_;
+  std::mutex mu_;
+  std::condition_variable cond_;
+  std::deque<std::string> pending_;
+  size_t active_{0};
+  bool stop_{false};
 };
 
 } // namespace primihub::crypto::network
@@ -0,0 +1,330 @@
+#include <errno.h>
+#include <glog/logging.h>
+#include <limits.h>
+#include <sched.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <thread>
+
+#include "tools/uring.h"
+
+namespace primihub::crypto::network {
+namespace {
+int uringSetup(uint32_t entries, struct io_uring_params *p) {
+  return static_cast<int>(syscall(__NR_io_uring_setup, entries, p));
+}
+
+int uringEnter(int ring_fd, uint32_t to_submit, uint32_t min_complete,
+               uint32_t flags) {
+  return static_cast<int>(syscall(__NR_io_uring_enter, ring_fd, to_submit,
+                                  min_complete, flags, nullptr, 0));
+}
+
+int uringRegister(int ring_fd, uint32_t opcode, void *arg, uint32_t nr_args) {
+  return static_cast<int>(
+      syscall(__NR_io_uring_register, ring_fd, opcode, arg, nr_args));
+}
+
+// Length field of a SQE is 32 bits, split large recv into chunks.
+constexpr size_t kMaxRecvChunk = 1UL << 30;
+} // namespace
+
+IoUring::IoUring() {
+  ring_fd_ = -1;
+  pending_submit_ = 0;
+  sq_ring_ptr_ = MAP_FAILED;
+  sq_ring_size_ = 0;
+  cq_ring_ptr_ = MAP_FAILED;
+  cq_ring_size_ = 0;
+  sqes_ = reinterpret_cast<struct io_uring_sqe *>(MAP_FAILED);
+  sqes_size_ = 0;
+}
+
+IoUring::~IoUring() {
+  if (sqes_ != MAP_FAILED)
+    munmap(sqes_, sqes_size_);
+
+  if (cq_ring_ptr_ != MAP_FAILED && cq_ring_ptr_ != sq_ring_ptr_)
+    munmap(cq_ring_ptr_, cq_ring_size_);
+
+  if (sq_ring_ptr_ != MAP_FAILED)
+    munmap(sq_ring_ptr_, sq_ring_size_);
+
+  if (ring_fd_ != -1)
+    close(ring_fd_);
+}
+
+Status IoUring::init(uint32_t entries) {
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+
+  ring_fd_ = uringSetup(entries, &params);
+  if (ring_fd_ < 0) {
+    LOG(ERROR) << "Run io_uring_setup failed, " << strerror(errno) << ".";
+    ring_fd_ = -1;
+    return Status::SyscallError();
+  }
+
+  sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+  cq_ring_size_ =
+      params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+  if (single_mmap) {
+    sq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+    cq_ring_size_ = sq_ring_size_;
+  }
+
+  sq_ring_ptr_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+  if (sq_ring_ptr_ == MAP_FAILED) {
+    LOG(ERROR) << "Map io_uring sq ring failed, " << strerror(errno) << ".";
+    return Status::SyscallError();
+  }
+
+  if (single_mmap) {
+    cq_ring_ptr_ = sq_ring_ptr_;
+  } else {
+    cq_ring_ptr_ =
+        mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+    if (cq_ring_ptr_ == MAP_FAILED) {
+      LOG(ERROR) << "Map io_uring cq ring failed, " << strerror(errno) << ".";
+      return Status::SyscallError();
+    }
+  }
+
+  sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+  sqes_ = reinterpret_cast<struct io_uring_sqe *>(
+      mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+           MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES));
+  if (sqes_ == MAP_FAILED) {
+    LOG(ERROR) << "Map io_uring sqes failed, " << strerror(errno) << ".";
+    return Status::SyscallError();
+  }
+
+  char *sq_ptr = reinterpret_cast<char *>(sq_ring_ptr_);
+  sq_head_ = reinterpret_cast<uint32_t *>(sq_ptr + params.sq_off.head);
+  sq_tail_ = reinterpret_cast<uint32_t *>(sq_ptr + params.sq_off.tail);
+  sq_mask_ = reinterpret_cast<uint32_t *>(sq_ptr + params.sq_off.ring_mask);
+  sq_array_ = reinterpret_cast<uint32_t *>(sq_ptr + params.sq_off.array);
+
+  char *cq_ptr = reinterpret_cast<char *>(cq_ring_ptr_);
+  cq_head_ = reinterpret_cast<uint32_t *>(cq_ptr + params.cq_off.head);
+  cq_tail_ = reinterpret_cast<uint32_t *>(cq_ptr + params.cq_off.tail);
+  cq_mask_ = reinterpret_cast<uint32_t *>(cq_ptr + params.cq_off.ring_mask);
+  cqes_ = reinterpret_cast<struct io_uring_cqe *>(cq_ptr + params.cq_off.cqes);
+
+  VLOG(5) << "Init io_uring finish, sq entries " << params.sq_entries
+          << ", cq entries " << params.cq_entries << ".";
+  return Status::OK();
+}
+
+bool IoUring::supported(void) {
+  static const bool support = []() {
+    IoUring ring;
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    ring.ring_fd_ = uringSetup(2, &params);
+    if (ring.ring_fd_ < 0) {
+      VLOG(3) << "io_uring is unavailable, " << strerror(errno) << ".";
+      ring.ring_fd_ = -1;
+      return false;
+    }
+
+    size_t probe_size = sizeof(struct io_uring_probe) +
+                        256 * sizeof(struct io_uring_probe_op);
+    std::vector<char> probe_buf(probe_size, 0);
+    auto probe = reinterpret_cast<struct io_uring_probe *>(probe_buf.data());
+    if (uringRegister(ring.ring_fd_, IORING_REGISTER_PROBE, probe, 256) < 0) {
+      VLOG(3) << "Probe io_uring opcodes failed, " << strerror(errno) << ".";
+      return false;
+    }
+
+    for (uint8_t op : {IORING_OP_SENDMSG, IORING_OP_RECV}) {
+      if (op > probe->last_op ||
+          !(probe->ops[op].flags & IO_URING_OP_SUPPORTED)) {
+        VLOG(3) << "io_uring doesn't support opcode " << uint32_t(op) << ".";
+        return false;
+      }
+    }
+
+    return true;
+  }();
+
+  return support;
+}
+
+struct io_uring_sqe *IoUring::getSqe(void) {
+  uint32_t head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+  uint32_t tail = *sq_tail_;
+  if (tail - head > *sq_mask_)
+    return nullptr;
+
+  uint32_t index = tail & *sq_mask_;
+  struct io_uring_sqe *sqe = &sqes_[index];
+  memset(sqe, 0, sizeof(*sqe));
+  sq_array_[index] = index;
+  __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+  pending_submit_++;
+  return sqe;
+}
+
+int IoUring::submitAndWait(uint32_t wait_nr) {
+  while (true) {
+    int ret = uringEnter(ring_fd_, pending_submit_, wait_nr,
+                         IORING_ENTER_GETEVENTS);
+    if (ret < 0) {
+      if (errno == EINTR)
+        continue;
+
+      LOG(ERROR) << "Run io_uring_enter failed, " << strerror(errno) << ".";
+      return -1;
+    }
+
+    pending_submit_ -= ret;
+    return ret;
+  }
+}
+
+bool IoUring::reapCqe(int32_t &res) {
+  uint32_t head = *cq_head_;
+  if (head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE))
+    return false;
+
+  res = cqes_[head & *cq_mask_].res;
+  __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+  return true;
+}
+
+ssize_t IoUring::sendAll(int fd, struct iovec *iov, int iovcnt) {
+  std::vector<struct iovec> vec(iov, iov + iovcnt);
+  size_t total = 0;
+  for (const auto &item : vec)
+    total += item.iov_len;
+
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  struct iovec *iov_ptr = vec.data();
+  size_t iov_left = vec.size();
+
+  size_t nleft = total;
+  while (nleft > 0) {
+    // Kernel rejects more than IOV_MAX regions in one sendmsg.
+    msg.msg_iov = iov_ptr;
+    msg.msg_iovlen = std::min<size_t>(iov_left, IOV_MAX);
+
+    struct io_uring_sqe *sqe = getSqe();
+    if (sqe == nullptr) {
+      LOG(ERROR) << "No free sqe in io_uring.";
+      return -1;
+    }
+
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(&msg);
+    sqe->len = 1;
+
+    int32_t res = 0;
+    if (submitAndWait(1) < 0 || !reapCqe(res))
+      return -1;
+
+    if (res < 0) {
+      if (res == -EINTR)
+        continue;
+
+      LOG(ERROR) << "Run io_uring sendmsg failed, " << strerror(-res) << ".";
+      return -1;
+    }
+
+    // Skip the part already sent.
+    nleft -= res;
+    size_t sent = res;
+    while (iov_left > 0 && (sent > 0 || iov_ptr->iov_len == 0)) {
+      if (sent >= iov_ptr->iov_len) {
+        sent -= iov_ptr->iov_len;
+        iov_ptr++;
+        iov_left--;
+      } else {
+        iov_ptr->iov_base = reinterpret_cast<char *>(iov_ptr->iov_base) + sent;
+        iov_ptr->iov_len -= sent;
+        sent = 0;
+      }
+    }
+  }
+
+  return total;
+}
+
+ssize_t IoUring::recvAll(int fd, void *ptr, size_t size) {
+  char *buf = reinterpret_cast<char *>(ptr);
+  size_t nleft = size;
+  while (nleft > 0) {
+    struct io_uring_sqe *sqe = getSqe();
+    if (sqe == nullptr) {
+      LOG(ERROR) << "No free sqe in io_uring.";
+      return -1;
+    }
+
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(buf);
+    sqe->len = std::min(nleft, kMaxRecvChunk);
+    sqe->msg_flags = MSG_WAITALL;
+
+    int32_t res = 0;
+    if (submitAndWait(1) < 0 || !reapCqe(res))
+      return -1;
+
+    if (res < 0) {
+      if (res == -EINTR)
+        continue;
+
+      LOG(ERROR) << "Run io_uring recv failed, " << strerror(-res) << ".";
+      return -1;
+    } else if (res == 0) {
+      break; // EOF
+    }
+
+    nleft -= res;
+    buf += res;
+  }
+
+  return size - nleft;
+}
+
+UringPool::UringPool() {
+  uint32_t num = std::max(1U, std::thread::hardware_concurrency());
+  for (uint32_t i = 0; i < num; i++)
+    slots_.emplace_back(std::make_unique<Slot>());
+}
+
+IoUring *UringPool::acquire(std::unique_lock<std::mutex> &lock) {
+  int cpu = sched_getcpu();
+  if (cpu < 0)
+    cpu = 0;
+
+  Slot &slot = *slots_[cpu % slots_.size()];
+  lock = std::unique_lock<std::mutex>(slot.mu_, std::try_to_lock);
+  if (!lock.owns_lock() || slot.failed_)
+    return nullptr;
+
+  if (slot.ring_ == nullptr) {
+    auto ring = std::make_unique<IoUring>();
+    if (!ring->init(64).IsOK()) {
+      slot.failed_ = true;
+      return nullptr;
+    }
+
+    slot.ring_ = std::move(ring);
+  }
+
+  return slot.ring_.get();
+}
+
+} // namespace primihub::crypto::network
@@ -0,0 +1,92 @@
+#ifndef __TOOLS_URING_H_
+#define __TOOLS_URING_H_
+
+#include <linux/io_uring.h>
+#include <sys/uio.h>
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "tools/status.h"
+
+using primihub::crypto::Status;
+
+namespace primihub::crypto::network {
+// A minimal io_uring wrapper built on raw syscalls, it only offers blocking
+// whole-message send and recv. Each call puts all SQEs of a message into the
+// ring and submits them with the wait for completion in one io_uring_enter,
+// so a framed message costs one syscall instead of one per write/read. It is
+// not thread safe, use UringPool to share rings between threads.
+class IoUring {
+public:
+  IoUring();
+  ~IoUring();
+
+  IoUring(const IoUring &) = delete;
+  IoUring &operator=(const IoUring &) = delete;
+
+  Status init(uint32_t entries);
+
+  // Return true if the kernel supports io_uring with the opcodes used here.
+  static bool supported(void);
+
+  // Send all bytes in iov, like writen. Return bytes sent or -1. There is no
+  // limit on iovcnt, it's split into IOV_MAX sized sendmsg.
+  ssize_t sendAll(int fd, struct iovec *iov, int iovcnt);
+
+  // Recv exactly size bytes, like readn. Return bytes read, which is less
+  // than size if peer closes, or -1.
+  ssize_t recvAll(int fd, void *ptr, size_t size);
+
+private:
+  struct io_uring_sqe *getSqe(void);
+  int submitAndWait(uint32_t wait_nr);
+  bool reapCqe(int32_t &res);
+
+  int ring_fd_;
+  uint32_t pending_submit_;
+
+  void *sq_ring_ptr_;
+  size_t sq_ring_size_;
+  void *cq_ring_ptr_;
+  size_t cq_ring_size_;
+  struct io_uring_sqe *sqes_;
+  size_t sqes_size_;
+
+  uint32_t *sq_head_;
+  uint32_t *sq_tail_;
+  uint32_t *sq_mask_;
+  uint32_t *sq_array_;
+  uint32_t *cq_head_;
+  uint32_t *cq_tail_;
+  uint32_t *cq_mask_;
+  struct io_uring_cqe *cqes_;
+};
+
+// One ring per core. Threads pick the ring of the cpu they are running on,
+// so all forked channels share a handful of rings instead of creating one
+// for each async send. A send holds its ring until the peer has taken every
+// byte, so a busy ring is never waited for, the caller sends without
+// io_uring instead and a stalled peer only ever holds up its own channel.
+class UringPool {
+public:
+  UringPool();
+
+  // Return a locked ring, nullptr if io_uring is unavailable or the ring of
+  // this cpu is in use by another send.
+  IoUring *acquire(std::unique_lock<std::mutex> &lock);
+
+private:
+  struct Slot {
+    std::mutex mu_;
+    std::unique_ptr<IoUring> ring_;
+    bool failed_{false};
+  };
+
+  std::vector<std::unique_ptr<Slot>> slots_;
+};
+
+} // namespace primihub::crypto::network
+
+#endif